@@ -0,0 +1,171 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef bench_h
+#define bench_h
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/// Shared perft table, written and read by all workers without locks.
+/// An entry is valid only when check == key ^ nodes, thus a torn write
+/// from two racing threads is simply seen as a miss.
+class PerftHash {
+public:
+    void resize(size_t mb);
+    void clear();
+    bool enabled() const { return mask != 0; }
+
+    bool probe(uint64_t key, int depth, uint64_t& nodes) const;
+    void store(uint64_t key, int depth, uint64_t nodes);
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> check, nodes;
+    };
+
+    static uint64_t depthKey(uint64_t key, int depth) {
+        return key ^ (uint64_t(depth) * 0x9E3779B97F4A7C15ULL);
+    }
+
+    std::unique_ptr<Entry[]> table;
+    uint64_t mask = 0;
+};
+
+
+/// A move generator under test. Each engine supplies one, see perft_*.cpp
+class PerftEngine {
+public:
+    virtual ~PerftEngine() = default;
+
+    virtual const char* name() const = 0;
+
+    /// Initializes the engine (once) and gets it ready for @threads workers
+    virtual void setThreads(int threads) = 0;
+
+    /// Number of legal moves in the position @fen
+    virtual int rootMoveCount(const std::string& fen) = 0;
+
+    /// Perft of the position after the @moveIdx-th legal move of @fen,
+    /// computed on the worker slot @worker
+    virtual uint64_t perftRootMove(int worker, const std::string& fen, int moveIdx,
+                                   int depth, PerftHash* hash) = 0;
+};
+
+PerftEngine* stockfishPerftEngine();
+PerftEngine* lc0PerftEngine();
+PerftEngine* rubichessPerftEngine();
+
+
+struct PerftPosition {
+    std::string fen;
+    std::vector<uint64_t> nodes;  // expected results, index is depth
+};
+
+extern const std::vector<PerftPosition> perftSuite;
+
+struct PerftResult {
+    uint64_t nodes;
+    double seconds;
+};
+
+/// Split-at-root parallel perft: workers pick root moves one by one
+PerftResult perft(PerftEngine& engine, const std::string& fen, int depth,
+                  int threads, PerftHash* hash);
+
+int perftMain(const std::vector<std::string>& args);
+
+
+/// Positions searched by every engine in the "search" mode
+extern const std::vector<std::string> searchSuite;
+
+int searchMain(const std::vector<std::string>& args);
+
+int backendMain(const std::vector<std::string>& args);
+
+int batchingMain(const std::vector<std::string>& args);
+
+int backupMain(const std::vector<std::string>& args);
+
+int reuseMain(const std::vector<std::string>& args);
+
+int ttMain(const std::vector<std::string>& args);
+
+int prefetchMain(const std::vector<std::string>& args);
+
+int backgroundMain(const std::vector<std::string>& args);
+
+int treeMemoryMain(const std::vector<std::string>& args);
+
+int gcMain(const std::vector<std::string>& args);
+
+int puctMain(const std::vector<std::string>& args);
+
+int coroutinesMain(const std::vector<std::string>& args);
+
+
+/// Endgame positions probed by the "tb" mode
+extern const std::vector<std::string> tbSuite;
+
+int tbMain(const std::vector<std::string>& args);
+
+
+/// An NNUE evaluation under test in the "nnue" mode, see bench_nnue.cpp and nnue_stockfish.cpp
+class NnueEngine {
+public:
+    struct Walk {
+        uint64_t nodes = 0;
+        int64_t checksum = 0;
+        double seconds = 0;
+    };
+
+    virtual ~NnueEngine() = default;
+
+    virtual const char* name() const = 0;
+
+    /// Loads the network @net, or a random one of the engine's layout if empty
+    virtual bool load(const std::string& net) = 0;
+
+    virtual std::string description() = 0;
+
+    /// Writes the loaded network to @file in the engine's native format, which
+    /// load() maps and uses in place. False if the engine has no such format
+    virtual bool exportNative(const std::string& file) { (void)file; return false; }
+
+    /// Walks the perft trees of the first @positions of perftSuite making and
+    /// unmaking moves, with @evaluate the evaluations of all nodes are added up
+    virtual Walk walk(bool evaluate, int depth, int positions) = 0;
+};
+
+NnueEngine* stockfishNnueEngine();
+
+int nnueMain(const std::vector<std::string>& args);
+
+int gensfenMain(const std::vector<std::string>& args);
+
+/// Parses comma separated numbers such as "1,2,4"
+std::vector<int> parseList(const std::string& str);
+
+} // namespace bench
+
+#endif /* bench_h */
@@ -0,0 +1,80 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+
+#include "bench.h"
+#include "../engines-bridging-header.h"
+
+#include "benchmark/lc0_backendbench.h"
+#include "chess/lc0_board.h"
+
+namespace bench {
+
+/// bsgbench backend [-backend random,trivial,eigen] [-net file] [-maxbatch 64] [-batches 100]
+/// Lc0 inference only: evals/s and latency percentiles per batch size,
+/// the best one is a good MinibatchSize for the machine
+int backendMain(const std::vector<std::string>& args)
+{
+    std::string backendList = "random,trivial,eigen", netPath;
+    int maxBatchSize = 64, batches = 100;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-backend") {
+            backendList = args[i + 1];
+        } else if (args[i] == "-net") {
+            netPath = args[i + 1];
+        } else if (args[i] == "-maxbatch") {
+            maxBatchSize = std::stoi(args[i + 1]);
+        } else if (args[i] == "-batches") {
+            batches = std::stoi(args[i + 1]);
+        } else {
+            std::cerr << "Unknown backend option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    lczero::InitializeMagicBitboards();
+    engine_setMessageEcho(0);
+
+    size_t pos = 0;
+    while (pos < backendList.size()) {
+        auto next = backendList.find(',', pos);
+        if (next == std::string::npos) {
+            next = backendList.size();
+        }
+        auto backend = backendList.substr(pos, next - pos);
+        pos = next + 1;
+
+        if (netPath.empty() && backend != "random" && backend != "trivial") {
+            std::cerr << backend << ": no network given, skipped" << std::endl;
+            continue;
+        }
+
+        lczero::BackendBenchmark benchmark;
+        benchmark.Run(netPath, backend, maxBatchSize, batches);
+
+        while (auto msg = engine_getSearchMessage(lc0)) {
+            std::cout << msg << std::endl;
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+} // namespace bench
@@ -0,0 +1,172 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "bench.h"
+#include "../engines-bridging-header.h"
+
+namespace bench {
+
+namespace {
+
+struct MoveResult {
+    std::string bestmove, ponder;
+    uint64_t total = 0;     // visits of the root at the end, "info nodes"
+    uint64_t playouts = 0;  // visits added by this search
+    double ms = 0;
+};
+
+MoveResult searchMove(int eid, const std::string& moves, const std::string& goCmd)
+{
+    MoveResult result;
+    engine_clearAllMessages(eid);
+    engine_cmd(eid, ("position startpos moves" + moves).c_str());
+
+    const auto start = std::chrono::steady_clock::now();
+    engine_cmd(eid, goCmd.c_str());
+    for (;;) {
+        auto msg = engine_getSearchMessage(eid);
+        if (!msg) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        std::istringstream is(msg);
+        std::string token;
+        is >> token;
+        if (token == "bestmove") {
+            is >> result.bestmove >> token >> result.ponder;
+            break;
+        }
+        while (is >> token && token != "pv") {
+            if (token == "nodes") is >> result.total;
+        }
+    }
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    EngineSearchStats stats {};
+    engine_getSearchStats(eid, &stats);
+    result.playouts = stats.nodes;
+    return result;
+}
+
+} // namespace
+
+/// bsgbench background [-visits 0,50000] [-share 25] [-idle 200] [-moves 8] [-lc0nodes 2000]
+///                     [-threads 1] [-lc0backend random] [-lc0net file]
+/// Lc0 plays a game against an opponent which answers with the ponder move
+/// after -idle ms, with each BackgroundSearchVisits. The background search
+/// extends the tree below the expected reply while the opponent thinks, so
+/// the next search reuses more visits. Reports for every move the time until
+/// the root has -lc0nodes visits (go nodes counts the reused ones), and its
+/// total over the moves after the first, which no background search precedes
+int backgroundMain(const std::vector<std::string>& args)
+{
+    std::vector<int> visitsList = { 0, 50000 };
+    uint64_t lc0Nodes = 2000;
+    int share = 25, idleMs = 200, moves = 8, threads = 1;
+    std::string backend = "random", net;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-visits") {
+            visitsList = parseList(args[i + 1]);
+        } else if (args[i] == "-share") {
+            share = std::stoi(args[i + 1]);
+        } else if (args[i] == "-idle") {
+            idleMs = std::stoi(args[i + 1]);
+        } else if (args[i] == "-moves") {
+            moves = std::stoi(args[i + 1]);
+        } else if (args[i] == "-lc0nodes") {
+            lc0Nodes = std::stoull(args[i + 1]);
+        } else if (args[i] == "-threads") {
+            threads = std::stoi(args[i + 1]);
+        } else if (args[i] == "-lc0backend") {
+            backend = args[i + 1];
+        } else if (args[i] == "-lc0net") {
+            net = args[i + 1];
+        } else {
+            std::cerr << "Unknown background option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    engine_setMessageEcho(0);
+    const std::string goCmd = "go nodes " + std::to_string(lc0Nodes);
+    char buf[256];
+    for (int visits : visitsList) {
+        setNetworkPath(lc0, net.empty() ? "<autodiscover>" : net.c_str());
+        engine_initialize(lc0, threads);
+        if (!backend.empty()) {
+            engine_cmd(lc0, ("setoption name Backend value " + backend).c_str());
+        }
+        // Only the background search adds to the tree between moves
+        engine_cmd(lc0, "setoption name TreeForestSize value 0");
+        engine_cmd(lc0, ("setoption name BackgroundSearchVisits value " + std::to_string(visits)).c_str());
+        engine_cmd(lc0, ("setoption name BackgroundSearchCpuShare value " + std::to_string(share)).c_str());
+        engine_cmd(lc0, "isready");
+        engine_cmd(lc0, "ucinewgame");
+
+        std::cout << "BackgroundSearchVisits " << visits << ", share " << share << "%, idle "
+                  << idleMs << " ms, " << goCmd << std::endl;
+        std::string line;
+        uint64_t reused = 0, playouts = 0, background = 0;
+        double ms = 0, laterMs = 0;
+        for (int i = 0; i < moves; i++) {
+            const MoveResult r = searchMove(lc0, line, goCmd);
+            if (r.bestmove.empty() || r.bestmove == "(none)" || r.ponder.empty()) {
+                break;
+            }
+            // The opponent thinks
+            std::this_thread::sleep_for(std::chrono::milliseconds(idleMs));
+            EngineSearchStats stats {};
+            engine_getSearchStats(lc0, &stats);
+
+            const uint64_t moveReused = r.total > r.playouts ? r.total - r.playouts : 0;
+            reused += moveReused;
+            playouts += r.playouts;
+            background += stats.backgroundNodes;
+            ms += r.ms;
+            if (i > 0) {
+                laterMs += r.ms;
+            }
+            snprintf(buf, sizeof(buf), "  %-12s  reused %9llu  playouts %9llu  to %llu visits %8.1f ms  background %9llu",
+                     (r.bestmove + " " + r.ponder).c_str(), (unsigned long long)moveReused,
+                     (unsigned long long)r.playouts, (unsigned long long)lc0Nodes, r.ms,
+                     (unsigned long long)stats.backgroundNodes);
+            std::cout << buf << std::endl;
+            line += " " + r.bestmove + " " + r.ponder;
+        }
+        snprintf(buf, sizeof(buf), "  %-12s  reused %9llu  playouts %9llu  to %llu visits %8.1f ms  background %9llu",
+                 "total", (unsigned long long)reused, (unsigned long long)playouts,
+                 (unsigned long long)lc0Nodes, ms, (unsigned long long)background);
+        std::cout << buf << std::endl;
+        snprintf(buf, sizeof(buf), "  %-12s  to %llu visits %8.1f ms", "after move 1",
+                 (unsigned long long)lc0Nodes, laterMs);
+        std::cout << buf << std::endl;
+
+        // Ends the background search and waits for the search threads
+        engine_cmd(lc0, "ucinewgame");
+    }
+    return 0;
+}
+
+} // namespace bench
@@ -0,0 +1,142 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include "bench.h"
+#include "../engines-bridging-header.h"
+
+/// Test hook of lc0_main.cc, not part of the app: ends the last search and
+/// checks the visit counts of its tree
+extern "C" void lc0_checkTree(unsigned long long* nodes, unsigned long long* errors,
+                              unsigned long long* rootVisits, unsigned long long* playouts);
+
+namespace bench {
+
+namespace {
+
+struct BackupResult {
+    double seconds = 0;
+    unsigned long long nodes = 0, errors = 0, rootVisits = 0, playouts = 0;
+};
+
+BackupResult searchPosition(const std::string& fen, const std::string& goCmd)
+{
+    engine_clearAllMessages(lc0);
+    engine_cmd(lc0, "ucinewgame");
+    engine_cmd(lc0, ("position fen " + fen).c_str());
+
+    const auto start = std::chrono::steady_clock::now();
+    engine_cmd(lc0, goCmd.c_str());
+    for (;;) {
+        auto msg = engine_getSearchMessage(lc0);
+        if (!msg) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (std::string(msg).compare(0, 8, "bestmove") == 0) {
+            break;
+        }
+    }
+
+    BackupResult result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    // Also the playouts of a batch backed up after bestmove
+    lc0_checkTree(&result.nodes, &result.errors, &result.rootVisits, &result.playouts);
+    return result;
+}
+
+} // namespace
+
+/// bsgbench backup [-threads 1,2,4,8] [-lc0nodes 20000] [-positions 4]
+///                 [-lc0backend random] [-lc0net file]
+/// Lc0 searches of the search suite with each number of threads. After every
+/// search the whole tree is checked: N of each node is one more than the
+/// visits of its children, no visit is left in flight and the root has as
+/// many visits as the search had playouts, the tree being new
+int backupMain(const std::vector<std::string>& args)
+{
+    std::vector<int> threadList { 1, 2, 4, 8 };
+    uint64_t lc0Nodes = 20000;
+    int positions = 4;
+    std::string backend = "random", net;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-threads") {
+            threadList = parseList(args[i + 1]);
+        } else if (args[i] == "-lc0nodes") {
+            lc0Nodes = std::stoull(args[i + 1]);
+        } else if (args[i] == "-positions") {
+            positions = std::stoi(args[i + 1]);
+        } else if (args[i] == "-lc0backend") {
+            backend = args[i + 1];
+        } else if (args[i] == "-lc0net") {
+            net = args[i + 1];
+        } else {
+            std::cerr << "Unknown backup option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    engine_setMessageEcho(0);
+    const std::string goCmd = "go nodes " + std::to_string(lc0Nodes);
+    int errors = 0;
+    char buf[256];
+    for (int threads : threadList) {
+        setNetworkPath(lc0, net.empty() ? "<autodiscover>" : net.c_str());
+        engine_initialize(lc0, threads);
+        if (!backend.empty()) {
+            engine_cmd(lc0, ("setoption name Backend value " + backend).c_str());
+        }
+        // Every search starts from scratch, so the root visits are the playouts
+        engine_cmd(lc0, "setoption name TreeForestSize value 0");
+        engine_cmd(lc0, "isready");
+
+        BackupResult total;
+        int failed = 0;
+        for (int i = 0; i < positions && i < int(searchSuite.size()); i++) {
+            const BackupResult r = searchPosition(searchSuite[i], goCmd);
+            total.playouts += r.playouts;
+            total.seconds += r.seconds;
+            total.nodes += r.nodes;
+            total.errors += r.errors;
+            if (r.errors || r.rootVisits != r.playouts) {
+                failed++;
+                std::cerr << "backup: " << searchSuite[i] << ": " << r.errors << " of " << r.nodes
+                          << " nodes wrong, root N " << r.rootVisits << " playouts " << r.playouts << std::endl;
+            }
+        }
+        errors += failed;
+
+        snprintf(buf, sizeof(buf), "threads %3d  playouts %8llu  nps %9.0f  nodes checked %9llu  %s",
+                 threads, total.playouts,
+                 total.seconds > 0 ? total.playouts / total.seconds : 0.0, total.nodes,
+                 failed ? "FAILED" : "OK");
+        std::cout << buf << std::endl;
+
+        engine_cmd(lc0, "ucinewgame");
+    }
+
+    std::cout << (errors ? "backup FAILED" : "backup OK") << std::endl;
+    return errors ? 1 : 0;
+}
+
+} // namespace bench
@@ -0,0 +1,158 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include "bench.h"
+
+#include "chess/lc0_board.h"
+#include "chess/lc0_position.h"
+#include "neural/lc0_encoder.h"
+#include "neural/lc0_factory.h"
+#include "utils/lc0_optionsdict.h"
+
+namespace bench {
+
+namespace {
+
+struct BatchingResult {
+    uint64_t evals = 0;
+    uint64_t batches = 0;
+    double seconds = 0;
+};
+
+/// @threads search-like clients, each sending batches of @batchSize copies of
+/// @input to @network and waiting for them, for @seconds
+BatchingResult runClients(lczero::Network* network, const lczero::InputPlanes& input,
+                          int threads, int batchSize, double seconds)
+{
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> batches(0);
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        clients.emplace_back([&]() {
+            uint64_t done = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                auto computation = network->NewComputation();
+                for (int i = 0; i < batchSize; i++) {
+                    computation->AddInput(lczero::InputPlanes(input));
+                }
+                computation->ComputeBlocking();
+                (void)computation->GetQVal(batchSize - 1);
+                done++;
+            }
+            batches += done;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& c : clients) {
+        c.join();
+    }
+
+    BatchingResult result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.batches = batches;
+    result.evals = result.batches * batchSize;
+    return result;
+}
+
+} // namespace
+
+/// bsgbench batching [-wrapper multiplexing,demux] [-backend random] [-threads 1,2,4,8]
+///                   [-nnthreads 1] [-batch 16] [-seconds 1]
+/// Throughput of the Lc0 batching wrappers against the number of threads
+/// feeding them. With the random backend (no delay) the computation costs
+/// next to nothing, so evals/s shows the cost of the hand-over between threads
+int batchingMain(const std::vector<std::string>& args)
+{
+    std::string wrapperList = "multiplexing,demux", backend = "random";
+    std::vector<int> threadList = { 1, 2, 4, 8 };
+    int nnThreads = 1, batchSize = 16;
+    double seconds = 1;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-wrapper") {
+            wrapperList = args[i + 1];
+        } else if (args[i] == "-backend") {
+            backend = args[i + 1];
+        } else if (args[i] == "-threads") {
+            threadList = parseList(args[i + 1]);
+        } else if (args[i] == "-nnthreads") {
+            nnThreads = std::stoi(args[i + 1]);
+        } else if (args[i] == "-batch") {
+            batchSize = std::stoi(args[i + 1]);
+        } else if (args[i] == "-seconds") {
+            seconds = std::stod(args[i + 1]);
+        } else {
+            std::cerr << "Unknown batching option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    lczero::InitializeMagicBitboards();
+
+    lczero::PositionHistory history;
+    history.Reset(lczero::ChessBoard(lczero::ChessBoard::kStartposFen), 0, 1);
+
+    char buf[256];
+    size_t pos = 0;
+    while (pos < wrapperList.size()) {
+        auto next = wrapperList.find(',', pos);
+        if (next == std::string::npos) {
+            next = wrapperList.size();
+        }
+        auto wrapper = wrapperList.substr(pos, next - pos);
+        pos = next + 1;
+
+        lczero::OptionsDict options;
+        options.Set<std::string>("backend", backend);
+        options.Set<int>("threads", nnThreads);
+        std::unique_ptr<lczero::Network> network;
+        try {
+            network = lczero::NetworkFactory::Get()->Create(wrapper, std::nullopt, options);
+        } catch (std::exception& e) {
+            std::cerr << wrapper << ": " << e.what() << std::endl;
+            return 1;
+        }
+        const auto input = lczero::EncodePositionForNN(network->GetCapabilities().input_format, history, 8,
+                                                       lczero::FillEmptyHistory::ALWAYS, nullptr);
+
+        std::cout << wrapper << " over " << backend << ", " << nnThreads << " nn threads, batch " << batchSize << std::endl;
+        double baseEvals = 0;
+        for (int threads : threadList) {
+            const BatchingResult r = runClients(network.get(), input, threads, batchSize, seconds);
+            const double evals = r.seconds > 0 ? r.evals / r.seconds : 0.0;
+            if (!baseEvals) {
+                baseEvals = evals;
+            }
+            snprintf(buf, sizeof(buf), "  threads %3d  evals/s %11.0f  batch latency %8.1f us  vs 1st %5.2f",
+                     threads, evals, r.batches ? r.seconds * threads * 1e6 / r.batches : 0.0,
+                     baseEvals > 0 ? evals / baseEvals : 0.0);
+            std::cout << buf << std::endl;
+        }
+    }
+    return 0;
+}
+
+} // namespace bench
@@ -0,0 +1,136 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include "bench.h"
+#include "../engines-bridging-header.h"
+
+namespace bench {
+
+namespace {
+
+struct CoroutineResult {
+    uint64_t playouts = 0;
+    double seconds = 0;
+};
+
+CoroutineResult searchPosition(int eid, const std::string& fen, const std::string& goCmd)
+{
+    engine_clearAllMessages(eid);
+    engine_cmd(eid, "ucinewgame");
+    engine_cmd(eid, ("position fen " + fen).c_str());
+
+    const auto start = std::chrono::steady_clock::now();
+    engine_cmd(eid, goCmd.c_str());
+    for (;;) {
+        auto msg = engine_getSearchMessage(eid);
+        if (!msg) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (std::string(msg).compare(0, 8, "bestmove") == 0) {
+            break;
+        }
+    }
+
+    CoroutineResult result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EngineSearchStats stats {};
+    engine_getSearchStats(eid, &stats);
+    result.playouts = stats.nodes;
+    return result;
+}
+
+} // namespace
+
+/// bsgbench coroutines [-coroutines 1,8] [-threads 1] [-lc0nodes 20000] [-positions 4]
+///                     [-minibatch 32] [-delay 5] [-maxbatch 256]
+/// Lc0 searches of the search suite over the multiplexing backend wrapping the
+/// random backend, which sleeps -delay ms per batch whatever its size, like a
+/// backend which is most efficient with large batches. With SearchCoroutines
+/// each search thread runs that many workers: while the batch of one is being
+/// computed the thread gathers the batches of the others, so the backend gets
+/// them all at once without one thread per worker
+int coroutinesMain(const std::vector<std::string>& args)
+{
+    std::vector<int> coroutinesList = { 1, 8 };
+    std::vector<int> threadsList = { 1 };
+    uint64_t lc0Nodes = 20000;
+    int positions = 4, minibatch = 32, delay = 5, maxBatch = 256;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-coroutines") {
+            coroutinesList = parseList(args[i + 1]);
+        } else if (args[i] == "-threads") {
+            threadsList = parseList(args[i + 1]);
+        } else if (args[i] == "-lc0nodes") {
+            lc0Nodes = std::stoull(args[i + 1]);
+        } else if (args[i] == "-positions") {
+            positions = std::stoi(args[i + 1]);
+        } else if (args[i] == "-minibatch") {
+            minibatch = std::stoi(args[i + 1]);
+        } else if (args[i] == "-delay") {
+            delay = std::stoi(args[i + 1]);
+        } else if (args[i] == "-maxbatch") {
+            maxBatch = std::stoi(args[i + 1]);
+        } else {
+            std::cerr << "Unknown coroutines option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    engine_setMessageEcho(0);
+    const std::string goCmd = "go nodes " + std::to_string(lc0Nodes);
+    const std::string backendOptions = "backend=random,threads=1,delay=" + std::to_string(delay)
+                                       + ",max_batch=" + std::to_string(maxBatch);
+    char buf[256];
+    for (int threads : threadsList) {
+        for (int coroutines : coroutinesList) {
+            setNetworkPath(lc0, "<autodiscover>");
+            engine_initialize(lc0, threads);
+            engine_cmd(lc0, "setoption name Backend value multiplexing");
+            engine_cmd(lc0, ("setoption name BackendOptions value " + backendOptions).c_str());
+            // Every search starts from scratch, without subtrees from the forest
+            engine_cmd(lc0, "setoption name TreeForestSize value 0");
+            engine_cmd(lc0, ("setoption name MinibatchSize value " + std::to_string(minibatch)).c_str());
+            engine_cmd(lc0, ("setoption name SearchCoroutines value " + std::to_string(coroutines)).c_str());
+            engine_cmd(lc0, "isready");
+
+            CoroutineResult total;
+            for (int i = 0; i < positions && i < int(searchSuite.size()); i++) {
+                const CoroutineResult r = searchPosition(lc0, searchSuite[i], goCmd);
+                total.playouts += r.playouts;
+                total.seconds += r.seconds;
+            }
+            snprintf(buf, sizeof(buf), "threads %3d  SearchCoroutines %3d  workers %4d  playouts %8llu  time %8.1f ms  nps %9.0f",
+                     threads, coroutines, threads * coroutines, (unsigned long long)total.playouts,
+                     total.seconds * 1000, total.seconds > 0 ? total.playouts / total.seconds : 0.0);
+            std::cout << buf << std::endl;
+
+            // Waits for the search threads
+            engine_cmd(lc0, "ucinewgame");
+        }
+    }
+    return 0;
+}
+
+} // namespace bench
@@ -0,0 +1,178 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include "bench.h"
+#include "../engines-bridging-header.h"
+
+namespace bench {
+
+namespace {
+
+/// A field of /proc/self/status in kB, 0 when not available
+long statusKb(const std::string& field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, field.size(), field) == 0) {
+            return std::stol(line.substr(field.size()));
+        }
+    }
+    return 0;
+}
+
+uint64_t treeBytes(int eid)
+{
+    EngineSearchStats stats {};
+    engine_getSearchStats(eid, &stats);
+    return stats.treeBytes;
+}
+
+struct GcResult {
+    uint64_t playouts = 0;
+    uint64_t bytes = 0;     // of the tree when bestmove came
+    double searchMs = 0;
+    double gcMs = 0;        // from ucinewgame until the tree is freed
+    long peakRssKb = 0;     // sampled while searching and freeing
+};
+
+GcResult searchAndDiscard(int eid, const std::string& fen, const std::string& goCmd)
+{
+    GcResult result;
+    const auto sampleRss = [&]() {
+        result.peakRssKb = std::max(result.peakRssKb, statusKb("VmRSS:"));
+    };
+    engine_clearAllMessages(eid);
+    engine_cmd(eid, ("position fen " + fen).c_str());
+
+    auto start = std::chrono::steady_clock::now();
+    engine_cmd(eid, goCmd.c_str());
+    for (;;) {
+        auto msg = engine_getSearchMessage(eid);
+        if (!msg) {
+            sampleRss();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (std::string(msg).compare(0, 8, "bestmove") == 0) {
+            break;
+        }
+    }
+    result.searchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    EngineSearchStats stats {};
+    engine_getSearchStats(eid, &stats);
+    result.playouts = stats.nodes;
+    result.bytes = stats.treeBytes;
+
+    // The whole tree goes to the garbage collector
+    sampleRss();
+    start = std::chrono::steady_clock::now();
+    engine_cmd(eid, "ucinewgame");
+    while (treeBytes(eid) > result.bytes / 100) {
+        sampleRss();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    result.gcMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+} // namespace
+
+/// bsgbench gc [-gcthreads 1,4] [-solidify 0,1] [-lc0nodes 200000] [-positions 4] [-threads 1]
+///             [-lc0backend random] [-lc0net file]
+/// Lc0 searches positions of the search suite and discards each tree with
+/// ucinewgame, for each GarbageCollectorThreads and BackgroundSolidify. gc is
+/// the time from ucinewgame until the tree memory is freed, rss how much the
+/// resident set size grew at its peak during the run
+int gcMain(const std::vector<std::string>& args)
+{
+    std::vector<int> gcThreadsList = { 1, 4 }, solidifyList = { 0, 1 };
+    uint64_t lc0Nodes = 200000;
+    int positions = 4, threads = 1;
+    std::string backend = "random", net;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-gcthreads") {
+            gcThreadsList = parseList(args[i + 1]);
+        } else if (args[i] == "-solidify") {
+            solidifyList = parseList(args[i + 1]);
+        } else if (args[i] == "-lc0nodes") {
+            lc0Nodes = std::stoull(args[i + 1]);
+        } else if (args[i] == "-positions") {
+            positions = std::stoi(args[i + 1]);
+        } else if (args[i] == "-threads") {
+            threads = std::stoi(args[i + 1]);
+        } else if (args[i] == "-lc0backend") {
+            backend = args[i + 1];
+        } else if (args[i] == "-lc0net") {
+            net = args[i + 1];
+        } else {
+            std::cerr << "Unknown gc option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    engine_setMessageEcho(0);
+    const std::string goCmd = "go nodes " + std::to_string(lc0Nodes);
+    char buf[256];
+    for (int solidify : solidifyList) {
+        for (int gcThreads : gcThreadsList) {
+            setNetworkPath(lc0, net.empty() ? "<autodiscover>" : net.c_str());
+            engine_initialize(lc0, threads);
+            if (!backend.empty()) {
+                engine_cmd(lc0, ("setoption name Backend value " + backend).c_str());
+            }
+            // Nothing of a discarded tree is kept, and no NN cache grows
+            // along with the tree
+            engine_cmd(lc0, "setoption name TreeForestSize value 0");
+            engine_cmd(lc0, "setoption name NNCacheSize value 0");
+            engine_cmd(lc0, ("setoption name GarbageCollectorThreads value " + std::to_string(gcThreads)).c_str());
+            engine_cmd(lc0, ("setoption name BackgroundSolidify value " + std::string(solidify ? "true" : "false")).c_str());
+            engine_cmd(lc0, "isready");
+            engine_cmd(lc0, "ucinewgame");
+
+            const long startRssKb = statusKb("VmRSS:");
+            GcResult total;
+            double maxGcMs = 0;
+            for (int i = 0; i < positions && i < int(searchSuite.size()); i++) {
+                const GcResult r = searchAndDiscard(lc0, searchSuite[i], goCmd);
+                total.playouts += r.playouts;
+                total.bytes += r.bytes;
+                total.searchMs += r.searchMs;
+                total.gcMs += r.gcMs;
+                maxGcMs = std::max(maxGcMs, r.gcMs);
+                total.peakRssKb = std::max(total.peakRssKb, r.peakRssKb);
+            }
+            const int n = std::max(1, std::min(positions, int(searchSuite.size())));
+            snprintf(buf, sizeof(buf), "GarbageCollectorThreads %2d  BackgroundSolidify %d  nps %8.0f  tree %7.1f MiB  gc avg %7.1f ms  max %7.1f ms  rss +%7ld kB",
+                     gcThreads, solidify, total.searchMs > 0 ? total.playouts * 1000.0 / total.searchMs : 0.0,
+                     total.bytes / 1048576.0 / n, total.gcMs / n, maxGcMs, total.peakRssKb - startRssKb);
+            std::cout << buf << std::endl;
+        }
+    }
+    return 0;
+}
+
+} // namespace bench
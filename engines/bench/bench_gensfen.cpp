@@ -0,0 +1,155 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "bench.h"
+#include "../engines-bridging-header.h"
+
+#include "rubichess/rubichess_RubiChess.h"
+
+void rubichess_initialize();
+
+using namespace rubichess;
+
+namespace bench {
+
+namespace {
+
+uint64_t fileSize(const std::string& file)
+{
+    std::ifstream in(file, std::ios::binary | std::ios::ate);
+    return in ? uint64_t(in.tellg()) : 0;
+}
+
+/// Number of positions in a bin file, binpack files are converted to bin first
+uint64_t countPositions(const std::string& file)
+{
+    std::string binFile = file;
+    if (file.find(".binpack") != std::string::npos) {
+        binFile = file + ".bin";
+        std::remove(binFile.c_str());
+        convert({ "input_file_name", file, "output_file_name", binFile, "output_format", "bin" });
+    }
+    const uint64_t positions = fileSize(binFile) / sizeof(PackedSfenValue);
+    if (binFile != file) {
+        std::remove(binFile.c_str());
+    }
+    return positions;
+}
+
+void setOptions(const std::string& options)
+{
+    std::istringstream in(options);
+    std::string option;
+    while (std::getline(in, option, ',')) {
+        auto eq = option.find('=');
+        if (eq != std::string::npos) {
+            en.ucioptions.Set(option.substr(0, eq), option.substr(eq + 1));
+        }
+    }
+}
+
+} // namespace
+
+/// bsgbench gensfen [-threads 1,2,4] [-positions 20000] [-depth 4] [-out gensfen.binpack]
+///                  [-hashmb 128] [-net file] [-book file] [-rubioptions Name=value,...]
+/// RubiChess training data generation with each thread count, the output is
+/// written from scratch each time and read back. Positions per second should
+/// grow with the threads as the generators share nothing but the dedup hash.
+/// The time runs from starting the generators until the writer has finished
+int gensfenMain(const std::vector<std::string>& args)
+{
+    std::vector<int> threadList = { 1 };
+    uint64_t positions = 20000;
+    int depth = 4;
+    std::string outFile = "gensfen.binpack", hashMb = "128", net, book, rubiOptions;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-threads") {
+            threadList = parseList(args[i + 1]);
+        } else if (args[i] == "-positions") {
+            positions = std::stoull(args[i + 1]);
+        } else if (args[i] == "-depth") {
+            depth = std::stoi(args[i + 1]);
+        } else if (args[i] == "-out") {
+            outFile = args[i + 1];
+        } else if (args[i] == "-hashmb") {
+            hashMb = args[i + 1];
+        } else if (args[i] == "-net") {
+            net = args[i + 1];
+        } else if (args[i] == "-book") {
+            book = args[i + 1];
+        } else if (args[i] == "-rubioptions") {
+            rubiOptions = args[i + 1];
+        } else {
+            std::cerr << "Unknown gensfen option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    engine_setMessageEcho(0);
+    rubichess_initialize();
+    if (!net.empty()) {
+        en.ucioptions.Set("NNUENetpath", net);
+    } else {
+        en.ucioptions.Set("Use_NNUE", "false");
+    }
+    setOptions(rubiOptions);
+
+    std::vector<std::string> gensfenArgs = { "depth", std::to_string(depth), "depth2", std::to_string(depth),
+                                             "loop", std::to_string(positions), "output_file_name", outFile,
+                                             "sfenhash_mb", hashMb };
+    if (!book.empty()) {
+        gensfenArgs.insert(gensfenArgs.end(), { "book", book });
+    }
+
+    int errors = 0;
+    double basePps = 0;
+    char buf[256];
+    std::ostringstream report;
+    for (int threads : threadList) {
+        en.ucioptions.Set("Threads", std::to_string(threads));
+        std::remove(outFile.c_str());
+
+        U64 elapsedMs = 0;
+        const uint64_t generated = gensfen(gensfenArgs, &elapsedMs);
+        const double seconds = elapsedMs / 1000.0;
+        const uint64_t found = countPositions(outFile);
+        const bool ok = generated >= positions && found == generated;
+        errors += !ok;
+
+        const double pps = seconds > 0 ? generated / seconds : 0.0;
+        if (!basePps) {
+            basePps = pps / threads;
+        }
+        snprintf(buf, sizeof(buf), "threads %3d  positions %9llu  %8.3f s  %9.0f pps  scaling %5.2f  file %9llu bytes  read back %9llu %s",
+                 threads, (unsigned long long)generated, seconds, pps, basePps > 0 ? pps / basePps : 0.0,
+                 (unsigned long long)fileSize(outFile), (unsigned long long)found, ok ? "OK" : "FAILED");
+        report << buf << "\n";
+    }
+    std::remove(outFile.c_str());
+
+    std::cout << "\n" << report.str() << (errors ? "gensfen FAILED" : "gensfen OK") << std::endl;
+    return errors ? 1 : 0;
+}
+
+} // namespace bench
@@ -0,0 +1,129 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// bsgbench: command line benchmarks of the integrated engines, for Linux
+/// hosts. It links the same engine code as the app (engines.cpp included)
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+static void usage()
+{
+    std::cout << "Usage: bsgbench <mode> [options]\n"
+              << "  perft   [-engine stockfish,lc0,rubi] [-depth 5] [-threads 1,2,4] [-hash 0]\n"
+              << "  search  [-engine stockfish,lc0,rubi] [-threads 1] [-depth 12] [-nodes 0] [-movetime 0]\n"
+              << "          [-lc0nodes 800] [-positions 22] [-sfnet file] [-lc0net file] [-rubinet file]\n"
+              << "          [-lc0backend name] [-lc0options Name=value,...] [-rubioptions Name=value,...]\n"
+              << "          [-taskworkers 0,1,2] [-suite default|tb]\n"
+              << "          [-tbpath dir] [-json bsgbench.json]\n"
+              << "  backend [-backend random,trivial,eigen] [-net file] [-maxbatch 64] [-batches 100]\n"
+              << "  batching [-wrapper multiplexing,demux] [-backend random] [-threads 1,2,4,8] [-nnthreads 1]\n"
+              << "          [-batch 16] [-seconds 1]\n"
+              << "  backup  [-threads 1,2,4,8] [-lc0nodes 20000] [-positions 4]\n"
+              << "          [-lc0backend random] [-lc0net file]\n"
+              << "  reuse   [-forest 0,200000] [-lc0nodes 2000] [-threads 1] [-lc0backend random] [-lc0net file]\n"
+              << "  tt      [-ttmb 0,64] [-lc0nodes 5000] [-threads 1] [-lc0backend random] [-lc0net file]\n"
+              << "  prefetch [-maxprefetch 0,32] [-lc0nodes 2000] [-positions 6] [-minibatch 7] [-delay 2]\n"
+              << "          [-threads 1] [-lc0backend random] [-lc0net file]\n"
+              << "  background [-visits 0,50000] [-share 25] [-idle 200] [-moves 8] [-lc0nodes 2000]\n"
+              << "          [-threads 1] [-lc0backend random] [-lc0net file]\n"
+              << "  treemem [-mb 0,8] [-moves 4] [-searches 2] [-lc0nodes 50000] [-threads 1]\n"
+              << "          [-lc0backend random] [-lc0net file]\n"
+              << "  gc      [-gcthreads 1,4] [-solidify 0,1] [-lc0nodes 200000] [-positions 4] [-threads 1]\n"
+              << "          [-lc0backend random] [-lc0net file]\n"
+              << "  puct    [-vectorized 0,1] [-solid 100] [-lc0nodes 200000] [-positions 4] [-threads 1]\n"
+              << "          [-lc0backend random] [-lc0net file]\n"
+              << "  coroutines [-coroutines 1,8] [-threads 1] [-lc0nodes 20000] [-positions 4] [-minibatch 32]\n"
+              << "          [-delay 5] [-maxbatch 256]\n"
+              << "  tb      -path dir [-engine stockfish,lc0,rubi] [-rounds 1000]\n"
+              << "  nnue    [-engine stockfish,rubi] [-net file] [-sfnet file] [-depth 3] [-positions 4] [-native file]\n"
+              << "  gensfen [-threads 1,2,4] [-positions 20000] [-depth 4] [-out gensfen.binpack] [-hashmb 128]\n"
+              << "          [-net file] [-book file] [-rubioptions Name=value,...]\n"
+              << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        usage();
+        return 2;
+    }
+
+    std::string mode = argv[1];
+    std::vector<std::string> args(argv + 2, argv + argc);
+
+    try {
+        if (mode == "perft") {
+            return bench::perftMain(args);
+        }
+        if (mode == "search") {
+            return bench::searchMain(args);
+        }
+        if (mode == "backend") {
+            return bench::backendMain(args);
+        }
+        if (mode == "batching") {
+            return bench::batchingMain(args);
+        }
+        if (mode == "backup") {
+            return bench::backupMain(args);
+        }
+        if (mode == "reuse") {
+            return bench::reuseMain(args);
+        }
+        if (mode == "tt") {
+            return bench::ttMain(args);
+        }
+        if (mode == "prefetch") {
+            return bench::prefetchMain(args);
+        }
+        if (mode == "background") {
+            return bench::backgroundMain(args);
+        }
+        if (mode == "treemem") {
+            return bench::treeMemoryMain(args);
+        }
+        if (mode == "gc") {
+            return bench::gcMain(args);
+        }
+        if (mode == "puct") {
+            return bench::puctMain(args);
+        }
+        if (mode == "coroutines") {
+            return bench::coroutinesMain(args);
+        }
+        if (mode == "tb") {
+            return bench::tbMain(args);
+        }
+        if (mode == "nnue") {
+            return bench::nnueMain(args);
+        }
+        if (mode == "gensfen") {
+            return bench::gensfenMain(args);
+        }
+    } catch (std::exception& e) {
+        std::cerr << "bsgbench: " << e.what() << std::endl;
+        return 2;
+    }
+
+    usage();
+    return 2;
+}
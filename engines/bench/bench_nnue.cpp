@@ -0,0 +1,271 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#include "bench.h"
+#include "../engines-bridging-header.h"
+#include "../simdkernels.h"
+
+#include "rubichess/rubichess_RubiChess.h"
+
+void rubichess_initialize();
+
+using namespace rubichess;
+
+namespace bench {
+
+namespace {
+
+/// Appends the raw bytes of @value
+template<typename T>
+void put(std::vector<unsigned char>& buf, T value)
+{
+    auto p = (const unsigned char*)&value;
+    buf.insert(buf.end(), p, p + sizeof(T));
+}
+
+uint32_t layerHash(uint32_t prev, uint32_t outputdims)
+{
+    return (NNUENETLAYERHASH + outputdims) ^ (prev >> 1) ^ (prev << 31);
+}
+
+/// A random network of the RubiChess V5-1024 layout (HalfKAv2_hm, 1024x16+16x32x1,
+/// 8 layer stacks). The feature biases are negative so that about a fifth of the
+/// 4 byte input blocks of the first layer are nonzero, as with trained nets
+bool loadRandomNet(uint32_t seed)
+{
+    constexpr uint32_t ftDims = 1024, ftInputs = 64 * 11 * 64 / 2, psqtBuckets = 8, stacks = 8;
+    constexpr uint32_t hidden1 = 16, hidden1Out = 15, hidden2 = 32;
+
+    const uint32_t ftHash = NNUEFEATUTEHASH_HalfKAv2_hm ^ (ftDims * 2);
+    uint32_t netHash = NNUEINPUTSLICEHASH ^ (ftDims * 2);
+    netHash = NNUECLIPPEDRELUHASH + layerHash(netHash, hidden1);
+    netHash = NNUECLIPPEDRELUHASH + layerHash(netHash, hidden2);
+    netHash = layerHash(netHash, 1);
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> ftBias(-120, -20), ftWeight(-32, 32), psqt(-500, 500), weight(-64, 64), bias(-1000, 1000);
+
+    const std::string arch = "bsgbench random net";
+    std::vector<unsigned char> buf;
+    buf.reserve(size_t(ftInputs) * ftDims * 2 + (1 << 20));
+    put(buf, NNUEFILEVERSIONSFNNv5_1024);
+    put(buf, ftHash ^ netHash);
+    put(buf, uint32_t(arch.size()));
+    buf.insert(buf.end(), arch.begin(), arch.end());
+
+    put(buf, ftHash);
+    for (uint32_t i = 0; i < ftDims; i++) put(buf, int16_t(ftBias(rng)));
+    for (uint32_t i = 0; i < ftInputs * ftDims; i++) put(buf, int16_t(ftWeight(rng)));
+    for (uint32_t i = 0; i < ftInputs * psqtBuckets; i++) put(buf, int32_t(psqt(rng)));
+
+    for (uint32_t s = 0; s < stacks; s++) {
+        put(buf, netHash);
+        for (uint32_t i = 0; i < hidden1; i++) put(buf, int32_t(bias(rng)));
+        for (uint32_t i = 0; i < hidden1 * ftDims; i++) put(buf, int8_t(weight(rng)));
+        for (uint32_t i = 0; i < hidden2; i++) put(buf, int32_t(bias(rng)));
+        for (uint32_t r = 0; r < hidden2; r++) {
+            for (uint32_t c = 0; c < 32; c++) put(buf, int8_t(c < hidden1Out * 2 ? weight(rng) : 0));
+        }
+        put(buf, int32_t(bias(rng)));
+        for (uint32_t i = 0; i < hidden2; i++) put(buf, int8_t(weight(rng)));
+    }
+
+    NnueNetsource nr;
+    nr.readbuffersize = buf.size();
+    nr.readbuffer = (unsigned char*)allocalign64(buf.size());
+    memcpy(nr.readbuffer, buf.data(), buf.size());
+    nr.next = nr.readbuffer;
+    return NnueReadNet(&nr);
+}
+
+/// Walks the perft tree like engine::perft and adds up the NNUE evaluation of
+/// every node, the accumulators are updated incrementally as in a search
+template<bool Evaluate>
+int64_t evalPerft(chessposition* pos, int depth, uint64_t& nodes)
+{
+    nodes++;
+    int64_t sum = (Evaluate ? pos->NnueGetEval() : 0);
+    if (depth == 0)
+        return sum;
+
+    chessmovelist movelist;
+    if (pos->isCheckbb)
+        movelist.length = pos->CreateEvasionMovelist(&movelist.move[0]);
+    else
+        movelist.length = pos->CreateMovelist<ALL>(&movelist.move[0]);
+    pos->prepareStack();
+
+    for (int i = 0; i < movelist.length; i++)
+    {
+        if (pos->playMove<false>(movelist.move[i].code))
+        {
+            sum += evalPerft<Evaluate>(pos, depth - 1, nodes);
+            pos->unplayMove<false>(movelist.move[i].code);
+        }
+    }
+    return sum;
+}
+
+class RubiChessNnue : public NnueEngine {
+public:
+    const char* name() const override { return "rubichess"; }
+
+    bool load(const std::string& net) override {
+        rubichess_initialize();
+        if (!net.empty()) {
+            en.ucioptions.Set("NNUENetpath", net);
+        } else if (!loadRandomNet(1)) {
+            return false;
+        }
+        return NnueReady;
+    }
+
+    std::string description() override { return NnueCurrentArch->GetArchName(); }
+
+    bool exportNative(const std::string& file) override {
+        NnueWriteNet({ file, "native" });
+        return std::ifstream(file).good();
+    }
+
+    Walk walk(bool evaluate, int depth, int positions) override {
+        Walk result;
+        chessposition* pos = &en.sthread[0].pos;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < positions && i < int(perftSuite.size()); i++) {
+            pos->getFromFen(perftSuite[i].fen.c_str());
+            result.checksum += evaluate ? evalPerft<true>(pos, depth, result.nodes)
+                                        : evalPerft<false>(pos, depth, result.nodes);
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+};
+
+} // namespace
+
+/// bsgbench nnue [-engine stockfish,rubi] [-net file] [-sfnet file] [-depth 3] [-positions 4] [-native file]
+/// NNUE evaluation of every node of perft trees with each kernel level of
+/// simdkernels.h the machine supports. All levels must give the same sum.
+/// With -native the net is exported to file.<engine> in the native format,
+/// loaded again and must give the same sum
+int nnueMain(const std::vector<std::string>& args)
+{
+    std::string engineNames = "stockfish,rubi", rubiNet, sfNet, nativeFile;
+    int depth = 3, positions = 4;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-engine") {
+            engineNames = args[i + 1];
+        } else if (args[i] == "-net") {
+            rubiNet = args[i + 1];
+        } else if (args[i] == "-sfnet") {
+            sfNet = args[i + 1];
+        } else if (args[i] == "-depth") {
+            depth = std::stoi(args[i + 1]);
+        } else if (args[i] == "-positions") {
+            positions = std::stoi(args[i + 1]);
+        } else if (args[i] == "-native") {
+            nativeFile = args[i + 1];
+        } else {
+            std::cerr << "Unknown nnue option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    RubiChessNnue rubiNnue;
+    std::vector<std::pair<NnueEngine*, std::string>> engines;
+    if (engineNames.find("stockfish") != std::string::npos) engines.push_back({ stockfishNnueEngine(), sfNet });
+    if (engineNames.find("rubi") != std::string::npos) engines.push_back({ &rubiNnue, rubiNet });
+
+    engine_setMessageEcho(0);
+    std::cout << "cpu " << cinfo.PrintCpuFeatures(cinfo.machineSupports) << std::endl;
+
+    const int best = simd_level();
+    int errors = 0;
+    char buf[256];
+    for (auto&& e : engines) {
+        NnueEngine* engine = e.first;
+        auto start = std::chrono::steady_clock::now();
+        if (!engine->load(e.second)) {
+            std::cerr << engine->name() << ": cannot load " << (e.second.empty() ? "the random network" : e.second) << std::endl;
+            errors++;
+            continue;
+        }
+        const double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << engine->name() << " net " << (e.second.empty() ? "random" : e.second) << " (" << engine->description() << ")"
+                  << " loaded in " << int(loadMs) << " ms" << std::endl;
+
+        // Move generation and make/unmake alone, subtracted from the timings below
+        const NnueEngine::Walk base = engine->walk(false, depth, positions);
+
+        double defaultNs = 0;
+        int64_t expected = 0;
+        for (int level = SimdDefault; level < SimdLevelNum; level++) {
+            if (!simd_supported(level)) {
+                continue;
+            }
+            simd_setLevel(level);
+            engine->walk(true, depth, 1);   // warm up caches
+            const NnueEngine::Walk r = engine->walk(true, depth, positions);
+            const double ns = std::max(0.0, r.seconds - base.seconds) * 1e9 / r.nodes;
+            if (level == SimdDefault) {
+                defaultNs = ns;
+                expected = r.checksum;
+            }
+            const bool ok = (r.checksum == expected);
+            errors += !ok;
+
+            snprintf(buf, sizeof(buf), "  %-11s evals %9llu  %9.0f evals/s  eval %7.1f ns  speedup %5.2f  checksum %lld %s%s",
+                     simd_levelName(level), (unsigned long long)r.nodes,
+                     r.seconds > 0 ? r.nodes / r.seconds : 0.0, ns, ns > 0 ? defaultNs / ns : 0.0,
+                     (long long)r.checksum, ok ? "OK" : "FAILED", level == best ? "  (selected)" : "");
+            std::cout << buf << std::endl;
+        }
+        simd_setLevel(best);
+
+        if (!nativeFile.empty()) {
+            const std::string file = nativeFile + "." + engine->name();
+            if (!engine->exportNative(file)) {
+                std::cerr << engine->name() << ": cannot export the native network " << file << std::endl;
+                errors++;
+                continue;
+            }
+            start = std::chrono::steady_clock::now();
+            const bool loaded = engine->load(file);
+            const double nativeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            const NnueEngine::Walk r = loaded ? engine->walk(true, depth, positions) : NnueEngine::Walk();
+            const bool ok = loaded && r.checksum == expected;
+            errors += !ok;
+            std::cout << "  native " << file << " loaded in " << int(nativeMs) << " ms  checksum " << r.checksum
+                      << (ok ? " OK" : " FAILED") << std::endl;
+        }
+    }
+
+    std::cout << (errors ? "nnue FAILED" : "nnue OK") << std::endl;
+    return errors ? 1 : 0;
+}
+
+} // namespace bench
@@ -0,0 +1,221 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include "bench.h"
+
+namespace bench {
+
+void PerftHash::resize(size_t mb)
+{
+    table.reset();
+    mask = 0;
+    if (!mb) {
+        return;
+    }
+
+    size_t count = 1;
+    while (count * 2 * sizeof(Entry) <= mb * 1024 * 1024) {
+        count *= 2;
+    }
+    table.reset(new Entry[count]);
+    mask = count - 1;
+    clear();
+}
+
+void PerftHash::clear()
+{
+    for (uint64_t i = 0; mask && i <= mask; ++i) {
+        table[i].check.store(0, std::memory_order_relaxed);
+        table[i].nodes.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool PerftHash::probe(uint64_t key, int depth, uint64_t& nodes) const
+{
+    auto k = depthKey(key, depth);
+    auto& e = table[k & mask];
+    auto n = e.nodes.load(std::memory_order_relaxed);
+    auto c = e.check.load(std::memory_order_relaxed);
+    if (n && (c ^ n) == k) {
+        nodes = n;
+        return true;
+    }
+    return false;
+}
+
+void PerftHash::store(uint64_t key, int depth, uint64_t nodes)
+{
+    auto k = depthKey(key, depth);
+    auto& e = table[k & mask];
+    e.check.store(k ^ nodes, std::memory_order_relaxed);
+    e.nodes.store(nodes, std::memory_order_relaxed);
+}
+
+
+/// Same positions as RubiChess perftest, counts are indexed by depth
+const std::vector<PerftPosition> perftSuite = {
+    {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        { 1, 20, 400, 8902, 197281, 4865609, 119060324 }
+    },
+    {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        { 1, 48, 2039, 97862, 4085603, 193690690 }
+    },
+    {
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        { 1, 14, 191, 2812, 43238, 674624, 11030083, 178633661 }
+    },
+    {
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        { 1, 6, 264, 9467, 422333, 15833292, 706045033 }
+    },
+    {
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        { 1, 44, 1486, 62379, 2103487, 89941194 }
+    },
+    {
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        { 1, 46, 2079, 89890, 3894594, 164075551, 6923051137 }
+    },
+};
+
+
+PerftResult perft(PerftEngine& engine, const std::string& fen, int depth,
+                  int threads, PerftHash* hash)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const int moveCount = engine.rootMoveCount(fen);
+
+    uint64_t nodes = 0;
+    if (depth <= 1) {
+        nodes = depth == 1 ? moveCount : 1;
+    } else {
+        std::atomic<int> nextMove { 0 };
+        std::atomic<uint64_t> total { 0 };
+
+        auto worker = [&](int idx) {
+            uint64_t cnt = 0;
+            for (int i = nextMove++; i < moveCount; i = nextMove++) {
+                cnt += engine.perftRootMove(idx, fen, i, depth - 1, hash);
+            }
+            total += cnt;
+        };
+
+        std::vector<std::thread> workers;
+        for (int i = 1; i < threads; ++i) {
+            workers.emplace_back(worker, i);
+        }
+        worker(0);
+        for (auto&& th : workers) {
+            th.join();
+        }
+        nodes = total;
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    return { nodes, std::chrono::duration<double>(end - start).count() };
+}
+
+
+std::vector<int> parseList(const std::string& str)
+{
+    std::vector<int> vec;
+    size_t pos = 0;
+    while (pos < str.size()) {
+        auto next = str.find(',', pos);
+        if (next == std::string::npos) {
+            next = str.size();
+        }
+        vec.push_back(std::stoi(str.substr(pos, next - pos)));
+        pos = next + 1;
+    }
+    return vec;
+}
+
+/// bsgbench perft [-engine stockfish,lc0,rubi] [-depth 5] [-threads 1,2,4] [-hash 0]
+/// Returns non-zero if any generator miscounts, so it can gate movegen changes
+int perftMain(const std::vector<std::string>& args)
+{
+    std::string engineNames = "stockfish,lc0,rubi";
+    int depth = 5;
+    std::vector<int> threadList { 1, 2, 4 };
+    int hashMb = 0;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-engine") {
+            engineNames = args[i + 1];
+        } else if (args[i] == "-depth") {
+            depth = std::stoi(args[i + 1]);
+        } else if (args[i] == "-threads") {
+            threadList = parseList(args[i + 1]);
+        } else if (args[i] == "-hash") {
+            hashMb = std::stoi(args[i + 1]);
+        } else {
+            std::cerr << "Unknown perft option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    std::vector<PerftEngine*> engines;
+    if (engineNames.find("stockfish") != std::string::npos) engines.push_back(stockfishPerftEngine());
+    if (engineNames.find("lc0") != std::string::npos) engines.push_back(lc0PerftEngine());
+    if (engineNames.find("rubi") != std::string::npos) engines.push_back(rubichessPerftEngine());
+
+    PerftHash hash;
+    hash.resize(hashMb);
+
+    int errors = 0;
+    char buf[256];
+    for (auto engine : engines) {
+        for (auto threads : threadList) {
+            engine->setThreads(threads);
+            hash.clear();
+
+            uint64_t totalNodes = 0;
+            double totalTime = 0;
+            for (auto&& p : perftSuite) {
+                int d = std::min(depth, int(p.nodes.size()) - 1);
+                auto r = perft(*engine, p.fen, d, threads, hash.enabled() ? &hash : nullptr);
+                totalNodes += r.nodes;
+                totalTime += r.seconds;
+                if (r.nodes != p.nodes[d]) {
+                    errors++;
+                    std::cerr << engine->name() << ": perft " << d << " of " << p.fen
+                              << " is " << r.nodes << ", expected " << p.nodes[d] << std::endl;
+                }
+            }
+
+            snprintf(buf, sizeof(buf), "%-10s threads %3d  hash %5d MB  nodes %12llu  time %8.3f s  %9.2f Mnodes/s",
+                     engine->name(), threads, hashMb, (unsigned long long)totalNodes, totalTime,
+                     totalTime > 0 ? totalNodes / totalTime / 1e6 : 0.0);
+            std::cout << buf << std::endl;
+        }
+    }
+
+    std::cout << (errors ? "perft FAILED" : "perft OK") << std::endl;
+    return errors ? 1 : 0;
+}
+
+} // namespace bench
@@ -0,0 +1,145 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include "bench.h"
+#include "../engines-bridging-header.h"
+
+namespace bench {
+
+namespace {
+
+struct PrefetchResult {
+    uint64_t playouts = 0;
+    uint64_t prefetched = 0;
+    uint64_t used = 0;
+    double seconds = 0;
+};
+
+PrefetchResult searchPosition(int eid, const std::string& fen, const std::string& goCmd)
+{
+    engine_clearAllMessages(eid);
+    engine_cmd(eid, "ucinewgame");
+    engine_cmd(eid, ("position fen " + fen).c_str());
+
+    const auto start = std::chrono::steady_clock::now();
+    engine_cmd(eid, goCmd.c_str());
+    for (;;) {
+        auto msg = engine_getSearchMessage(eid);
+        if (!msg) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (std::string(msg).compare(0, 8, "bestmove") == 0) {
+            break;
+        }
+    }
+
+    PrefetchResult result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EngineSearchStats stats {};
+    engine_getSearchStats(eid, &stats);
+    result.playouts = stats.nodes;
+    result.prefetched = stats.prefetchEvals;
+    result.used = stats.prefetchUsed;
+    return result;
+}
+
+} // namespace
+
+/// bsgbench prefetch [-maxprefetch 0,32] [-lc0nodes 2000] [-positions 6] [-minibatch 7] [-delay 2]
+///                   [-threads 1] [-lc0backend random] [-lc0net file]
+/// Lc0 searches of the search suite with each MaxPrefetch. The random backend
+/// sleeps -delay ms per batch whatever its size, like a small-batch backend
+/// whose idle slots cost nothing, so prefetches which the search uses later
+/// raise the playouts per second
+int prefetchMain(const std::vector<std::string>& args)
+{
+    std::vector<int> prefetchList = { 0, 32 };
+    uint64_t lc0Nodes = 2000;
+    int positions = 6, minibatch = 7, delay = 2, threads = 1;
+    std::string backend = "random", net;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-maxprefetch") {
+            prefetchList = parseList(args[i + 1]);
+        } else if (args[i] == "-lc0nodes") {
+            lc0Nodes = std::stoull(args[i + 1]);
+        } else if (args[i] == "-positions") {
+            positions = std::stoi(args[i + 1]);
+        } else if (args[i] == "-minibatch") {
+            minibatch = std::stoi(args[i + 1]);
+        } else if (args[i] == "-delay") {
+            delay = std::stoi(args[i + 1]);
+        } else if (args[i] == "-threads") {
+            threads = std::stoi(args[i + 1]);
+        } else if (args[i] == "-lc0backend") {
+            backend = args[i + 1];
+        } else if (args[i] == "-lc0net") {
+            net = args[i + 1];
+        } else {
+            std::cerr << "Unknown prefetch option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    engine_setMessageEcho(0);
+    const std::string goCmd = "go nodes " + std::to_string(lc0Nodes);
+    char buf[256];
+    for (int maxPrefetch : prefetchList) {
+        setNetworkPath(lc0, net.empty() ? "<autodiscover>" : net.c_str());
+        engine_initialize(lc0, threads);
+        if (!backend.empty()) {
+            engine_cmd(lc0, ("setoption name Backend value " + backend).c_str());
+        }
+        if (backend == "random") {
+            engine_cmd(lc0, ("setoption name BackendOptions value delay=" + std::to_string(delay)).c_str());
+        }
+        // Every search starts from scratch, without subtrees from the forest
+        engine_cmd(lc0, "setoption name TreeForestSize value 0");
+        engine_cmd(lc0, ("setoption name MinibatchSize value " + std::to_string(minibatch)).c_str());
+        engine_cmd(lc0, ("setoption name MaxPrefetch value " + std::to_string(maxPrefetch)).c_str());
+        engine_cmd(lc0, "isready");
+
+        PrefetchResult total;
+        for (int i = 0; i < positions && i < int(searchSuite.size()); i++) {
+            const PrefetchResult r = searchPosition(lc0, searchSuite[i], goCmd);
+            total.playouts += r.playouts;
+            total.prefetched += r.prefetched;
+            total.used += r.used;
+            total.seconds += r.seconds;
+        }
+        snprintf(buf, sizeof(buf), "MaxPrefetch %4d  playouts %8llu  time %8.1f ms  nps %8.0f  prefetched %7llu  used %7llu  wasted %7llu  used %5.1f%%",
+                 maxPrefetch, (unsigned long long)total.playouts, total.seconds * 1000,
+                 total.seconds > 0 ? total.playouts / total.seconds : 0.0,
+                 (unsigned long long)total.prefetched, (unsigned long long)total.used,
+                 (unsigned long long)(total.prefetched - total.used),
+                 total.prefetched ? 100.0 * total.used / total.prefetched : 0.0);
+        std::cout << buf << std::endl;
+
+        // Waits for the search threads
+        engine_cmd(lc0, "ucinewgame");
+    }
+    return 0;
+}
+
+} // namespace bench
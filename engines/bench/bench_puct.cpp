@@ -0,0 +1,152 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "bench.h"
+#include "../engines-bridging-header.h"
+
+namespace bench {
+
+namespace {
+
+struct PuctResult {
+    std::string bestmove;
+    uint64_t playouts = 0;
+    double seconds = 0;
+};
+
+PuctResult searchPosition(int eid, const std::string& fen, const std::string& goCmd)
+{
+    PuctResult result;
+    engine_clearAllMessages(eid);
+    engine_cmd(eid, "ucinewgame");
+    engine_cmd(eid, ("position fen " + fen).c_str());
+
+    const auto start = std::chrono::steady_clock::now();
+    engine_cmd(eid, goCmd.c_str());
+    for (;;) {
+        auto msg = engine_getSearchMessage(eid);
+        if (!msg) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        std::istringstream is(msg);
+        std::string token;
+        if (is >> token && token == "bestmove") {
+            is >> result.bestmove;
+            break;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    EngineSearchStats stats {};
+    engine_getSearchStats(eid, &stats);
+    result.playouts = stats.nodes;
+    return result;
+}
+
+} // namespace
+
+/// bsgbench puct [-vectorized 0,1] [-solid 100] [-lc0nodes 200000] [-positions 4] [-threads 1]
+///               [-lc0backend random] [-lc0net file]
+/// Lc0 searches of the search suite with VectorizedPuct off and on. With it
+/// the children of solidified nodes (SolidTreeThreshold visits) are scored
+/// several at a time with SIMD instructions. Over the random backend the
+/// search is mostly the walk down the tree, so nps shows the cost of the
+/// child selection. The scores are the same either way, so with one thread
+/// the searches must pick the same moves
+int puctMain(const std::vector<std::string>& args)
+{
+    std::vector<int> vectorizedList = { 0, 1 };
+    uint64_t lc0Nodes = 200000;
+    int solid = 100, positions = 4, threads = 1;
+    std::string backend = "random", net;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-vectorized") {
+            vectorizedList = parseList(args[i + 1]);
+        } else if (args[i] == "-solid") {
+            solid = std::stoi(args[i + 1]);
+        } else if (args[i] == "-lc0nodes") {
+            lc0Nodes = std::stoull(args[i + 1]);
+        } else if (args[i] == "-positions") {
+            positions = std::stoi(args[i + 1]);
+        } else if (args[i] == "-threads") {
+            threads = std::stoi(args[i + 1]);
+        } else if (args[i] == "-lc0backend") {
+            backend = args[i + 1];
+        } else if (args[i] == "-lc0net") {
+            net = args[i + 1];
+        } else {
+            std::cerr << "Unknown puct option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    engine_setMessageEcho(0);
+    const std::string goCmd = "go nodes " + std::to_string(lc0Nodes);
+    char buf[256];
+    std::string firstMoves;
+    bool mismatch = false;
+    for (size_t v = 0; v < vectorizedList.size(); v++) {
+        const bool vectorized = vectorizedList[v] != 0;
+        setNetworkPath(lc0, net.empty() ? "<autodiscover>" : net.c_str());
+        engine_initialize(lc0, threads);
+        if (!backend.empty()) {
+            engine_cmd(lc0, ("setoption name Backend value " + backend).c_str());
+        }
+        // Every search starts from scratch, without subtrees from the forest
+        engine_cmd(lc0, "setoption name TreeForestSize value 0");
+        engine_cmd(lc0, ("setoption name SolidTreeThreshold value " + std::to_string(solid)).c_str());
+        engine_cmd(lc0, ("setoption name VectorizedPuct value " + std::string(vectorized ? "true" : "false")).c_str());
+        engine_cmd(lc0, "isready");
+
+        PuctResult total;
+        std::string moves;
+        for (int i = 0; i < positions && i < int(searchSuite.size()); i++) {
+            const PuctResult r = searchPosition(lc0, searchSuite[i], goCmd);
+            total.playouts += r.playouts;
+            total.seconds += r.seconds;
+            moves += " " + r.bestmove;
+        }
+        snprintf(buf, sizeof(buf), "VectorizedPuct %d  playouts %9llu  time %8.1f ms  nps %9.0f  bestmoves%s",
+                 int(vectorized), (unsigned long long)total.playouts, total.seconds * 1000,
+                 total.seconds > 0 ? total.playouts / total.seconds : 0.0, moves.c_str());
+        std::cout << buf << std::endl;
+        if (v == 0) {
+            firstMoves = moves;
+        } else if (threads == 1 && moves != firstMoves) {
+            mismatch = true;
+        }
+
+        // Waits for the search threads
+        engine_cmd(lc0, "ucinewgame");
+    }
+    if (mismatch) {
+        std::cout << "Different best moves with one thread" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace bench
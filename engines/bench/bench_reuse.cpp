@@ -0,0 +1,159 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "bench.h"
+#include "../engines-bridging-header.h"
+
+namespace bench {
+
+namespace {
+
+/// An analysis session in the Four Knights: forward, to a variation and back,
+/// a takeback, a new game and a transposition of an earlier position
+struct ReuseStep {
+    const char* label;
+    bool newGame;
+    const char* moves;
+};
+
+const ReuseStep reuseSteps[] = {
+    { "mainline",      true,  "e2e4 e7e5 g1f3 b8c6 b1c3 g8f6" },
+    { "forward",       false, "e2e4 e7e5 g1f3 b8c6 b1c3 g8f6 f1b5" },
+    { "variation",     false, "e2e4 e7e5 g1f3 b8c6 b1c3 g8f6 d2d4" },
+    { "back",          false, "e2e4 e7e5 g1f3 b8c6 b1c3 g8f6 f1b5" },
+    { "takeback",      false, "e2e4 e7e5 g1f3 b8c6 b1c3 g8f6" },
+    { "new game",      true,  "e2e4 e7e5 g1f3 b8c6 b1c3 g8f6 d2d4" },
+    { "transposition", false, "e2e4 e7e5 b1c3 g8f6 g1f3 b8c6 f1b5" },
+};
+
+struct ReuseResult {
+    uint64_t total = 0;     // visits of the root at the end, "info nodes"
+    uint64_t playouts = 0;  // visits added by this search
+    double ms = 0;
+};
+
+ReuseResult searchStep(int eid, const ReuseStep& step, const std::string& goCmd)
+{
+    ReuseResult result;
+    engine_clearAllMessages(eid);
+    if (step.newGame) {
+        engine_cmd(eid, "ucinewgame");
+    }
+    engine_cmd(eid, (std::string("position startpos moves ") + step.moves).c_str());
+
+    const auto start = std::chrono::steady_clock::now();
+    engine_cmd(eid, goCmd.c_str());
+    for (;;) {
+        auto msg = engine_getSearchMessage(eid);
+        if (!msg) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        std::string str = msg;
+        if (str.compare(0, 8, "bestmove") == 0) {
+            break;
+        }
+        std::istringstream is(str);
+        std::string token;
+        while (is >> token && token != "pv") {
+            if (token == "nodes") is >> result.total;
+        }
+    }
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    EngineSearchStats stats {};
+    engine_getSearchStats(eid, &stats);
+    result.playouts = stats.nodes;
+    return result;
+}
+
+} // namespace
+
+/// bsgbench reuse [-forest 0,200000] [-lc0nodes 2000] [-threads 1] [-lc0backend random] [-lc0net file]
+/// Lc0 searches along an analysis session which goes back and forth between
+/// positions, with each TreeForestSize. Reused is what the root already had
+/// from earlier searches: without the forest only the move forward reuses its
+/// subtree, with it every position searched before does
+int reuseMain(const std::vector<std::string>& args)
+{
+    std::vector<int> forestList = { 0, 200000 };
+    uint64_t lc0Nodes = 2000;
+    int threads = 1;
+    std::string backend = "random", net;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-forest") {
+            forestList = parseList(args[i + 1]);
+        } else if (args[i] == "-lc0nodes") {
+            lc0Nodes = std::stoull(args[i + 1]);
+        } else if (args[i] == "-threads") {
+            threads = std::stoi(args[i + 1]);
+        } else if (args[i] == "-lc0backend") {
+            backend = args[i + 1];
+        } else if (args[i] == "-lc0net") {
+            net = args[i + 1];
+        } else {
+            std::cerr << "Unknown reuse option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    engine_setMessageEcho(0);
+    const std::string goCmd = "go nodes " + std::to_string(lc0Nodes);
+    char buf[256];
+    for (int forest : forestList) {
+        setNetworkPath(lc0, net.empty() ? "<autodiscover>" : net.c_str());
+        engine_initialize(lc0, threads);
+        if (!backend.empty()) {
+            engine_cmd(lc0, ("setoption name Backend value " + backend).c_str());
+        }
+        engine_cmd(lc0, ("setoption name TreeForestSize value " + std::to_string(forest)).c_str());
+        engine_cmd(lc0, "isready");
+
+        std::cout << "TreeForestSize " << forest << ", " << goCmd << std::endl;
+        uint64_t reused = 0, playouts = 0;
+        double ms = 0;
+        for (const auto& step : reuseSteps) {
+            const ReuseResult r = searchStep(lc0, step, goCmd);
+            const uint64_t stepReused = r.total > r.playouts ? r.total - r.playouts : 0;
+            reused += stepReused;
+            playouts += r.playouts;
+            ms += r.ms;
+            snprintf(buf, sizeof(buf), "  %-13s  reused %9llu  playouts %9llu  time %8.1f ms",
+                     step.label, (unsigned long long)stepReused, (unsigned long long)r.playouts, r.ms);
+            std::cout << buf << std::endl;
+        }
+        snprintf(buf, sizeof(buf), "  %-13s  reused %9llu  playouts %9llu  time %8.1f ms",
+                 "total", (unsigned long long)reused, (unsigned long long)playouts, ms);
+        std::cout << buf << std::endl;
+
+        // The forest survives ucinewgame, so it is flushed for the next run.
+        // This also waits for the search threads
+        engine_cmd(lc0, "setoption name TreeForestSize value 0");
+        engine_cmd(lc0, "ucinewgame");
+    }
+    return 0;
+}
+
+} // namespace bench
@@ -0,0 +1,414 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <sys/resource.h>
+
+#include "bench.h"
+#include "../engines-bridging-header.h"
+
+namespace bench {
+
+/// Same positions as the Stockfish and Lc0 "bench" commands, a few with
+/// extra moves so the repetition/history code gets exercised too
+const std::vector<std::string> searchSuite = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14 moves d4e6",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14 moves g2g4",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+    "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+    "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+};
+
+static const char* engineNames[] = { "stockfish", "lc0", "rubi" };
+
+
+/// Peak resident set size of the whole process, in kB
+static long peakRssKb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::stol(line.substr(6));
+        }
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+/// Resets VmHWM so each run reports its own peak, Linux only
+static void resetPeakRss()
+{
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    if (clearRefs) {
+        clearRefs << "5";
+    }
+}
+
+
+struct SearchRecord {
+    std::string fen;
+    uint64_t nodes = 0;
+    double ms = 0;
+    int depth = 0;
+    std::string bestmove;
+    EngineSearchStats stats {};
+};
+
+/// Sends "go" and waits for "bestmove", recording when each depth was reached.
+/// depthTimes sums the times and depthCounts counts the searches per depth
+static SearchRecord searchOne(int eid, const std::string& fen, const std::string& goCmd,
+                              std::vector<double>& depthTimes, std::vector<int>& depthCounts)
+{
+    SearchRecord rec;
+    rec.fen = fen;
+
+    engine_clearAllMessages(eid);
+    engine_cmd(eid, "ucinewgame");
+    engine_cmd(eid, "isready");
+
+    auto cmd = "position fen " + fen;  // a " moves ..." suffix passes through as is
+    engine_cmd(eid, cmd.c_str());
+
+    const auto start = std::chrono::steady_clock::now();
+    engine_cmd(eid, goCmd.c_str());
+
+    for (;;) {
+        auto msg = engine_getSearchMessage(eid);
+        if (!msg) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        std::string str = msg;
+        if (str.compare(0, 8, "bestmove") == 0) {
+            rec.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::istringstream is(str);
+            is >> str >> rec.bestmove;
+            break;
+        }
+
+        if (str.compare(0, 5, "info ") != 0) {
+            continue;
+        }
+
+        std::istringstream is(str);
+        std::string token;
+        int depth = 0;
+        uint64_t nodes = 0;
+        while (is >> token && token != "pv") {
+            if (token == "depth") is >> depth;
+            else if (token == "nodes") is >> nodes;
+        }
+
+        if (nodes) {
+            rec.nodes = nodes;
+        }
+        if (depth > rec.depth) {
+            auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (int(depthTimes.size()) < depth) {
+                depthTimes.resize(depth, 0);
+                depthCounts.resize(depth, 0);
+            }
+            // A skipped depth counts as reached now
+            for (int d = rec.depth; d < depth; ++d) {
+                depthTimes[d] += ms;
+                depthCounts[d]++;
+            }
+            rec.depth = depth;
+        }
+    }
+
+    engine_getSearchStats(eid, &rec.stats);
+    if (rec.stats.nodes) {
+        rec.nodes = rec.stats.nodes;
+    }
+    return rec;
+}
+
+
+/// Sends comma separated Name=value pairs as setoption commands, e.g. MinibatchSize=64
+static void sendOptions(int eid, const std::string& options)
+{
+    std::istringstream is(options);
+    std::string option;
+    while (std::getline(is, option, ',')) {
+        auto eq = option.find('=');
+        if (eq != std::string::npos) {
+            auto cmd = "setoption name " + option.substr(0, eq) + " value " + option.substr(eq + 1);
+            engine_cmd(eid, cmd.c_str());
+        }
+    }
+}
+
+
+static std::string jsonRate(unsigned long long hits, unsigned long long probes)
+{
+    if (!probes) {
+        return "null";
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.4f", double(hits) / probes);
+    return buf;
+}
+
+/// bsgbench search [-engine stockfish,lc0,rubi] [-threads 1,2] [-depth 12] [-nodes 0]
+///                 [-movetime 0] [-lc0nodes 800] [-positions 22] [-sfnet file] [-lc0net file]
+///                 [-rubinet file] [-lc0backend name] [-lc0options Name=value,...]
+///                 [-rubioptions Name=value,...] [-taskworkers 0,1,2]
+///                 [-json bsgbench.json]
+/// Fixed-depth (fixed playouts for Lc0) searches of the same positions on
+/// every engine, reported as JSON so runs can be diffed between builds.
+/// With -movetime the alpha-beta engines search a fixed time instead, for
+/// NPS and time-to-depth at short time controls
+int searchMain(const std::vector<std::string>& args)
+{
+    std::string engineList = "stockfish,lc0,rubi";
+    std::vector<int> threadList { 1 };
+    int depth = 12, positionCount = INT_MAX;
+    uint64_t nodeLimit = 0, lc0Nodes = 800;
+    int moveTime = 0;
+    std::string nets[3], lc0Backend, lc0Options, rubiOptions, tbPath, jsonPath = "bsgbench.json";
+    auto suite = &searchSuite;
+    std::vector<int> taskWorkerList;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-engine") {
+            engineList = args[i + 1];
+        } else if (args[i] == "-threads") {
+            threadList = parseList(args[i + 1]);
+        } else if (args[i] == "-depth") {
+            depth = std::stoi(args[i + 1]);
+        } else if (args[i] == "-nodes") {
+            nodeLimit = std::stoull(args[i + 1]);
+        } else if (args[i] == "-movetime") {
+            moveTime = std::stoi(args[i + 1]);
+        } else if (args[i] == "-lc0nodes") {
+            lc0Nodes = std::stoull(args[i + 1]);
+        } else if (args[i] == "-positions") {
+            positionCount = std::stoi(args[i + 1]);
+        } else if (args[i] == "-sfnet") {
+            nets[stockfish] = args[i + 1];
+        } else if (args[i] == "-lc0net") {
+            nets[lc0] = args[i + 1];
+        } else if (args[i] == "-rubinet") {
+            nets[rubi] = args[i + 1];
+        } else if (args[i] == "-lc0backend") {
+            lc0Backend = args[i + 1];
+        } else if (args[i] == "-lc0options") {
+            lc0Options = args[i + 1];
+        } else if (args[i] == "-rubioptions") {
+            rubiOptions = args[i + 1];
+        } else if (args[i] == "-taskworkers") {
+            taskWorkerList = parseList(args[i + 1]);
+        } else if (args[i] == "-suite") {
+            suite = args[i + 1] == "tb" ? &tbSuite : &searchSuite;
+        } else if (args[i] == "-tbpath") {
+            tbPath = args[i + 1];
+        } else if (args[i] == "-json") {
+            jsonPath = args[i + 1];
+        } else {
+            std::cerr << "Unknown search option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    positionCount = std::min(positionCount, int(suite->size()));
+    engine_setMessageEcho(0);
+
+    std::ostringstream json;
+    json << "{\n  \"suite\": \"" << (suite == &tbSuite ? "tb" : "default") << "\",\n  \"depth\": " << depth << ",\n  \"positions\": " << positionCount << ",\n  \"runs\": [";
+    bool firstRun = true;
+    char buf[256];
+
+    for (int eid = stockfish; eid <= rubi; ++eid) {
+        if (engineList.find(engineNames[eid]) == std::string::npos) {
+            continue;
+        }
+
+        if (nets[eid].empty()) {
+            if (eid == lc0 && (lc0Backend == "random" || lc0Backend == "trivial")) {
+                nets[eid] = "<autodiscover>";
+            } else if (eid != rubi) {
+                std::cerr << engineNames[eid] << ": no network given, skipped" << std::endl;
+                continue;
+            } else {
+                std::cerr << engineNames[eid] << ": no network given, using the classical evaluation" << std::endl;
+            }
+        }
+        setNetworkPath(eid, nets[eid].empty() ? "<Default>" : nets[eid].c_str());
+
+        std::string goCmd = eid == lc0
+            ? "go nodes " + std::to_string(lc0Nodes)
+            : moveTime ? "go movetime " + std::to_string(moveTime)
+            : nodeLimit ? "go nodes " + std::to_string(nodeLimit) : "go depth " + std::to_string(depth);
+
+        // Lc0 may also sweep its task workers (gathering helpers per search thread)
+        std::vector<std::pair<int, int>> configs;
+        for (auto threads : threadList) {
+            if (eid != lc0 || taskWorkerList.empty()) {
+                configs.push_back({ threads, -1 });
+            }
+            for (auto taskWorkers : taskWorkerList) {
+                if (eid == lc0) {
+                    configs.push_back({ threads, taskWorkers });
+                }
+            }
+        }
+
+        for (auto&& config : configs) {
+            const int threads = config.first, taskWorkers = config.second;
+            resetPeakRss();
+            engine_initialize(eid, threads);
+            if (nets[eid].empty()) {
+                engine_cmd(eid, "setoption name Use_NNUE value false");
+            }
+            if (eid == lc0 && !lc0Backend.empty()) {
+                engine_cmd(eid, ("setoption name Backend value " + lc0Backend).c_str());
+            }
+            if (eid == lc0) {
+                sendOptions(eid, lc0Options);
+            }
+            if (eid == rubi) {
+                sendOptions(eid, rubiOptions);
+            }
+            if (!tbPath.empty()) {
+                engine_cmd(eid, ("setoption name SyzygyPath value " + tbPath).c_str());
+            }
+            if (taskWorkers >= 0) {
+                engine_cmd(eid, ("setoption name TaskWorkers value " + std::to_string(taskWorkers)).c_str());
+            }
+            engine_cmd(eid, "isready");
+
+            std::vector<SearchRecord> records;
+            std::vector<double> depthTimes;
+            std::vector<int> depthCounts;
+            EngineSearchStats total {};
+            double totalMs = 0;
+
+            for (int i = 0; i < positionCount; ++i) {
+                auto rec = searchOne(eid, (*suite)[i], goCmd, depthTimes, depthCounts);
+                totalMs += rec.ms;
+                total.nodes += rec.nodes;
+                total.hashProbes += rec.stats.hashProbes;
+                total.hashHits += rec.stats.hashHits;
+                total.cacheLookups += rec.stats.cacheLookups;
+                total.cacheHits += rec.stats.cacheHits;
+                total.tbHits += rec.stats.tbHits;
+                records.push_back(rec);
+            }
+            // Waits for the search threads of the last position
+            engine_cmd(eid, "ucinewgame");
+
+            const auto nps = totalMs > 0 ? uint64_t(total.nodes * 1000.0 / totalMs) : 0;
+            const auto rss = peakRssKb();
+
+            snprintf(buf, sizeof(buf), "%-10s threads %3d  tasks %2d  nodes %12llu  time %9.1f ms  nps %10llu  tt %6s  cache %6s  tb %8llu  rss %8ld kB",
+                     engineNames[eid], threads, std::max(taskWorkers, 0), total.nodes, totalMs, (unsigned long long)nps,
+                     jsonRate(total.hashHits, total.hashProbes).c_str(),
+                     jsonRate(total.cacheHits, total.cacheLookups).c_str(), total.tbHits, rss);
+            std::cout << buf << std::endl;
+
+            // Averages only over the searches which reached the depth
+            std::string depthLine = "  time to depth";
+            for (size_t d = 0; d < depthTimes.size(); ++d) {
+                snprintf(buf, sizeof(buf), "  %d: %.1f ms (%d/%d)", int(d + 1),
+                         depthTimes[d] / depthCounts[d], depthCounts[d], positionCount);
+                depthLine += buf;
+            }
+            std::cout << depthLine << std::endl;
+
+            json << (firstRun ? "\n" : ",\n");
+            firstRun = false;
+            json << "    {\n"
+                 << "      \"engine\": \"" << engineNames[eid] << "\",\n"
+                 << "      \"threads\": " << threads << ",\n"
+                 << "      \"task_workers\": " << (taskWorkers >= 0 ? std::to_string(taskWorkers) : "null") << ",\n"
+                 << "      \"go\": \"" << goCmd << "\",\n"
+                 << "      \"nodes\": " << total.nodes << ",\n"
+                 << "      \"time_ms\": " << uint64_t(totalMs) << ",\n"
+                 << "      \"nps\": " << nps << ",\n"
+                 << "      \"tt_hit_rate\": " << jsonRate(total.hashHits, total.hashProbes) << ",\n"
+                 << "      \"cache_hit_rate\": " << jsonRate(total.cacheHits, total.cacheLookups) << ",\n"
+                 << "      \"tb_hits\": " << total.tbHits << ",\n"
+                 << "      \"peak_rss_kb\": " << rss << ",\n"
+                 << "      \"time_to_depth_ms\": [";
+            for (size_t d = 0; d < depthTimes.size(); ++d) {
+                json << (d ? ", " : "") << uint64_t(depthTimes[d] / depthCounts[d]);
+            }
+            json << "],\n      \"positions_to_depth\": [";
+            for (size_t d = 0; d < depthCounts.size(); ++d) {
+                json << (d ? ", " : "") << depthCounts[d];
+            }
+            json << "],\n      \"searches\": [";
+            for (size_t i = 0; i < records.size(); ++i) {
+                auto& r = records[i];
+                json << (i ? "," : "") << "\n        { \"fen\": \"" << r.fen
+                     << "\", \"bestmove\": \"" << r.bestmove
+                     << "\", \"depth\": " << r.depth
+                     << ", \"nodes\": " << r.nodes
+                     << ", \"time_ms\": " << uint64_t(r.ms) << " }";
+            }
+            json << "\n      ]\n    }";
+        }
+    }
+
+    json << "\n  ]\n}\n";
+
+    std::ofstream out(jsonPath);
+    if (!out) {
+        std::cerr << "Cannot write " << jsonPath << std::endl;
+        return 1;
+    }
+    out << json.str();
+    std::cout << "Results written to " << jsonPath << std::endl;
+    return 0;
+}
+
+} // namespace bench
@@ -0,0 +1,258 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "bench.h"
+#include "../engines-bridging-header.h"
+#include "../syzygymap.h"
+
+#include "stockfish/position.h"
+#include "stockfish/thread.h"
+#include "stockfish/syzygy/tbprobe.h"
+
+#include "chess/lc0_position.h"
+#include "syzygy/lc0_syzygy.h"
+
+#include "rubichess/rubichess_RubiChess.h"
+
+void stockfish_initialize();
+void rubichess_initialize();
+
+namespace bench {
+
+/// Endgames of 3 to 6 pieces, each engine probes those within its largest tables
+const std::vector<std::string> tbSuite = {
+    "8/8/8/8/8/8/2k5/K6Q w - - 0 1",
+    "8/8/8/4k3/8/8/3KP3/8 w - - 0 1",
+    "8/8/8/8/8/2k5/1r6/K7 b - - 0 1",
+    "8/8/4k3/8/8/3KB3/3N4/8 w - - 0 1",
+    "8/8/8/3k4/8/8/3KRR2/8 w - - 0 1",
+    "8/6k1/8/8/8/8/1q3PK1/8 w - - 0 1",
+    "8/8/3k4/8/2PKP3/8/8/8 w - - 0 1",
+    "8/8/8/1k6/8/8/3K1R2/4r3 w - - 0 1",
+    "8/8/2k5/8/8/3K4/5Q2/4r3 b - - 0 1",
+    "4k3/8/8/8/8/8/PPP5/4K3 w - - 0 1",
+    "8/8/8/8/3k4/8/1pp5/2K2R2 w - - 0 1",
+    "8/2b5/8/8/3k4/8/2P1P3/3K4 w - - 0 1",
+    "8/8/8/8/5k2/2n5/1P3P2/3K4 b - - 0 1",
+    "8/8/8/2k5/8/3K4/1R2RP2/3r4 w - - 0 1",
+    "8/8/1p6/8/3k4/8/1PP2K2/8 w - - 0 1",
+    "r7/8/8/8/3k4/8/2P1PK2/1R6 w - - 0 1",
+    "8/5pk1/8/8/8/8/3R1PK1/4r3 w - - 0 1",
+    "8/8/5k2/8/8/1Q3K2/2q2P2/8 b - - 0 1",
+    "8/6pk/8/8/8/8/3RRPK1/7r w - - 0 1",
+    "8/8/2b5/5k2/8/4NK2/3P1P2/8 w - - 0 1",
+};
+
+namespace {
+
+/// A field of /proc/self/status in kB, 0 when not available
+long statusKb(const std::string& field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, field.size(), field) == 0) {
+            return std::stol(line.substr(field.size()));
+        }
+    }
+    return 0;
+}
+
+int pieceCount(const std::string& fen)
+{
+    int count = 0;
+    for (auto ch : fen) {
+        if (ch == ' ') {
+            break;
+        }
+        count += isalpha(ch) != 0;
+    }
+    return count;
+}
+
+class TbEngine {
+public:
+    virtual ~TbEngine() {}
+    virtual const char* name() const = 0;
+    virtual void initEngine() = 0;
+    /// Returns the largest table size found
+    virtual int init(const std::string& path) = 0;
+    /// Returns false if the position couldn't be probed
+    virtual bool probe(const std::string& fen) = 0;
+};
+
+class StockfishTb : public TbEngine {
+public:
+    const char* name() const override { return "stockfish"; }
+
+    void initEngine() override { stockfish_initialize(); }
+
+    int init(const std::string& path) override {
+        Stockfish::Tablebases::init(path);
+        return Stockfish::Tablebases::MaxCardinality;
+    }
+
+    bool probe(const std::string& fen) override {
+        Stockfish::StateInfo si;
+        Stockfish::Position pos;
+        pos.set(fen, false, &si, Stockfish::Threads.main());
+        Stockfish::Tablebases::ProbeState state;
+        Stockfish::Tablebases::probe_wdl(pos, &state);
+        return state != Stockfish::Tablebases::FAIL;
+    }
+};
+
+class Lc0Tb : public TbEngine {
+public:
+    const char* name() const override { return "lc0"; }
+
+    void initEngine() override { lczero::InitializeMagicBitboards(); }
+
+    int init(const std::string& path) override {
+        tb.init(path);
+        return tb.max_cardinality();
+    }
+
+    bool probe(const std::string& fen) override {
+        lczero::ChessBoard board;
+        int rule50 = 0, moves = 0;
+        board.SetFromFen(fen, &rule50, &moves);
+        lczero::Position pos(board, rule50, 0);
+        lczero::ProbeState state;
+        tb.probe_wdl(pos, &state);
+        return state != lczero::FAIL;
+    }
+
+private:
+    lczero::SyzygyTablebase tb;
+};
+
+class RubiChessTb : public TbEngine {
+public:
+    const char* name() const override { return "rubichess"; }
+
+    void initEngine() override { rubichess_initialize(); }
+
+    int init(const std::string& path) override {
+        init_tablebases((char*)path.c_str());
+        return rubichess::TBlargest;
+    }
+
+    bool probe(const std::string& fen) override {
+        rubichess::chessposition* pos = &rubichess::en.sthread[0].pos;
+        pos->getFromFen(fen.c_str());
+        pos->prepareStack();
+        int success = 0;
+        pos->probe_wdl(&success);
+        return success != 0;
+    }
+};
+
+} // namespace
+
+/// bsgbench tb -path /syzygy [-engine stockfish,lc0,rubi] [-rounds 1000]
+/// Virtual memory and RSS growth as each engine loads the same tables, with
+/// cold (first) and warm WDL probe latencies
+int tbMain(const std::vector<std::string>& args)
+{
+    std::string engineNames = "stockfish,lc0,rubi", path;
+    int rounds = 1000;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-path") {
+            path = args[i + 1];
+        } else if (args[i] == "-engine") {
+            engineNames = args[i + 1];
+        } else if (args[i] == "-rounds") {
+            rounds = std::stoi(args[i + 1]);
+        } else {
+            std::cerr << "Unknown tb option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+    if (path.empty()) {
+        std::cerr << "tb: no tablebase path given" << std::endl;
+        return 2;
+    }
+
+    StockfishTb stockfishTb;
+    Lc0Tb lc0Tb;
+    RubiChessTb rubiTb;
+    std::vector<TbEngine*> engines;
+    if (engineNames.find("stockfish") != std::string::npos) engines.push_back(&stockfishTb);
+    if (engineNames.find("lc0") != std::string::npos) engines.push_back(&lc0Tb);
+    if (engineNames.find("rubi") != std::string::npos) engines.push_back(&rubiTb);
+
+    engine_setMessageEcho(0);
+    for (auto engine : engines) {
+        engine->initEngine();
+    }
+
+    int errors = 0;
+    char buf[256];
+    for (auto engine : engines) {
+        const long vmBefore = statusKb("VmSize:"), rssBefore = statusKb("VmRSS:");
+        const int largest = engine->init(path);
+
+        std::vector<std::string> fens;
+        for (auto&& fen : tbSuite) {
+            if (pieceCount(fen) <= largest) {
+                fens.push_back(fen);
+            }
+        }
+
+        // The first probe of a table maps and decodes it
+        auto start = std::chrono::steady_clock::now();
+        for (auto&& fen : fens) {
+            if (!engine->probe(fen)) {
+                errors++;
+                std::cerr << engine->name() << ": probe failed for " << fen << std::endl;
+            }
+        }
+        const double coldMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (auto&& fen : fens) {
+                engine->probe(fen);
+            }
+        }
+        const double warmNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        snprintf(buf, sizeof(buf), "%-10s largest %d  positions %2d  cold %9.3f ms  warm %8.0f ns/probe  vm +%8ld kB  rss +%8ld kB",
+                 engine->name(), largest, int(fens.size()), coldMs,
+                 fens.empty() ? 0.0 : warmNs / rounds / fens.size(),
+                 statusKb("VmSize:") - vmBefore, statusKb("VmRSS:") - rssBefore);
+        std::cout << buf << std::endl;
+    }
+
+    int files;
+    uint64_t bytes;
+    syzygy_mapStats(&files, &bytes);
+    snprintf(buf, sizeof(buf), "shared mappings %d files %llu MB  vm %ld kB  rss %ld kB",
+             files, (unsigned long long)(bytes >> 20), statusKb("VmSize:"), statusKb("VmRSS:"));
+    std::cout << buf << std::endl;
+    return errors ? 1 : 0;
+}
+
+} // namespace bench
@@ -0,0 +1,179 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "bench.h"
+#include "../engines-bridging-header.h"
+
+namespace bench {
+
+namespace {
+
+/// Closed positions, where many move orders lead to the same position
+const std::vector<std::string> closedSuite = {
+    "rnbqkbnr/pp3ppp/4p3/2ppP3/3P4/2P5/PP3PPP/RNBQKBNR b KQkq - 0 4",
+    "r1bq1rk1/pppnn1bp/3p2p1/3Ppp2/2P1P3/2N5/PP2BPPP/R1BQNRK1 w - f6 0 10",
+    "rnbq1rk1/ppp1b1pp/4pn2/3p1p2/2PP4/5NP1/PP2PPBP/RNBQ1RK1 w - - 0 7",
+    "4k3/1p3p2/p1p1p1p1/P1P1P1P1/1P3P2/8/4K3/8 w - - 0 1",
+    "8/5k2/1p1p1p2/pPpPpPp1/P1P1P1P1/8/3K4/8 w - - 0 1",
+};
+
+struct TtResult {
+    std::string bestmove;
+    uint64_t playouts = 0;
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+    uint64_t settled = 0;   // visits when the pv took its final first move
+    double seconds = 0;
+};
+
+TtResult searchPosition(int eid, const std::string& fen, const std::string& goCmd)
+{
+    engine_clearAllMessages(eid);
+    engine_cmd(eid, "ucinewgame");
+    engine_cmd(eid, ("position fen " + fen).c_str());
+
+    TtResult result;
+    std::string pvMove;
+    const auto start = std::chrono::steady_clock::now();
+    engine_cmd(eid, goCmd.c_str());
+    for (;;) {
+        auto msg = engine_getSearchMessage(eid);
+        if (!msg) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        std::istringstream is(msg);
+        std::string token;
+        is >> token;
+        if (token == "bestmove") {
+            is >> result.bestmove;
+            break;
+        }
+        // Lc0 sends info whenever its best move changes
+        uint64_t nodes = 0;
+        while (is >> token) {
+            if (token == "nodes") {
+                is >> nodes;
+            } else if (token == "pv") {
+                std::string move;
+                if (is >> move && move != pvMove) {
+                    pvMove = move;
+                    result.settled = nodes;
+                }
+                break;
+            }
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (pvMove != result.bestmove) {
+        result.settled = 0;
+    }
+
+    EngineSearchStats stats {};
+    engine_getSearchStats(eid, &stats);
+    result.playouts = stats.nodes;
+    result.probes = stats.hashProbes;
+    result.hits = stats.hashHits;
+    return result;
+}
+
+void printResult(const char* label, const TtResult& r, const char* same)
+{
+    char buf[256];
+    snprintf(buf, sizeof(buf), "  %-6s %-6s %-4s playouts %8llu  nps %9.0f  probes %8llu  hits %5.1f%%  best move after %8llu visits",
+             label, r.bestmove.c_str(), same, (unsigned long long)r.playouts,
+             r.seconds > 0 ? r.playouts / r.seconds : 0.0, (unsigned long long)r.probes,
+             r.probes ? 100.0 * r.hits / r.probes : 0.0, (unsigned long long)r.settled);
+    std::cout << buf << std::endl;
+}
+
+} // namespace
+
+/// bsgbench tt [-ttmb 0,64] [-lc0nodes 5000] [-threads 1] [-lc0backend random] [-lc0net file]
+/// Lc0 searches of closed positions with each TranspositionTableSize. A leaf
+/// whose position was already searched by another move order starts from the
+/// subtree statistics in the table. Reports the table hit rate and the visits
+/// after which the search kept its final best move, marked "same" when that
+/// is the move of the first table size
+int ttMain(const std::vector<std::string>& args)
+{
+    std::vector<int> ttList = { 0, 64 };
+    uint64_t lc0Nodes = 5000;
+    int threads = 1;
+    std::string backend = "random", net;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-ttmb") {
+            ttList = parseList(args[i + 1]);
+        } else if (args[i] == "-lc0nodes") {
+            lc0Nodes = std::stoull(args[i + 1]);
+        } else if (args[i] == "-threads") {
+            threads = std::stoi(args[i + 1]);
+        } else if (args[i] == "-lc0backend") {
+            backend = args[i + 1];
+        } else if (args[i] == "-lc0net") {
+            net = args[i + 1];
+        } else {
+            std::cerr << "Unknown tt option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    engine_setMessageEcho(0);
+    const std::string goCmd = "go nodes " + std::to_string(lc0Nodes);
+    std::vector<std::string> firstMoves;
+    for (int ttMb : ttList) {
+        setNetworkPath(lc0, net.empty() ? "<autodiscover>" : net.c_str());
+        engine_initialize(lc0, threads);
+        if (!backend.empty()) {
+            engine_cmd(lc0, ("setoption name Backend value " + backend).c_str());
+        }
+        // Every search starts from scratch, without subtrees from the forest
+        engine_cmd(lc0, "setoption name TreeForestSize value 0");
+        engine_cmd(lc0, ("setoption name TranspositionTableSize value " + std::to_string(ttMb)).c_str());
+        engine_cmd(lc0, "isready");
+
+        std::cout << "TranspositionTableSize " << ttMb << " MiB, " << goCmd << std::endl;
+        TtResult total;
+        for (size_t i = 0; i < closedSuite.size(); i++) {
+            const TtResult r = searchPosition(lc0, closedSuite[i], goCmd);
+            if (firstMoves.size() <= i) {
+                firstMoves.push_back(r.bestmove);
+            }
+            total.playouts += r.playouts;
+            total.probes += r.probes;
+            total.hits += r.hits;
+            total.settled += r.settled;
+            total.seconds += r.seconds;
+            printResult(("#" + std::to_string(i + 1)).c_str(), r, r.bestmove == firstMoves[i] ? "same" : "");
+        }
+        printResult("total", total, "");
+
+        // Waits for the search threads
+        engine_cmd(lc0, "ucinewgame");
+    }
+    return 0;
+}
+
+} // namespace bench
@@ -0,0 +1,161 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "bench.h"
+#include "../engines-bridging-header.h"
+
+namespace bench {
+
+namespace {
+
+struct MoveResult {
+    std::string bestmove, ponder;
+    uint64_t total = 0;     // visits of the root at the end, "info nodes"
+    uint64_t playouts = 0;  // visits added by this search
+    uint64_t treeBytes = 0;
+    double ms = 0;
+};
+
+MoveResult searchMove(int eid, const std::string& moves, const std::string& goCmd)
+{
+    MoveResult result;
+    engine_clearAllMessages(eid);
+    engine_cmd(eid, ("position startpos moves" + moves).c_str());
+
+    const auto start = std::chrono::steady_clock::now();
+    engine_cmd(eid, goCmd.c_str());
+    for (;;) {
+        auto msg = engine_getSearchMessage(eid);
+        if (!msg) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        std::istringstream is(msg);
+        std::string token;
+        is >> token;
+        if (token == "bestmove") {
+            is >> result.bestmove >> token >> result.ponder;
+            break;
+        }
+        while (is >> token && token != "pv") {
+            if (token == "nodes") is >> result.total;
+        }
+    }
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    EngineSearchStats stats {};
+    engine_getSearchStats(eid, &stats);
+    result.playouts = stats.nodes;
+    result.treeBytes = stats.treeBytes;
+    return result;
+}
+
+} // namespace
+
+/// bsgbench treemem [-mb 0,8] [-moves 4] [-searches 2] [-lc0nodes 50000] [-threads 1]
+///                  [-lc0backend random] [-lc0net file]
+/// Lc0 plays moves with each MaxTreeMemoryMB, searching every position
+/// -searches times like an analysis which goes on, so the whole tree is reused.
+/// A search stops when the nodes and edges reach the limit, before -lc0nodes;
+/// the next one drops the least visited subtrees so that it has room again
+int treeMemoryMain(const std::vector<std::string>& args)
+{
+    std::vector<int> mbList = { 0, 8 };
+    uint64_t lc0Nodes = 50000;
+    int moves = 4, searches = 2, threads = 1;
+    std::string backend = "random", net;
+
+    for (size_t i = 0; i + 1 < args.size(); i += 2) {
+        if (args[i] == "-mb") {
+            mbList = parseList(args[i + 1]);
+        } else if (args[i] == "-moves") {
+            moves = std::stoi(args[i + 1]);
+        } else if (args[i] == "-searches") {
+            searches = std::stoi(args[i + 1]);
+        } else if (args[i] == "-lc0nodes") {
+            lc0Nodes = std::stoull(args[i + 1]);
+        } else if (args[i] == "-threads") {
+            threads = std::stoi(args[i + 1]);
+        } else if (args[i] == "-lc0backend") {
+            backend = args[i + 1];
+        } else if (args[i] == "-lc0net") {
+            net = args[i + 1];
+        } else {
+            std::cerr << "Unknown treemem option " << args[i] << std::endl;
+            return 2;
+        }
+    }
+
+    engine_setMessageEcho(0);
+    const std::string goCmd = "go nodes " + std::to_string(lc0Nodes);
+    char buf[256];
+    for (int mb : mbList) {
+        setNetworkPath(lc0, net.empty() ? "<autodiscover>" : net.c_str());
+        engine_initialize(lc0, threads);
+        if (!backend.empty()) {
+            engine_cmd(lc0, ("setoption name Backend value " + backend).c_str());
+        }
+        // Only the current tree holds nodes
+        engine_cmd(lc0, "setoption name TreeForestSize value 0");
+        engine_cmd(lc0, ("setoption name MaxTreeMemoryMB value " + std::to_string(mb)).c_str());
+        engine_cmd(lc0, "isready");
+        engine_cmd(lc0, "ucinewgame");
+
+        std::cout << "MaxTreeMemoryMB " << mb << ", " << goCmd << std::endl;
+        std::string line;
+        uint64_t playouts = 0, peakBytes = 0;
+        double ms = 0;
+        for (int i = 0; i < moves; i++) {
+            MoveResult r;
+            for (int j = 0; j < searches; j++) {
+                r = searchMove(lc0, line, goCmd);
+                if (r.bestmove.empty() || r.bestmove == "(none)") {
+                    break;
+                }
+                const uint64_t reused = r.total > r.playouts ? r.total - r.playouts : 0;
+                playouts += r.playouts;
+                peakBytes = std::max(peakBytes, r.treeBytes);
+                ms += r.ms;
+                snprintf(buf, sizeof(buf), "  %-12s  reused %9llu  playouts %9llu  time %8.1f ms  tree %8.2f MiB",
+                         (r.bestmove + " " + r.ponder).c_str(), (unsigned long long)reused,
+                         (unsigned long long)r.playouts, r.ms, r.treeBytes / 1048576.0);
+                std::cout << buf << std::endl;
+            }
+            if (r.bestmove.empty() || r.bestmove == "(none)" || r.ponder.empty()) {
+                break;
+            }
+            line += " " + r.bestmove + " " + r.ponder;
+        }
+        snprintf(buf, sizeof(buf), "  %-12s  reused %9s  playouts %9llu  time %8.1f ms  peak %8.2f MiB",
+                 "total", "", (unsigned long long)playouts, ms, peakBytes / 1048576.0);
+        std::cout << buf << std::endl;
+
+        // Waits for the search threads
+        engine_cmd(lc0, "ucinewgame");
+    }
+    return 0;
+}
+
+} // namespace bench
@@ -0,0 +1,147 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include "bench.h"
+
+#include "stockfish/movegen.h"
+#include "stockfish/position.h"
+#include "stockfish/thread.h"
+#include "stockfish/nnue/evaluate_nnue.h"
+
+void stockfish_initialize();
+
+using namespace Stockfish;
+using namespace Stockfish::Eval::NNUE;
+
+namespace bench {
+
+namespace {
+
+/// A random network of the Stockfish 16 layout (HalfKAv2_hm, 1536x2-15-32-1,
+/// 8 layer stacks) in the file format, the feature transformer LEB128 compressed
+std::string randomNet(uint32_t seed)
+{
+    using FT = FeatureTransformer;
+    constexpr IndexType ftDims = TransformedFeatureDimensions, ftInputs = FT::InputDimensions;
+    constexpr IndexType fc0In = ftDims, fc0Out = Network::FC_0_OUTPUTS + 1;
+    constexpr IndexType fc1In = 32, fc1UsedIn = Network::FC_0_OUTPUTS * 2, fc1Out = Network::FC_1_OUTPUTS;
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> ftBias(-60, 20), ftWeight(-32, 32), psqt(-500, 500), weight(-64, 64), bias(-1000, 1000);
+
+    std::ostringstream out(std::ios::binary);
+    const std::string desc = "bsgbench random net";
+    write_little_endian<uint32_t>(out, Version);
+    write_little_endian<uint32_t>(out, HashValue);
+    write_little_endian<uint32_t>(out, uint32_t(desc.size()));
+    out.write(desc.data(), desc.size());
+
+    write_little_endian<uint32_t>(out, FT::get_hash_value());
+    std::vector<int16_t> ft(ftDims);
+    for (auto& v : ft) v = int16_t(ftBias(rng));
+    write_leb_128<int16_t>(out, ft.data(), ft.size());
+    ft.resize(size_t(ftDims) * ftInputs);
+    for (auto& v : ft) v = int16_t(ftWeight(rng));
+    write_leb_128<int16_t>(out, ft.data(), ft.size());
+    std::vector<int32_t> psqtWeights(size_t(PSQTBuckets) * ftInputs);
+    for (auto& v : psqtWeights) v = psqt(rng);
+    write_leb_128<int32_t>(out, psqtWeights.data(), psqtWeights.size());
+
+    for (IndexType s = 0; s < LayerStacks; s++) {
+        write_little_endian<uint32_t>(out, Network::get_hash_value());
+        for (IndexType i = 0; i < fc0Out; i++) write_little_endian<int32_t>(out, bias(rng));
+        for (IndexType i = 0; i < fc0Out * fc0In; i++) write_little_endian<int8_t>(out, int8_t(weight(rng)));
+        for (IndexType i = 0; i < fc1Out; i++) write_little_endian<int32_t>(out, bias(rng));
+        for (IndexType r = 0; r < fc1Out; r++) {
+            for (IndexType c = 0; c < fc1In; c++) write_little_endian<int8_t>(out, int8_t(c < fc1UsedIn ? weight(rng) : 0));
+        }
+        write_little_endian<int32_t>(out, bias(rng));
+        for (IndexType i = 0; i < fc1Out; i++) write_little_endian<int8_t>(out, int8_t(weight(rng)));
+    }
+    return out.str();
+}
+
+template<bool Evaluate>
+int64_t evalPerft(Position& pos, int depth, uint64_t& nodes)
+{
+    nodes++;
+    int64_t sum = (Evaluate ? int64_t(Eval::NNUE::evaluate(pos)) : 0);
+    if (depth == 0) {
+        return sum;
+    }
+
+    StateInfo st;
+    for (const auto& m : MoveList<LEGAL>(pos)) {
+        pos.do_move(m, st);
+        sum += evalPerft<Evaluate>(pos, depth - 1, nodes);
+        pos.undo_move(m);
+    }
+    return sum;
+}
+
+class StockfishNnue : public NnueEngine {
+public:
+    const char* name() const override { return "stockfish"; }
+
+    bool load(const std::string& net) override {
+        stockfish_initialize();
+        netName = net.empty() ? "random" : net;
+        if (net.empty()) {
+            std::istringstream stream(randomNet(1), std::ios::binary);
+            return load_eval("random", stream);
+        }
+        std::ifstream stream(net, std::ios::binary);
+        return load_native(net, net) || load_eval(net, stream);
+    }
+
+    std::string description() override { return netName; }
+
+    bool exportNative(const std::string& file) override { return save_native(file); }
+
+    Walk walk(bool evaluate, int depth, int positions) override {
+        Walk result;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < positions && i < int(perftSuite.size()); i++) {
+            StateInfo si;
+            Position pos;
+            pos.set(perftSuite[i].fen, false, &si, Threads.main());
+            result.checksum += evaluate ? evalPerft<true>(pos, depth, result.nodes)
+                                        : evalPerft<false>(pos, depth, result.nodes);
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+private:
+    std::string netName;
+};
+
+} // namespace
+
+NnueEngine* stockfishNnueEngine()
+{
+    static StockfishNnue engine;
+    return &engine;
+}
+
+} // namespace bench
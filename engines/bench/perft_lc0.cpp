@@ -0,0 +1,97 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bench.h"
+
+#include "chess/lc0_board.h"
+
+using namespace lczero;
+
+namespace bench {
+
+namespace {
+
+/// The board is always seen from the side to move, so after a move
+/// it must be mirrored before generating the replies
+template<bool UseHash>
+uint64_t lc0Perft(const ChessBoard& board, int depth, PerftHash* hash)
+{
+    auto moves = board.GenerateLegalMoves();
+    if (depth == 1) {
+        return moves.size();
+    }
+
+    uint64_t nodes = 0;
+    if (UseHash && hash->probe(board.Hash(), depth, nodes)) {
+        return nodes;
+    }
+
+    for (auto m : moves) {
+        ChessBoard next = board;
+        next.ApplyMove(m);
+        next.Mirror();
+        nodes += lc0Perft<UseHash>(next, depth - 1, hash);
+    }
+
+    if (UseHash) {
+        hash->store(board.Hash(), depth, nodes);
+    }
+    return nodes;
+}
+
+class Lc0Perft : public PerftEngine {
+public:
+    const char* name() const override { return "lc0"; }
+
+    void setThreads(int) override {
+        if (!initialized) {
+            initialized = true;
+            InitializeMagicBitboards();
+        }
+    }
+
+    int rootMoveCount(const std::string& fen) override {
+        ChessBoard board(fen);
+        return int(board.GenerateLegalMoves().size());
+    }
+
+    uint64_t perftRootMove(int, const std::string& fen, int moveIdx,
+                           int depth, PerftHash* hash) override {
+        ChessBoard board(fen);
+        auto m = board.GenerateLegalMoves()[moveIdx];
+        board.ApplyMove(m);
+        board.Mirror();
+        if (depth == 0) {
+            return 1;
+        }
+        return hash ? lc0Perft<true>(board, depth, hash) : lc0Perft<false>(board, depth, hash);
+    }
+
+private:
+    bool initialized = false;
+};
+
+} // namespace
+
+PerftEngine* lc0PerftEngine()
+{
+    static Lc0Perft engine;
+    return &engine;
+}
+
+} // namespace bench
@@ -0,0 +1,133 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bench.h"
+
+#include "rubichess/rubichess_RubiChess.h"
+
+void rubichess_initialize();
+
+using namespace rubichess;
+
+namespace bench {
+
+namespace {
+
+int rubiMoves(chessposition* pos, chessmovelist& movelist)
+{
+    if (pos->isCheckbb)
+        movelist.length = pos->CreateEvasionMovelist(&movelist.move[0]);
+    else
+        movelist.length = pos->CreateMovelist<ALL>(&movelist.move[0]);
+    return movelist.length;
+}
+
+/// Same as engine::perft but on any thread's position. The lite mode of
+/// playMove doesn't maintain the hash key, so hashing needs the full mode
+template<bool UseHash>
+uint64_t rubiPerft(chessposition* pos, int depth, PerftHash* hash)
+{
+    if (depth == 0)
+        return 1;
+
+    uint64_t nodes = 0;
+    if (UseHash && hash->probe(pos->hash, depth, nodes))
+        return nodes;
+
+    chessmovelist movelist;
+    rubiMoves(pos, movelist);
+    pos->prepareStack();
+
+    for (int i = 0; i < movelist.length; i++)
+    {
+        if (pos->playMove<!UseHash>(movelist.move[i].code))
+        {
+            nodes += rubiPerft<UseHash>(pos, depth - 1, hash);
+            pos->unplayMove<!UseHash>(movelist.move[i].code);
+        }
+    }
+
+    if (UseHash)
+        hash->store(pos->hash, depth, nodes);
+    return nodes;
+}
+
+class RubiChessPerft : public PerftEngine {
+public:
+    const char* name() const override { return "rubichess"; }
+
+    void setThreads(int threads) override {
+        if (!initialized) {
+            initialized = true;
+            rubichess_initialize();
+        }
+        en.ucioptions.Set("Threads", std::to_string(threads));
+    }
+
+    int rootMoveCount(const std::string& fen) override {
+        chessposition* pos = &en.sthread[0].pos;
+        pos->getFromFen(fen.c_str());
+        return int(rootMoves(pos).size());
+    }
+
+    uint64_t perftRootMove(int worker, const std::string& fen, int moveIdx,
+                           int depth, PerftHash* hash) override {
+        chessposition* pos = &en.sthread[worker].pos;
+        pos->getFromFen(fen.c_str());
+        uint32_t mc = rootMoves(pos)[moveIdx];
+
+        pos->prepareStack();
+        if (hash) {
+            pos->playMove<false>(mc);
+            return rubiPerft<true>(pos, depth, hash);
+        }
+        pos->playMove<true>(mc);
+        return rubiPerft<false>(pos, depth, hash);
+    }
+
+private:
+    /// Legal root moves in generation order
+    static vector<uint32_t> rootMoves(chessposition* pos) {
+        chessmovelist movelist;
+        rubiMoves(pos, movelist);
+        pos->prepareStack();
+
+        vector<uint32_t> moves;
+        for (int i = 0; i < movelist.length; i++)
+        {
+            if (pos->playMove<true>(movelist.move[i].code))
+            {
+                pos->unplayMove<true>(movelist.move[i].code);
+                moves.push_back(movelist.move[i].code);
+            }
+        }
+        return moves;
+    }
+
+    bool initialized = false;
+};
+
+} // namespace
+
+PerftEngine* rubichessPerftEngine()
+{
+    static RubiChessPerft engine;
+    return &engine;
+}
+
+} // namespace bench
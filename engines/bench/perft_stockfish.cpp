@@ -0,0 +1,106 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bench.h"
+
+#include "stockfish/movegen.h"
+#include "stockfish/position.h"
+#include "stockfish/thread.h"
+#include "stockfish/uci.h"
+
+void stockfish_initialize();
+
+using namespace Stockfish;
+
+namespace bench {
+
+namespace {
+
+template<bool UseHash>
+uint64_t sfPerft(Position& pos, int depth, PerftHash* hash)
+{
+    if (depth == 1) {
+        return MoveList<LEGAL>(pos).size();
+    }
+
+    uint64_t nodes = 0;
+    if (UseHash && hash->probe(pos.key(), depth, nodes)) {
+        return nodes;
+    }
+
+    StateInfo st;
+    for (const auto& m : MoveList<LEGAL>(pos)) {
+        pos.do_move(m, st);
+        nodes += sfPerft<UseHash>(pos, depth - 1, hash);
+        pos.undo_move(m);
+    }
+
+    if (UseHash) {
+        hash->store(pos.key(), depth, nodes);
+    }
+    return nodes;
+}
+
+class StockfishPerft : public PerftEngine {
+public:
+    const char* name() const override { return "stockfish"; }
+
+    void setThreads(int threads) override {
+        if (!initialized) {
+            initialized = true;
+            stockfish_initialize();
+        }
+        // The Thread objects are used only for their node counters, each
+        // perft worker gets its own one to avoid sharing a cache line
+        Options["Threads"] = std::to_string(threads);
+    }
+
+    int rootMoveCount(const std::string& fen) override {
+        StateInfo si;
+        Position pos;
+        pos.set(fen, false, &si, Threads.main());
+        return int(MoveList<LEGAL>(pos).size());
+    }
+
+    uint64_t perftRootMove(int worker, const std::string& fen, int moveIdx,
+                           int depth, PerftHash* hash) override {
+        StateInfo si, st;
+        Position pos;
+        pos.set(fen, false, &si, *(Threads.begin() + worker));
+
+        Move m = *(MoveList<LEGAL>(pos).begin() + moveIdx);
+        pos.do_move(m, st);
+        if (depth == 0) {
+            return 1;
+        }
+        return hash ? sfPerft<true>(pos, depth, hash) : sfPerft<false>(pos, depth, hash);
+    }
+
+private:
+    bool initialized = false;
+};
+
+} // namespace
+
+PerftEngine* stockfishPerftEngine()
+{
+    static StockfishPerft engine;
+    return &engine;
+}
+
+} // namespace bench
@@ -21,6 +21,7 @@
 
 #include <stdio.h>
 #include "engineids.h"
+#include "enginestats.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -31,8 +32,11 @@ void engine_initialize(int eid, int coreNumber);
 void engine_cmd(int eid, const char *cmd);
 const char *engine_getSearchMessage(int eid);
 void engine_clearAllMessages(int eid);
+void engine_setMessageEcho(int on);
+void engine_getSearchStats(int eid, EngineSearchStats* stats);
 
 void lc0_bench(int cores);
+void lc0_backendbench(const char *backend, int maxBatchSize);
 
 void setNetworkPath(int eid, const char *path);
 
@@ -21,6 +21,7 @@
 #include <sstream>
 #include <set>
 #include <map>
+#include <mutex>
 #include <vector>
 #include <assert.h>
 
@@ -37,6 +38,7 @@ std::string lc0netpath;
 static std::set<int> initSet;
 
 static std::mutex searchMsgVecMutex;
+static bool echoMessages = true;
 
 void engine_message(int eid, const std::string& str) {
     std::lock_guard<std::mutex> lock(searchMsgVecMutex);
@@ -47,7 +49,9 @@ void engine_message(int eid, const std::string& str) {
     } else {
         searchMsgMap[eid].push_back(str);
     }
-    std::cout << str << std::endl;
+    if (echoMessages) {
+        std::cout << str << std::endl;
+    }
 }
 
 extern "C" void engine_message_c(int eid, const char* s) {
@@ -78,18 +82,26 @@ extern "C" void engine_clearAllMessages(int eid)
     }
 }
 
+extern "C" void engine_setMessageEcho(int on)
+{
+    echoMessages = on != 0;
+}
+
 void stockfish_initialize();
 void stockfish_cmd(const char *cmd);
 void stockfish_cleanup();
+void stockfish_searchStats(EngineSearchStats* stats);
 
 void lc0_initialize();
 void lc0_cmd(const char *cmd);
 void lc0_cleanup();
+void lc0_searchStats(EngineSearchStats* stats);
 
 
 void rubichess_initialize();
 void rubichess_uci_cmd(const char* str);
 void rubichess_cleanup();
+void rubichess_searchStats(EngineSearchStats* stats);
 
 
 extern "C" void setNetworkPath(int eid, const char *path)
@@ -189,6 +201,23 @@ void engine_cmd(int eid, const char *cmd) {
     }
 }
 
+void engine_getSearchStats(int eid, EngineSearchStats* stats)
+{
+    *stats = EngineSearchStats();
+    switch (eid) {
+        case stockfish:
+            stockfish_searchStats(stats);
+            break;
 
+        case lc0:
+            lc0_searchStats(stats);
+            break;
 
+        case rubi:
+            rubichess_searchStats(stats);
+            break;
 
+        default:
+            break;
+    }
+}
@@ -0,0 +1,37 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef enginestats_h
+#define enginestats_h
+
+/// Counters of the last search, zero when an engine doesn't have them
+typedef struct {
+    unsigned long long nodes;
+    unsigned long long hashProbes;      // transposition table
+    unsigned long long hashHits;
+    unsigned long long cacheLookups;    // NN cache (Lc0)
+    unsigned long long cacheHits;
+    unsigned long long tbHits;
+    unsigned long long borrowedVisits;  // from transpositions (Lc0)
+    unsigned long long prefetchEvals;   // NN evaluations prefetched (Lc0)
+    unsigned long long prefetchUsed;
+    unsigned long long backgroundNodes; // playouts after bestmove (Lc0)
+    unsigned long long treeBytes;       // nodes and edges allocated (Lc0)
+} EngineSearchStats;
+
+#endif /* enginestats_h */
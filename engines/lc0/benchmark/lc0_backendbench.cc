@@ -0,0 +1,147 @@
+/*
+  This file is part of Leela Chess Zero.
+  Copyright (C) 2020 The LCZero Authors
+
+  Leela Chess is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Leela Chess is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Leela Chess.  If not, see <http://www.gnu.org/licenses/>.
+
+  Additional permission under GNU GPL version 3 section 7
+
+  If you modify this Program, or any covered work, by linking or
+  combining it with NVIDIA Corporation's libraries from the NVIDIA CUDA
+  Toolkit and the NVIDIA CUDA Deep Neural Network library (or a
+  modified version of those libraries), containing parts covered by the
+  terms of the respective license agreement, the licensors of this
+  Program grant you additional permission to convey the resulting work.
+*/
+
+#include "benchmark/lc0_backendbench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "chess/lc0_board.h"
+#include "mcts/lc0_node.h"
+#include "neural/lc0_encoder.h"
+#include "neural/lc0_factory.h"
+#include "utils/lc0_optionsparser.h"
+
+#include "engineids.h"
+void engine_message(int eid, const std::string& s);
+
+namespace lczero {
+namespace {
+
+const OptionId kBatchesId{"batches", "",
+                          "Number of batches to run as a benchmark."};
+const OptionId kMaxBatchSizeId{"max-batch-size", "",
+                               "Maximum batch size to benchmark."};
+const OptionId kFenId{"fen", "", "Benchmark initial position FEN."};
+
+// Latency of the batch at quantile @q, @times must be sorted.
+double Percentile(const std::vector<double>& times, double q) {
+  const auto idx = std::min(times.size() - 1, size_t(q * times.size()));
+  return times[idx];
+}
+
+}  // namespace
+
+void BackendBenchmark::Run(const std::string& networkPath,
+                           const std::string& backend, int maxBatchSize,
+                           int batches) {
+  OptionsParser options;
+  NetworkFactory::PopulateOptions(&options);
+  options.Add<IntOption>(kBatchesId, 1, 999999999) = batches;
+  options.Add<IntOption>(kMaxBatchSizeId, 1, 1024) = maxBatchSize;
+  options.Add<StringOption>(kFenId) = ChessBoard::kStartposFen;
+
+  try {
+    // Added by BanksiaGUI. The random and trivial backends need no weights.
+    options.SetUciOption("WeightsFile", networkPath);
+    if (!backend.empty()) {
+      options.SetUciOption("Backend", backend);
+    }
+
+    if (!options.ProcessAllFlags()) return;
+
+    auto option_dict = options.GetOptionsDict();
+
+    auto network = NetworkFactory::LoadNetwork(option_dict);
+
+    NodeTree tree;
+    tree.ResetToPosition(option_dict.Get<std::string>(kFenId), {});
+    const auto input = EncodePositionForNN(
+        network->GetCapabilities().input_format, tree.GetPositionHistory(), 8,
+        FillEmptyHistory::ALWAYS, nullptr);
+
+    // Do any backend initialization outside the loop.
+    auto warmup = network->NewComputation();
+    warmup->AddInput(InputPlanes(input));
+    warmup->ComputeBlocking();
+
+    const int batch_count = option_dict.Get<int>(kBatchesId);
+    const int max_batch_size = option_dict.Get<int>(kMaxBatchSizeId);
+
+    engine_message(lc0, "Backend " + option_dict.Get<std::string>(
+                                         NetworkFactory::kBackendId));
+    engine_message(lc0,
+                   " batch   evals/s   mean ms    p50 ms    p90 ms    p99 ms");
+
+    int best_batch_size = 1;
+    double best_evals = 0;
+    std::vector<double> times(batch_count);
+    for (int i = 1;; i = std::min(i * 2, max_batch_size)) {
+      for (int j = 0; j < batch_count; j++) {
+        // Put i copies of the encoded root position into computation.
+        const auto start = std::chrono::steady_clock::now();
+        auto computation = network->NewComputation();
+        for (int k = 0; k < i; k++) {
+          computation->AddInput(InputPlanes(input));
+        }
+        computation->ComputeBlocking();
+        const auto end = std::chrono::steady_clock::now();
+        times[j] =
+            std::chrono::duration<double, std::milli>(end - start).count();
+      }
+
+      double total = 0;
+      for (auto t : times) total += t;
+      std::sort(times.begin(), times.end());
+
+      const double evals = total > 0 ? 1000.0 * i * batch_count / total : 0;
+      if (evals > best_evals) {
+        best_evals = evals;
+        best_batch_size = i;
+      }
+
+      char line[128];
+      snprintf(line, sizeof(line), "%6d %9.0f %9.3f %9.3f %9.3f %9.3f", i,
+               evals, total / batch_count, Percentile(times, 0.5),
+               Percentile(times, 0.9), Percentile(times, 0.99));
+      engine_message(lc0, line);
+      if (i == max_batch_size) break;
+    }
+
+    engine_message(lc0, "Best throughput at batch size " +
+                            std::to_string(best_batch_size) +
+                            ", consider MinibatchSize " +
+                            std::to_string(best_batch_size));
+  } catch (Exception& ex) {
+    engine_message(lc0, ex.what());
+  }
+  engine_message(lc0, "backendbench END");
+}
+
+}  // namespace lczero
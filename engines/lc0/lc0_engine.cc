@@ -66,6 +66,22 @@ const OptionId kStrictUciTiming{"strict-uci-timing", "StrictTiming",
                                 "only then starts timing."};
 const OptionId kPreload{"preload", "",
                         "Initialize backend and load net on engine startup."};
+const OptionId kTreeForestSizeId{
+    "tree-forest-size", "TreeForestSize",
+    "Total visits of the search trees of earlier positions kept to be reused "
+    "when they are set up again, e.g. after takebacks, when switching between "
+    "variations or after a new game. 0 reuses the tree of the last position "
+    "only."};
+const OptionId kTranspositionTableSizeId{
+    "transposition-table-size", "TranspositionTableSize",
+    "Size in MiB of the table of subtree statistics shared between "
+    "transpositions: a position reached again by another move order starts "
+    "from what was found for it. 0 disables transpositions."};
+const OptionId kGarbageCollectorThreadsId{
+    "garbage-collector-threads", "GarbageCollectorThreads",
+    "Number of threads freeing the discarded parts of the search tree. Large "
+    "subtrees are split between them, so that the memory of a tree left "
+    "behind after a move comes back sooner."};
 
 MoveList StringsToMovelist(const std::vector<std::string>& moves,
                            const ChessBoard& board) {
@@ -97,6 +113,9 @@ void EngineController::PopulateOptions(OptionsParser* options) {
   NetworkFactory::PopulateOptions(options);
   options->Add<IntOption>(kThreadsOptionId, 1, 128) = kDefaultThreads;
   options->Add<IntOption>(kNNCacheSizeId, 0, 999999999) = 2000000;
+  options->Add<IntOption>(kTreeForestSizeId, 0, 999999999) = 200000;
+  options->Add<IntOption>(kTranspositionTableSizeId, 0, 65536) = 0;
+  options->Add<IntOption>(kGarbageCollectorThreadsId, 1, 16) = 1;
   SearchParams::Populate(options);
 
   options->Add<StringOption>(kSyzygyTablebaseId);
@@ -149,6 +168,10 @@ void EngineController::UpdateFromUciOptions() {
 
   // Cache size.
   cache_.SetCapacity(options_.Get<int>(kNNCacheSizeId));
+  forest_.SetCapacity(options_.Get<int>(kTreeForestSizeId));
+  transpositions_.SetSizeMB(options_.Get<int>(kTranspositionTableSizeId));
+  SetNodeGarbageCollectorThreads(
+      options_.Get<int>(kGarbageCollectorThreadsId));
 
   // Check whether we can update the move timer in "Go".
   strict_uci_timing_ = options_.Get<bool>(kStrictUciTiming);
@@ -168,6 +191,9 @@ void EngineController::NewGame() {
   SharedLock lock(busy_mutex_);
   cache_.Clear();
   search_.reset();
+  transpositions_.Clear();
+  // The tree goes, but its head is kept to be grafted back in.
+  if (tree_) tree_->StashHead(&forest_);
   tree_.reset();
   CreateFreshTimeManager();
   current_position_ = {ChessBoard::kStartposFen, {}};
@@ -210,8 +236,23 @@ void EngineController::SetupPosition(
 
   std::vector<Move> moves;
   for (const auto& move : moves_str) moves.emplace_back(move);
-  const bool is_same_game = tree_->ResetToPosition(fen, moves);
+  const bool is_same_game = tree_->ResetToPosition(fen, moves, &forest_);
   if (!is_same_game) CreateFreshTimeManager();
+
+  // A tree close to MaxTreeMemoryMB would stop the search right away, so the
+  // least visited subtrees are dropped while no search runs.
+  const int64_t max_bytes =
+      options_.Get<int>(kMaxTreeMemoryMbId) * 1048576LL;
+  if (max_bytes && Node::GetAllocatedBytes() >= max_bytes / 10 * 9) {
+    CollectNodeGarbage();
+    if (Node::GetAllocatedBytes() >= max_bytes / 10 * 9) {
+      forest_.Clear();
+      const int64_t released = tree_->PruneHead(max_bytes / 3 * 2);
+      CollectNodeGarbage();
+      LOGFILE << "Pruned " << released << " bytes of the tree, "
+              << Node::GetAllocatedBytes() << " bytes left";
+    }
+  }
 }
 
 void EngineController::CreateFreshTimeManager() {
@@ -296,11 +337,13 @@ void EngineController::Go(const GoParams& params) {
   }
 
   auto stopper = time_manager_->GetStopper(params, *tree_.get());
+  cache_.ResetStats();
   search_ = std::make_unique<Search>(
       *tree_, network_.get(), std::move(responder),
       StringsToMovelist(params.searchmoves, tree_->HeadPosition().GetBoard()),
       *move_start_time_, std::move(stopper), params.infinite, params.ponder,
-      options_, &cache_, syzygy_tb_.get());
+      options_, &cache_, syzygy_tb_.get(),
+      transpositions_.GetSizeMB() ? &transpositions_ : nullptr);
 
   LOGFILE << "Timer started at "
           << FormatTime(SteadyClockToSystemClock(*move_start_time_));
@@ -317,6 +360,42 @@ void EngineController::Stop() {
   if (search_) search_->Stop();
 }
 
+namespace {
+void CheckNode(const Node* node, uint64_t* nodes, uint64_t* errors) {
+  ++*nodes;
+  uint32_t children_visits = 0;
+  for (const auto& edge : node->Edges()) {
+    if (!edge.node()) continue;
+    children_visits += edge.node()->GetN();
+    CheckNode(edge.node(), nodes, errors);
+  }
+  // Visits stop at terminals, also at those which became terminal later.
+  const bool ok = node->GetNInFlight() == 0 &&
+                  (node->IsTerminal()
+                       ? node->GetChildrenVisits() >= children_visits
+                       : node->GetN() == 0 ? children_visits == 0
+                                           : node->GetChildrenVisits() ==
+                                                 children_visits);
+  if (!ok) ++*errors;
+}
+}  // namespace
+
+void EngineController::CheckTree(uint64_t* nodes, uint64_t* errors,
+                                 uint64_t* root_n, uint64_t* playouts) {
+  SharedLock lock(busy_mutex_);
+  *nodes = *errors = *root_n = *playouts = 0;
+  if (search_) {
+    // The threads may back up a last batch after bestmove.
+    search_->Wait();
+    *playouts = search_->GetForegroundPlayouts();
+  }
+  // The search cancels the collisions left in flight when it goes.
+  search_.reset();
+  if (!tree_ || !tree_->GetCurrentHead()) return;
+  CheckNode(tree_->GetCurrentHead(), nodes, errors);
+  *root_n = tree_->GetCurrentHead()->GetN();
+}
+
 EngineLoop::EngineLoop()
     : engine_(
           std::make_unique<CallbackUciResponder>(
@@ -76,6 +76,41 @@ class EngineController {
 
   Position ApplyPositionMoves();
 
+  // Added for BanksiaGUI: playouts, NN cache lookups and hits of the last
+  // search.
+  void GetSearchStats(uint64_t* nodes, uint64_t* lookups,
+                      uint64_t* hits) const {
+    *nodes = search_ ? search_->GetForegroundPlayouts() : 0;
+    cache_.GetStats(lookups, hits);
+  }
+
+  // Playouts of the background search since the last bestmove.
+  void GetBackgroundStats(uint64_t* nodes) const {
+    *nodes = search_ ? search_->GetBackgroundPlayouts() : 0;
+  }
+
+  // Transposition table probes and hits of the last search and the visits
+  // borrowed by the hits.
+  void GetTranspositionStats(uint64_t* probes, uint64_t* hits,
+                             uint64_t* borrowed) const {
+    *probes = *hits = *borrowed = 0;
+    if (search_) search_->GetTranspositionStats(probes, hits, borrowed);
+  }
+
+  // NN evaluations prefetched by the last search and how many it used.
+  void GetPrefetchStats(uint64_t* evals, uint64_t* used) const {
+    *evals = *used = 0;
+    if (search_) search_->GetPrefetchStats(evals, used);
+  }
+
+  // Ends the last search as the next one would and checks its tree: the N of
+  // every node is one more than the visits of its children (at least that for
+  // terminals) and no visit is left in flight. Returns the nodes checked,
+  // those failing, the N of the root and the playouts of the search once its
+  // threads have finished.
+  void CheckTree(uint64_t* nodes, uint64_t* errors, uint64_t* root_n,
+                 uint64_t* playouts);
+
  private:
   void UpdateFromUciOptions();
 
@@ -95,6 +130,10 @@ class EngineController {
   std::unique_ptr<TimeManager> time_manager_;
   std::unique_ptr<Search> search_;
   std::unique_ptr<NodeTree> tree_;
+  // Subtrees of positions searched earlier, survives NewGame.
+  NodeForest forest_;
+  // Statistics shared between transpositions, survives moves in a game.
+  TranspositionTable transpositions_;
   std::unique_ptr<SyzygyTablebase> syzygy_tb_;
   std::unique_ptr<Network> network_;
   NNCache cache_;
@@ -133,6 +172,26 @@ class EngineLoop : public UciLoop {
   void CmdPonderHit() override;
   void CmdStop() override;
 
+  // Added for BanksiaGUI
+  void GetSearchStats(uint64_t* nodes, uint64_t* lookups,
+                      uint64_t* hits) const {
+    engine_.GetSearchStats(nodes, lookups, hits);
+  }
+  void GetTranspositionStats(uint64_t* probes, uint64_t* hits,
+                             uint64_t* borrowed) const {
+    engine_.GetTranspositionStats(probes, hits, borrowed);
+  }
+  void GetPrefetchStats(uint64_t* evals, uint64_t* used) const {
+    engine_.GetPrefetchStats(evals, used);
+  }
+  void GetBackgroundStats(uint64_t* nodes) const {
+    engine_.GetBackgroundStats(nodes);
+  }
+  void CheckTree(uint64_t* nodes, uint64_t* errors, uint64_t* root_n,
+                 uint64_t* playouts) {
+    engine_.CheckTree(nodes, errors, root_n, playouts);
+  }
+
  private:
   OptionsParser options_;
   EngineController engine_;
@@ -25,7 +25,7 @@
   Program grant you additional permission to convey the resulting work.
 */
 
-//#include "benchmark/lc0_backendbench.h"
+#include "benchmark/lc0_backendbench.h"
 #include "benchmark/lc0_benchmark.h"
 //#include "chess/lc0_board.h"
 #include "lc0_engine.h"
@@ -40,6 +40,10 @@
 #include "utils/lc0_logging.h"
 //#include "lc0_version.h"
 
+#include "enginestats.h"
+
+#include <sstream>
+
 using namespace lczero;
 
 extern std::string lc0netpath;
@@ -64,6 +68,7 @@ public:
             engineLoop.RunLoop();
             
             doCmd("setoption name MinibatchSize value 7");
+            // Prefetching stays off until it shows a gain on a device
             doCmd("setoption name MaxPrefetch value 0");
             doCmd("setoption name TaskWorkers value 0");
             doCmd("uci");
@@ -83,7 +88,18 @@ public:
     // Added for Banksia GUI
     void doCmd(const char *cmd)
     {
-        if (memcmp(cmd, "bench", strlen("bench")) == 0) {
+        if (memcmp(cmd, "backendbench", strlen("backendbench")) == 0) {
+            std::istringstream is(cmd);
+            std::string token, backend;
+            int maxBatchSize = 64, batches = 100;
+            is >> token;
+            while (is >> token) {
+                if (token == "backend") is >> backend;
+                else if (token == "maxbatch") is >> maxBatchSize;
+                else if (token == "batches") is >> batches;
+            }
+            doBackendBench(backend, maxBatchSize, batches);
+        } else if (memcmp(cmd, "bench", strlen("bench")) == 0) {
             if (benchmark) delete benchmark;
             benchmark = new lczero::Benchmark();
             benchmark->Run(lc0netpath, 2);
@@ -92,6 +108,47 @@ public:
         }
     }
     
+    void searchStats(EngineSearchStats* stats)
+    {
+        uint64_t nodes, lookups, hits;
+        engineLoop.GetSearchStats(&nodes, &lookups, &hits);
+        stats->nodes = nodes;
+        stats->cacheLookups = lookups;
+        stats->cacheHits = hits;
+        uint64_t probes, ttHits, borrowed;
+        engineLoop.GetTranspositionStats(&probes, &ttHits, &borrowed);
+        stats->hashProbes = probes;
+        stats->hashHits = ttHits;
+        stats->borrowedVisits = borrowed;
+        uint64_t prefetched, used;
+        engineLoop.GetPrefetchStats(&prefetched, &used);
+        stats->prefetchEvals = prefetched;
+        stats->prefetchUsed = used;
+        uint64_t background;
+        engineLoop.GetBackgroundStats(&background);
+        stats->backgroundNodes = background;
+        stats->treeBytes = lczero::Node::GetAllocatedBytes();
+    }
+
+    void checkTree(unsigned long long* nodes, unsigned long long* errors,
+                   unsigned long long* rootVisits, unsigned long long* playouts)
+    {
+        uint64_t checked, failed, rootN, searchPlayouts;
+        engineLoop.CheckTree(&checked, &failed, &rootN, &searchPlayouts);
+        *nodes = checked;
+        *errors = failed;
+        *rootVisits = rootN;
+        *playouts = searchPlayouts;
+    }
+
+    /// Inference only, no tree search. The UCI form is
+    /// backendbench [backend <name>] [maxbatch <n>] [batches <n>]
+    void doBackendBench(const std::string& backend, int maxBatchSize, int batches)
+    {
+        lczero::BackendBenchmark backendBenchmark;
+        backendBenchmark.Run(lc0netpath, backend, maxBatchSize, batches);
+    }
+
     void doBench(int cores)
     {
         printf("lczero, doBench, cores=%d\n", cores);
@@ -120,6 +177,29 @@ extern "C" void lc0_bench(int cores)
     }
 }
 
+extern "C" void lc0_backendbench(const char* backend, int maxBatchSize)
+{
+    if (lc0) {
+        lc0->doBackendBench(backend ? backend : "", maxBatchSize, 100);
+    }
+}
+
+void lc0_searchStats(EngineSearchStats* stats)
+{
+    if (lc0) {
+        lc0->searchStats(stats);
+    }
+}
+
+extern "C" void lc0_checkTree(unsigned long long* nodes, unsigned long long* errors,
+                              unsigned long long* rootVisits, unsigned long long* playouts)
+{
+    *nodes = *errors = *rootVisits = *playouts = 0;
+    if (lc0) {
+        lc0->checkTree(nodes, errors, rootVisits, playouts);
+    }
+}
+
 void lc0_cleanup() {
     if (lc0) {
         delete lc0;
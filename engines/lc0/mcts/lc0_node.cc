@@ -28,12 +28,15 @@
 #include "mcts/lc0_node.h"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
+#include <condition_variable>
 #include <cstring>
 #include <iostream>
 #include <sstream>
 #include <thread>
+#include <vector>
 
 #include "neural/lc0_encoder.h"
 #include "neural/lc0_network.h"
@@ -49,73 +52,150 @@ namespace lczero {
 namespace {
 // Periodicity of garbage collection, milliseconds.
 const int kGCIntervalMs = 100;
+// Nodes of a subtree being freed with at least that many visits have their
+// children queued on their own, so that other threads can free them.
+const uint32_t kGCSplitVisits = 4096;
+}  // namespace
 
-// Every kGCIntervalMs milliseconds release nodes in a separate GC thread.
+// Every kGCIntervalMs milliseconds release nodes in separate GC threads. A
+// large subtree is split into its heavy nodes' children, which wake the other
+// threads, so that a discarded tree is freed by all of them.
 class NodeGarbageCollector {
  public:
-  NodeGarbageCollector() : gc_thread_([this]() { Worker(); }) {}
+  NodeGarbageCollector() { SetThreads(1); }
 
   // Takes ownership of a subtree, to dispose it in a separate thread when
-  // it has time.
+  // it has time. A large one wakes the GC threads right away.
   void AddToGcQueue(std::unique_ptr<Node> node, size_t solid_size = 0) {
     if (!node) return;
-    Mutex::Lock lock(gc_mutex_);
-    subtrees_to_gc_.emplace_back(std::move(node));
-    subtrees_to_gc_solid_size_.push_back(solid_size);
+    const bool large = node->GetN() >= kGCSplitVisits;
+    {
+      Mutex::Lock lock(gc_mutex_);
+      subtrees_to_gc_.push_back({std::move(node), solid_size});
+    }
+    if (large) work_cv_.notify_all();
   }
 
   ~NodeGarbageCollector() {
-    // Flips stop flag and waits for a worker thread to stop.
-    stop_.store(true);
-    gc_thread_.join();
+    // Stops the threads and frees what is left.
+    SetThreads(0);
+    Collect();
+  }
+
+  // Restarts the GC threads, if their number changed.
+  void SetThreads(int threads) {
+    if (threads == static_cast<int>(gc_threads_.size())) return;
+    {
+      Mutex::Lock lock(gc_mutex_);
+      stop_.store(true);
+    }
+    work_cv_.notify_all();
+    for (auto& thread : gc_threads_) thread.join();
+    gc_threads_.clear();
+    stop_.store(false);
+    for (int i = 0; i < threads; i++) {
+      gc_threads_.emplace_back([this]() { Worker(); });
+    }
+  }
+
+  // Frees the queued subtrees now, with the GC threads helping, and returns
+  // when they are all gone.
+  void CollectNow() {
+    work_cv_.notify_all();
+    Collect();
+    Mutex::Lock lock(gc_mutex_);
+    idle_cv_.wait(lock.get_raw(), [this]() {
+      return busy_ == 0 && subtrees_to_gc_.empty();
+    });
   }
 
  private:
-  void GarbageCollect() {
+  struct Subtree {
+    std::unique_ptr<Node> node;
+    // Length of the array when it's solid children, 0 for a sibling list.
+    size_t solid_size = 0;
+  };
+
+  void Collect() {
     while (!stop_.load()) {
-      // Node will be released in destructor when mutex is not locked.
-      std::unique_ptr<Node> node_to_gc;
-      size_t solid_size = 0;
+      Subtree subtree;
       {
-        // Lock the mutex and move last subtree from subtrees_to_gc_ into
-        // node_to_gc.
         Mutex::Lock lock(gc_mutex_);
         if (subtrees_to_gc_.empty()) return;
-        node_to_gc = std::move(subtrees_to_gc_.back());
+        subtree = std::move(subtrees_to_gc_.back());
         subtrees_to_gc_.pop_back();
-        solid_size = subtrees_to_gc_solid_size_.back();
-        subtrees_to_gc_solid_size_.pop_back();
+        busy_++;
       }
-      // Solid is a hack...
-      if (solid_size != 0) {
-        for (size_t i = 0; i < solid_size; i++) {
-          node_to_gc.get()[i].~Node();
-        }
-        std::allocator<Node> alloc;
-        alloc.deallocate(node_to_gc.release(), solid_size);
+      Free(std::move(subtree));
+      Mutex::Lock lock(gc_mutex_);
+      if (--busy_ == 0 && subtrees_to_gc_.empty()) idle_cv_.notify_all();
+    }
+  }
+
+  void Free(Subtree subtree) {
+    // Heavy nodes hand their children to the queue first.
+    bool split = false;
+    const auto split_node = [&](Node* node) {
+      if (node->child_ && node->GetN() >= kGCSplitVisits) {
+        node->ReleaseChildren();
+        split = true;
+      }
+    };
+    if (subtree.solid_size != 0) {
+      for (size_t i = 0; i < subtree.solid_size; i++) {
+        split_node(&subtree.node.get()[i]);
+      }
+    } else {
+      for (Node* node = subtree.node.get(); node; node = node->sibling_.get()) {
+        split_node(node);
       }
     }
+    if (split) work_cv_.notify_all();
+
+    // Solid is a hack...
+    if (subtree.solid_size != 0) {
+      for (size_t i = 0; i < subtree.solid_size; i++) {
+        subtree.node.get()[i].~Node();
+      }
+      std::allocator<Node> alloc;
+      alloc.deallocate(subtree.node.release(), subtree.solid_size);
+    }
   }
 
   void Worker() {
     while (!stop_.load()) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(kGCIntervalMs));
-      GarbageCollect();
-    };
+      {
+        Mutex::Lock lock(gc_mutex_);
+        if (stop_.load()) break;
+        work_cv_.wait_for(lock.get_raw(),
+                          std::chrono::milliseconds(kGCIntervalMs));
+      }
+      Collect();
+    }
   }
 
   mutable Mutex gc_mutex_;
-  std::vector<std::unique_ptr<Node>> subtrees_to_gc_ GUARDED_BY(gc_mutex_);
-  std::vector<size_t> subtrees_to_gc_solid_size_ GUARDED_BY(gc_mutex_);
+  std::vector<Subtree> subtrees_to_gc_ GUARDED_BY(gc_mutex_);
+  // Subtrees being freed outside of the lock.
+  int busy_ GUARDED_BY(gc_mutex_) = 0;
+  std::condition_variable work_cv_;
+  std::condition_variable idle_cv_;
 
   // When true, Worker() should stop and exit.
   std::atomic<bool> stop_{false};
-  std::thread gc_thread_;
+  std::vector<std::thread> gc_threads_;
 };
 
+namespace {
 NodeGarbageCollector gNodeGc;
 }  // namespace
 
+void CollectNodeGarbage() { gNodeGc.CollectNow(); }
+
+void SetNodeGarbageCollectorThreads(int threads) {
+  gNodeGc.SetThreads(threads);
+}
+
 /////////////////////////////////////////////////////////////////////////
 // Edge
 /////////////////////////////////////////////////////////////////////////
@@ -180,17 +260,31 @@ std::string Edge::DebugString() const {
   return oss.str();
 }
 
-std::unique_ptr<Edge[]> Edge::FromMovelist(const MoveList& moves) {
-  std::unique_ptr<Edge[]> edges = std::make_unique<Edge[]>(moves.size());
+EdgeArray Edge::FromMovelist(const MoveList& moves) {
+  // The size goes into p_ of an extra edge in front, for the deleter.
+  Edge* block = new Edge[moves.size() + 1];
+  block->p_ = static_cast<uint16_t>(moves.size());
+  Node::allocated_bytes_.fetch_add((moves.size() + 1) * sizeof(Edge),
+                                   std::memory_order_relaxed);
+  EdgeArray edges(block + 1);
   auto* edge = edges.get();
   for (const auto move : moves) edge++->move_ = move;
   return edges;
 }
 
+void EdgeArrayDeleter::operator()(Edge* edges) const {
+  Edge* block = edges - 1;
+  Node::allocated_bytes_.fetch_sub((block->p_ + 1) * sizeof(Edge),
+                                   std::memory_order_relaxed);
+  delete[] block;
+}
+
 /////////////////////////////////////////////////////////////////////////
 // Node
 /////////////////////////////////////////////////////////////////////////
 
+std::atomic<int64_t> Node::allocated_bytes_{0};
+
 Node* Node::CreateSingleChildNode(Move move) {
   assert(!edges_);
   assert(!child_);
@@ -408,6 +502,7 @@ void Node::UpdateChildrenParents() {
 
 void Node::ReleaseChildren() {
   gNodeGc.AddToGcQueue(std::move(child_), solid_children_ ? num_edges_ : 0);
+  solid_children_ = false;
 }
 
 void Node::ReleaseChildrenExceptOne(Node* node_to_save) {
@@ -458,6 +553,49 @@ std::string EdgeAndNode::DebugString() const {
          (node_ ? node_->DebugString() : "(no node)");
 }
 
+/////////////////////////////////////////////////////////////////////////
+// NodeForest
+/////////////////////////////////////////////////////////////////////////
+
+void NodeForest::SetCapacity(uint64_t visits) {
+  capacity_ = visits;
+  EnforceCapacity();
+}
+
+void NodeForest::Add(uint64_t key, std::unique_ptr<Node> subtree) {
+  if (!subtree) return;
+  const auto iter = index_.find(key);
+  if (iter != index_.end()) Evict(iter->second);
+  visits_ += subtree->GetN();
+  entries_.push_back({key, std::move(subtree)});
+  index_[key] = std::prev(entries_.end());
+}
+
+std::unique_ptr<Node> NodeForest::Take(uint64_t key) {
+  const auto iter = index_.find(key);
+  if (iter == index_.end()) return nullptr;
+  auto subtree = std::move(iter->second->subtree);
+  visits_ -= subtree->GetN();
+  entries_.erase(iter->second);
+  index_.erase(iter);
+  return subtree;
+}
+
+void NodeForest::EnforceCapacity() {
+  while (visits_ > capacity_) Evict(entries_.begin());
+}
+
+void NodeForest::Clear() {
+  while (!entries_.empty()) Evict(entries_.begin());
+}
+
+void NodeForest::Evict(std::list<Entry>::iterator iter) {
+  visits_ -= iter->subtree->GetN();
+  gNodeGc.AddToGcQueue(std::move(iter->subtree));
+  index_.erase(iter->key);
+  entries_.erase(iter);
+}
+
 /////////////////////////////////////////////////////////////////////////
 // NodeTree
 /////////////////////////////////////////////////////////////////////////
@@ -494,12 +632,176 @@ void NodeTree::TrimTreeAtHead() {
   current_head_->sibling_ = std::move(tmp);
 }
 
+std::unique_ptr<Node> NodeTree::Detach(Node* node) {
+  Node* parent = node->GetParent();
+  const uint16_t index = node->index_;
+  auto tmp = std::move(node->sibling_);
+  auto subtree = std::make_unique<Node>(nullptr, index);
+  *subtree = std::move(*node);
+  subtree->parent_ = nullptr;
+  subtree->UpdateChildrenParents();
+  *node = Node(parent, index);
+  node->sibling_ = std::move(tmp);
+  return subtree;
+}
+
+void NodeTree::Graft(Node* node, std::unique_ptr<Node> subtree) {
+  Node* parent = node->GetParent();
+  const uint16_t index = node->index_;
+  auto tmp = std::move(node->sibling_);
+  // Send dependent nodes for GC instead of destroying them immediately.
+  node->ReleaseChildren();
+  *node = std::move(*subtree);
+  node->parent_ = parent;
+  node->index_ = index;
+  node->sibling_ = std::move(tmp);
+  node->UpdateChildrenParents();
+}
+
+namespace {
+// Bytes of a node with its edges.
+int64_t NodeBytes(const Node* node) {
+  return sizeof(Node) +
+         (node->HasChildren() ? (node->GetNumEdges() + 1) * sizeof(Edge) : 0);
+}
+
+// Children are kept below nodes with at least 2^bucket visits.
+int VisitsBucket(uint32_t n) {
+  int bucket = 0;
+  while (n > 1) {
+    n >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+}  // namespace
+
+int64_t NodeTree::PruneHead(int64_t max_bytes) {
+  // The bytes of the children of the nodes of each visits bucket, with the
+  // head in the last one since its children stay.
+  constexpr int kHeadBucket = 32;
+  std::array<int64_t, kHeadBucket + 1> children_bytes{};
+  const auto for_each_child = [](Node* node, auto&& fn) {
+    if (node->solid_children_) {
+      for (int i = 0; i < node->num_edges_; i++) fn(&node->child_.get()[i]);
+    } else {
+      for (Node* child = node->child_.get(); child;
+           child = child->sibling_.get()) {
+        fn(child);
+      }
+    }
+  };
+  std::vector<Node*> stack{current_head_};
+  while (!stack.empty()) {
+    Node* node = stack.back();
+    stack.pop_back();
+    const int bucket =
+        node == current_head_ ? kHeadBucket : VisitsBucket(node->GetN());
+    for_each_child(node, [&](Node* child) {
+      children_bytes[bucket] += NodeBytes(child);
+      stack.push_back(child);
+    });
+  }
+
+  // The lowest threshold which fits.
+  int64_t kept = NodeBytes(current_head_);
+  for (const auto bytes : children_bytes) kept += bytes;
+  const int64_t total = kept;
+  int threshold_bucket = 0;
+  while (kept > max_bytes && threshold_bucket < kHeadBucket) {
+    kept -= children_bytes[threshold_bucket++];
+  }
+  if (threshold_bucket == 0) return 0;
+  const uint64_t min_visits = uint64_t{1} << threshold_bucket;
+
+  stack.push_back(current_head_);
+  while (!stack.empty()) {
+    Node* node = stack.back();
+    stack.pop_back();
+    for_each_child(node, [&](Node* child) {
+      if (child->GetN() < min_visits) {
+        // Send dependent nodes for GC instead of destroying them immediately.
+        child->ReleaseChildren();
+      } else {
+        stack.push_back(child);
+      }
+    });
+  }
+  return total - kept;
+}
+
+void NodeTree::StashHead(NodeForest* forest) {
+  if (!current_head_ || current_head_->GetN() == 0) return;
+  forest->Add(history_.HashLast(1), Detach(current_head_));
+}
+
+std::unique_ptr<Node> NodeTree::TakeChildFromForest(NodeForest* forest,
+                                                    Move move) {
+  const uint64_t key = history_.HashLast(1);
+  auto subtree = forest->Take(key);
+  if (!subtree) return nullptr;
+  if (HeadPosition().IsBlackToMove()) move.Mirror();
+  const auto& board = HeadPosition().GetBoard();
+  std::unique_ptr<Node> child;
+  for (auto& edge : subtree->Edges()) {
+    if (!board.IsSameMove(edge.GetMove(), move)) continue;
+    if (edge.node() && edge.GetN() > 0) {
+      child = Detach(edge.node());
+      // Takes the child's visits back out of the parent, the rest of the
+      // parent stays in the forest for a takeback.
+      subtree->RevertTerminalVisits(-child->GetWL(), child->GetD(),
+                                    child->GetM() + 1, child->GetN());
+    }
+    break;
+  }
+  if (subtree->GetN() > 0) {
+    forest->Add(key, std::move(subtree));
+  } else {
+    gNodeGc.AddToGcQueue(std::move(subtree));
+  }
+  return child;
+}
+
+bool NodeTree::GraftHead(NodeForest* forest) {
+  auto subtree = forest->Take(history_.HashLast(1));
+  if (!subtree) return false;
+  if (subtree->GetN() <= current_head_->GetN()) {
+    // The tree has searched this position more since, keep that.
+    gNodeGc.AddToGcQueue(std::move(subtree));
+    return false;
+  }
+  Graft(current_head_, std::move(subtree));
+  if (current_head_->IsTerminal()) current_head_->MakeNotTerminal();
+  return true;
+}
+
+void NodeTree::GraftChildren(NodeForest* forest) {
+  for (auto& edge : current_head_->Edges()) {
+    if (edge.GetN() > 0) continue;
+    history_.Append(edge.GetMove());
+    auto subtree = forest->Take(history_.HashLast(1));
+    history_.Pop();
+    if (!subtree) continue;
+    Node* child = edge.GetOrSpawnNode(current_head_);
+    Graft(child, std::move(subtree));
+    // Adds the child's visits to the head as if they were backed up.
+    const int n = child->GetN();
+    current_head_->IncrementNInFlight(n);
+    current_head_->FinalizeScoreUpdate(-child->GetWL(), child->GetD(),
+                                       child->GetM() + 1, n);
+  }
+}
+
 bool NodeTree::ResetToPosition(const std::string& starting_fen,
-                               const std::vector<Move>& moves) {
+                               const std::vector<Move>& moves,
+                               NodeForest* forest) {
   ChessBoard starting_board;
   int no_capture_ply;
   int full_moves;
   starting_board.SetFromFen(starting_fen, &no_capture_ply, &full_moves);
+  // The old head goes to the forest even if the new position extends it, its
+  // subtree is taken back out below on the way to the new head.
+  if (forest) StashHead(forest);
   if (gamebegin_node_ &&
       (history_.Starting().GetBoard() != starting_board ||
        history_.Starting().GetRule50Ply() != no_capture_ply)) {
@@ -517,17 +819,36 @@ bool NodeTree::ResetToPosition(const std::string& starting_fen,
   Node* old_head = current_head_;
   current_head_ = gamebegin_node_.get();
   bool seen_old_head = (gamebegin_node_.get() == old_head);
+  bool grafted = false;
   for (const auto& move : moves) {
+    // Only the subtree of the move played is taken from a position on the
+    // way, like MakeMove keeps only that child.
+    auto child = forest ? TakeChildFromForest(forest, move) : nullptr;
     MakeMove(move);
     if (old_head == current_head_) seen_old_head = true;
+    grafted = child && child->GetN() > current_head_->GetN();
+    if (grafted) {
+      Graft(current_head_, std::move(child));
+      if (current_head_->IsTerminal()) current_head_->MakeNotTerminal();
+    } else {
+      gNodeGc.AddToGcQueue(std::move(child));
+    }
   }
+  if (forest && GraftHead(forest)) grafted = true;
 
   // MakeMove guarantees that no siblings exist; but, if we didn't see the old
   // head, it means we might have a position that was an ancestor to a
   // previously searched position, which means that the current_head_ might
   // retain old n_ and q_ (etc) data, even though its old children were
-  // previously trimmed; we need to reset current_head_ in that case.
-  if (!seen_old_head) TrimTreeAtHead();
+  // previously trimmed; we need to reset current_head_ in that case. A grafted
+  // head is a whole subtree.
+  if (!seen_old_head && !grafted) TrimTreeAtHead();
+  if (forest) {
+    // Children taken out on the way to a later head come back, e.g. after a
+    // takeback.
+    GraftChildren(forest);
+    forest->EnforceCapacity();
+  }
   return seen_old_head;
 }
 
@@ -28,10 +28,13 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <iostream>
+#include <list>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 
 #include "chess/lc0_board.h"
 #include "chess/lc0_callbacks.h"
@@ -81,10 +84,20 @@ namespace lczero {
 //                                       +------------+
 
 class Node;
+class Edge;
+class NodeGarbageCollector;
+
+// Frees an edge array made by Edge::FromMovelist(), which keeps its size in
+// an extra edge in front of it, and takes its bytes off the node memory.
+struct EdgeArrayDeleter {
+  void operator()(Edge* edges) const;
+};
+using EdgeArray = std::unique_ptr<Edge[], EdgeArrayDeleter>;
+
 class Edge {
  public:
   // Creates array of edges from the list of moves.
-  static std::unique_ptr<Edge[]> FromMovelist(const MoveList& moves);
+  static EdgeArray FromMovelist(const MoveList& moves);
 
   // Returns move from the point of view of the player making it (if as_opponent
   // is false) or as opponent (if as_opponent is true).
@@ -108,6 +121,7 @@ class Edge {
   // network; compressed to a 16 bit format (5 bits exp, 11 bits significand).
   uint16_t p_ = 0;
   friend class Node;
+  friend struct EdgeArrayDeleter;
 };
 
 struct Eval {
@@ -137,13 +151,24 @@ class Node {
         terminal_type_(Terminal::NonTerminal),
         lower_bound_(GameResult::BLACK_WON),
         upper_bound_(GameResult::WHITE_WON),
-        solid_children_(false) {}
+        solid_children_(false) {
+    allocated_bytes_.fetch_add(sizeof(Node), std::memory_order_relaxed);
+  }
 
   // We have a custom destructor, but its behavior does not need to be emulated
-  // during move operations so default is fine.
-  Node(Node&& move_from) = default;
+  // during move operations so default is fine. The move constructor only has
+  // to count the new node.
+  Node(Node&& move_from) : Node(move_from.parent_, move_from.index_) {
+    *this = std::move(move_from);
+  }
   Node& operator=(Node&& move_from) = default;
 
+  // Returns the bytes of all Node and Edge objects alive: of the trees, of the
+  // forest and those waiting for the garbage collector.
+  static int64_t GetAllocatedBytes() {
+    return allocated_bytes_.load(std::memory_order_relaxed);
+  }
+
   // Allocates a new edge and a new node. The node has to be no edges before
   // that.
   Node* CreateSingleChildNode(Move m);
@@ -252,6 +277,7 @@ class Node {
   // Reallocates this nodes children to be in a solid block, if possible and not
   // already done. Returns true if the transformation was performed.
   bool MakeSolid();
+  bool HasSolidChildren() const { return solid_children_; }
 
   void SortEdges();
 
@@ -268,6 +294,7 @@ class Node {
       std::allocator<Node> alloc;
       alloc.deallocate(child_.release(), num_edges_);
     }
+    allocated_bytes_.fetch_sub(sizeof(Node), std::memory_order_relaxed);
   }
 
  private:
@@ -288,7 +315,7 @@ class Node {
 
   // 8 byte fields on 64-bit platforms, 4 byte on 32-bit.
   // Array of edges.
-  std::unique_ptr<Edge[]> edges_;
+  EdgeArray edges_;
   // Pointer to a parent node. nullptr for the root.
   Node* parent_ = nullptr;
   // Pointer to a first child. nullptr for a leaf node.
@@ -328,11 +355,16 @@ class Node {
   // Whether the child_ is actually an array of equal length to edges.
   bool solid_children_ : 1;
 
+  // Bytes of all Node and Edge objects alive.
+  static std::atomic<int64_t> allocated_bytes_;
+
   // TODO(mooskagh) Unfriend NodeTree.
   friend class NodeTree;
+  friend class NodeGarbageCollector;
   friend class Edge_Iterator<true>;
   friend class Edge_Iterator<false>;
   friend class Edge;
+  friend struct EdgeArrayDeleter;
   friend class VisitedNode_Iterator<true>;
   friend class VisitedNode_Iterator<false>;
 };
@@ -628,6 +660,54 @@ inline VisitedNode_Iterator<false> Node::VisitedNodes() {
   return {*this, child_.get()};
 }
 
+// Subtrees of previously searched positions, kept after the position moved
+// elsewhere (takebacks, other variations, a new game) so that they can be
+// grafted back in when the position is set up again. Keyed by
+// PositionHistory::HashLast(1), i.e. by the position, its repetitions and the
+// rule50 ply, like the NN cache with the default history length, so that
+// transpositions share a subtree. Two-fold draws which refer to the old game
+// history are reverted by search as usual.
+// When more visits than the capacity are kept, the oldest subtrees are sent to
+// the garbage collector.
+class NodeForest {
+ public:
+  ~NodeForest() { Clear(); }
+  // Sets the total number of visits to keep.
+  void SetCapacity(uint64_t visits);
+  uint64_t GetCapacity() const { return capacity_; }
+  // Takes ownership of a detached subtree, replacing the one of the same key.
+  // Does not evict, so that the subtree can be taken back while the tree is
+  // set up, EnforceCapacity() has to be called afterwards.
+  void Add(uint64_t key, std::unique_ptr<Node> subtree);
+  // Removes the subtree of the key from the forest and returns it, nullptr if
+  // there is none.
+  std::unique_ptr<Node> Take(uint64_t key);
+  // Evicts the oldest subtrees until no more than capacity visits are kept.
+  void EnforceCapacity();
+  void Clear();
+  size_t GetSize() const { return entries_.size(); }
+  uint64_t GetVisits() const { return visits_; }
+
+ private:
+  struct Entry {
+    uint64_t key;
+    std::unique_ptr<Node> subtree;
+  };
+  void Evict(std::list<Entry>::iterator iter);
+
+  // Oldest first.
+  std::list<Entry> entries_;
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+  uint64_t capacity_ = 0;
+  uint64_t visits_ = 0;
+};
+
+// Frees the subtrees waiting for the garbage collector right away, in the
+// calling thread and the GC threads.
+void CollectNodeGarbage();
+// Sets the number of threads freeing subtrees. Not to be called concurrently.
+void SetNodeGarbageCollectorThreads(int threads);
+
 class NodeTree {
  public:
   ~NodeTree() { DeallocateTree(); }
@@ -642,8 +722,19 @@ class NodeTree {
   // Returns whether a new position the same game as old position (with some
   // moves added). Returns false, if the position is completely different,
   // or if it's shorter than before.
+  // With @forest, the subtree of the old head is detached into it first, and
+  // subtrees from it are grafted back in on the way to the new head.
   bool ResetToPosition(const std::string& starting_fen,
-                       const std::vector<Move>& moves);
+                       const std::vector<Move>& moves,
+                       NodeForest* forest = nullptr);
+  // Detaches the subtree of the current head into @forest, if it has visits.
+  // The head is left as a fresh node.
+  void StashHead(NodeForest* forest);
+  // Releases the children of the least visited nodes under the current head,
+  // with the same visits threshold everywhere, until the nodes and edges left
+  // take at most @max_bytes. The head and its children are always kept.
+  // Returns the bytes released. Must not be called while a search is running.
+  int64_t PruneHead(int64_t max_bytes);
   const Position& HeadPosition() const { return history_.Last(); }
   int GetPlyCount() const { return HeadPosition().GetGamePly(); }
   bool IsBlackToMove() const { return HeadPosition().IsBlackToMove(); }
@@ -653,6 +744,19 @@ class NodeTree {
 
  private:
   void DeallocateTree();
+  // Moves the subtree of @node out, leaving a fresh node in its place.
+  std::unique_ptr<Node> Detach(Node* node);
+  // Moves @subtree into the place of @node, releasing the children of @node.
+  void Graft(Node* node, std::unique_ptr<Node> subtree);
+  // Takes the subtree of the child reached by @move out of the subtree of the
+  // current head's position in @forest, nullptr if there is none.
+  std::unique_ptr<Node> TakeChildFromForest(NodeForest* forest, Move move);
+  // Replaces the current head by the subtree of its position from @forest, if
+  // that has more visits. Returns whether it did.
+  bool GraftHead(NodeForest* forest);
+  // Grafts the subtrees of unvisited children of the current head from
+  // @forest.
+  void GraftChildren(NodeForest* forest);
   // A node which to start search from.
   Node* current_head_ = nullptr;
   // Root node of a game tree.
@@ -31,6 +31,7 @@
 #include <cctype>
 #include <cmath>
 
+#include "mcts/stoppers/lc0_common.h"
 #include "utils/lc0_exception.h"
 #include "utils/lc0_string.h"
 
@@ -159,9 +160,10 @@ const OptionId SearchParams::kMiniBatchSizeId{
     "small number of playouts."};
 const OptionId SearchParams::kMaxPrefetchBatchId{
     "max-prefetch", "MaxPrefetch",
-    "When the engine cannot gather a large enough batch for immediate use, try "
-    "to prefetch up to X positions which are likely to be useful soon, and put "
-    "them into cache."};
+    "When the engine cannot gather a large enough batch for immediate use, fill "
+    "it up to X positions (at most the minibatch size) with the unexpanded "
+    "moves of highest policy along the best line, and put them into cache. "
+    "Prefetches less when few of the earlier ones got used."};
 const OptionId SearchParams::kCpuctId{
     "cpuct", "CPuct",
     "cpuct_init constant from \"UCT search\" algorithm. Higher values promote "
@@ -455,6 +457,32 @@ const OptionId SearchParams::kUCIRatingAdvId{
 const OptionId SearchParams::kSearchSpinBackoffId{
     "search-spin-backoff", "SearchSpinBackoff",
     "Enable backoff for the spin lock that acquires available searcher."};
+const OptionId SearchParams::kBackgroundSearchVisitsId{
+    "background-search-visits", "BackgroundSearchVisits",
+    "After a bestmove of the search limits (not of a stop command), keep "
+    "extending the search tree while waiting for the next "
+    "command, until the tree has this many visits. The next search of a "
+    "position in the tree starts from them. 0 disables background search."};
+const OptionId SearchParams::kBackgroundSearchCpuShareId{
+    "background-search-cpu-share", "BackgroundSearchCpuShare",
+    "Percentage of the time the search threads work during background search, "
+    "they sleep the rest."};
+const OptionId SearchParams::kBackgroundSolidifyId{
+    "background-solidify", "BackgroundSolidify",
+    "Solidify the nodes past SolidTreeThreshold in the watchdog thread, a few "
+    "times a second, instead of in the search threads during backups."};
+const OptionId SearchParams::kVectorizedPuctId{
+    "vectorized-puct", "VectorizedPuct",
+    "Score the children of solidified nodes with SIMD instructions, several "
+    "at a time, instead of one by one while looking for the best child."};
+const OptionId SearchParams::kSearchCoroutinesId{
+    "search-coroutines", "SearchCoroutines",
+    "Search workers run by each search thread. A worker hands its batch to the "
+    "backend and the thread gathers the batches of the others until the "
+    "results are there, so a few threads keep a batching backend "
+    "(multiplexing) busy with large batches. Backends computing on the search "
+    "thread gain nothing from it. With more than one, TaskWorkers is ignored "
+    "as the threads of the workers would outnumber the cores."};
 
 void SearchParams::Populate(OptionsParser* options) {
   // Here the uci optimized defaults" are set.
@@ -551,6 +579,11 @@ void SearchParams::Populate(OptionsParser* options) {
   options->Add<StringOption>(kUCIOpponentId);
   options->Add<FloatOption>(kUCIRatingAdvId, -10000.0f, 10000.0f) = 0.0f;
   options->Add<BoolOption>(kSearchSpinBackoffId) = false;
+  options->Add<IntOption>(kBackgroundSearchVisitsId, 0, 2000000000) = 0;
+  options->Add<IntOption>(kBackgroundSearchCpuShareId, 1, 100) = 25;
+  options->Add<BoolOption>(kBackgroundSolidifyId) = false;
+  options->Add<BoolOption>(kVectorizedPuctId) = true;
+  options->Add<IntOption>(kSearchCoroutinesId, 1, 256) = 1;
 
   options->HideOption(kNoiseEpsilonId);
   options->HideOption(kNoiseAlphaId);
@@ -642,8 +675,11 @@ SearchParams::SearchParams(const OptionsDict& options)
                               options.Get<int>(kMiniBatchSizeId)))),
       kNpsLimit(options.Get<float>(kNpsLimitId)),
       kSolidTreeThreshold(options.Get<int>(kSolidTreeThresholdId)),
+      // Every coroutine is a worker, their task threads would multiply.
       kTaskWorkersPerSearchWorker(
-          options.Get<int>(kTaskWorkersPerSearchWorkerId)),
+          options.Get<int>(kSearchCoroutinesId) > 1
+              ? 0
+              : options.Get<int>(kTaskWorkersPerSearchWorkerId)),
       kMinimumWorkSizeForProcessing(
           options.Get<int>(kMinimumWorkSizeForProcessingId)),
       kMinimumWorkSizeForPicking(
@@ -660,6 +696,14 @@ SearchParams::SearchParams(const OptionsDict& options)
           options.Get<int>(kMaxCollisionVisitsScalingEndId)),
       kMaxCollisionVisitsScalingPower(
           options.Get<float>(kMaxCollisionVisitsScalingPowerId)),
-      kSearchSpinBackoff(options_.Get<bool>(kSearchSpinBackoffId)) {}
+      kSearchSpinBackoff(options_.Get<bool>(kSearchSpinBackoffId)),
+      kBackgroundSearchVisits(options.Get<int>(kBackgroundSearchVisitsId)),
+      kBackgroundSearchCpuShare(
+          options.Get<int>(kBackgroundSearchCpuShareId)),
+      kBackgroundSolidify(options.Get<bool>(kBackgroundSolidifyId)),
+      kVectorizedPuct(options.Get<bool>(kVectorizedPuctId)),
+      kSearchCoroutines(options.Get<int>(kSearchCoroutinesId)),
+      kMaxTreeMemoryBytes(options.GetOrDefault<int>(kMaxTreeMemoryMbId, 0) *
+                          1048576LL) {}
 
 }  // namespace lczero
@@ -159,6 +159,15 @@ class SearchParams {
     return kMaxCollisionVisitsScalingPower;
   }
   bool GetSearchSpinBackoff() const { return kSearchSpinBackoff; }
+  int64_t GetBackgroundSearchVisits() const {
+    return kBackgroundSearchVisits;
+  }
+  int GetBackgroundSearchCpuShare() const { return kBackgroundSearchCpuShare; }
+  bool GetBackgroundSolidify() const { return kBackgroundSolidify; }
+  bool GetVectorizedPuct() const { return kVectorizedPuct; }
+  int GetSearchCoroutines() const { return kSearchCoroutines; }
+  // MaxTreeMemoryMB in bytes, 0 when there is no limit or no such option.
+  int64_t GetMaxTreeMemoryBytes() const { return kMaxTreeMemoryBytes; }
 
   // Search parameter IDs.
   static const OptionId kMiniBatchSizeId;
@@ -231,6 +240,11 @@ class SearchParams {
   static const OptionId kUCIOpponentId;
   static const OptionId kUCIRatingAdvId;
   static const OptionId kSearchSpinBackoffId;
+  static const OptionId kBackgroundSearchVisitsId;
+  static const OptionId kBackgroundSearchCpuShareId;
+  static const OptionId kBackgroundSolidifyId;
+  static const OptionId kVectorizedPuctId;
+  static const OptionId kSearchCoroutinesId;
 
  private:
   const OptionsDict& options_;
@@ -288,6 +302,12 @@ class SearchParams {
   const int kMaxCollisionVisitsScalingEnd;
   const float kMaxCollisionVisitsScalingPower;
   const bool kSearchSpinBackoff;
+  const int64_t kBackgroundSearchVisits;
+  const int kBackgroundSearchCpuShare;
+  const bool kBackgroundSolidify;
+  const bool kVectorizedPuct;
+  const int kSearchCoroutines;
+  const int64_t kMaxTreeMemoryBytes;
 };
 
 }  // namespace lczero
@@ -31,12 +31,19 @@
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <deque>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <sstream>
 #include <thread>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 #include "mcts/lc0_node.h"
 #include "neural/lc0_cache.h"
 #include "neural/lc0_encoder.h"
@@ -155,12 +162,13 @@ Search::Search(const NodeTree& tree, Network* network,
                std::chrono::steady_clock::time_point start_time,
                std::unique_ptr<SearchStopper> stopper, bool infinite,
                bool ponder, const OptionsDict& options, NNCache* cache,
-               SyzygyTablebase* syzygy_tb)
+               SyzygyTablebase* syzygy_tb, TranspositionTable* transpositions)
     : ok_to_respond_bestmove_(!infinite && !ponder),
       stopper_(std::move(stopper)),
       root_node_(tree.GetCurrentHead()),
       cache_(cache),
       syzygy_tb_(syzygy_tb),
+      transpositions_(transpositions),
       played_history_(tree.GetPositionHistory()),
       network_(network),
       params_(options),
@@ -455,6 +463,51 @@ inline float ComputeCpuct(const SearchParams& params, uint32_t N,
   const float base = params.GetCpuctBase(is_root_node);
   return init + (k ? k * FastLog((N + base) / base) : 0.0f);
 }
+
+// Writes pol * puct_mult / (1 + nstarted) + util, the PUCT score, of count
+// children into score; 8 or 4 at a time with AVX, SSE2 or NEON. The operations
+// are the same as the scalar formula so the scores are exactly the same.
+inline void ComputePuctScores(const float* pol, const int* nstarted,
+                              const float* util, float puct_mult, int count,
+                              float* score) {
+  int i = 0;
+#if defined(__AVX__)
+  const __m256 mult8 = _mm256_set1_ps(puct_mult);
+  const __m256 one8 = _mm256_set1_ps(1.0f);
+  for (; i + 8 <= count; i += 8) {
+    // nstarted stays far below 2^24, so adding 1 after the conversion is exact.
+    const __m256 n = _mm256_add_ps(
+        _mm256_cvtepi32_ps(_mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(nstarted + i))),
+        one8);
+    const __m256 u = _mm256_div_ps(
+        _mm256_mul_ps(_mm256_loadu_ps(pol + i), mult8), n);
+    _mm256_storeu_ps(score + i, _mm256_add_ps(u, _mm256_loadu_ps(util + i)));
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128 mult = _mm_set1_ps(puct_mult);
+  const __m128i one = _mm_set1_epi32(1);
+  for (; i + 4 <= count; i += 4) {
+    const __m128 n = _mm_cvtepi32_ps(_mm_add_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(nstarted + i)), one));
+    const __m128 u = _mm_div_ps(_mm_mul_ps(_mm_loadu_ps(pol + i), mult), n);
+    _mm_storeu_ps(score + i, _mm_add_ps(u, _mm_loadu_ps(util + i)));
+  }
+#elif defined(__aarch64__)
+  const float32x4_t mult = vdupq_n_f32(puct_mult);
+  const int32x4_t one = vdupq_n_s32(1);
+  for (; i + 4 <= count; i += 4) {
+    const float32x4_t n =
+        vcvtq_f32_s32(vaddq_s32(vld1q_s32(nstarted + i), one));
+    const float32x4_t u = vdivq_f32(vmulq_f32(vld1q_f32(pol + i), mult), n);
+    vst1q_f32(score + i, vaddq_f32(u, vld1q_f32(util + i)));
+  }
+#endif
+  for (; i < count; ++i) {
+    score[i] = pol[i] * puct_mult / (1 + nstarted[i]) + util[i];
+  }
+}
 }  // namespace
 
 std::vector<std::string> Search::GetVerboseStats(Node* node) const {
@@ -616,13 +669,31 @@ void Search::MaybeTriggerStop(const IterationStats& stats,
   }
   SharedMutex::Lock nodes_lock(nodes_mutex_);
   Mutex::Lock lock(counters_mutex_);
-  // Already responded bestmove, nothing to do here.
-  if (bestmove_is_sent_) return;
+  // Already responded bestmove, only the background search may be left.
+  if (bestmove_is_sent_) {
+    Node* background_node = background_node_.load(std::memory_order_acquire);
+    if (background_.load(std::memory_order_acquire) && background_node &&
+        (stats.total_nodes >= params_.GetBackgroundSearchVisits() ||
+         (params_.GetMaxTreeMemoryBytes() &&
+          Node::GetAllocatedBytes() >= params_.GetMaxTreeMemoryBytes()) ||
+         background_node->IsTerminal())) {
+      LOGFILE << "Background search done, " << stats.total_nodes
+              << " visits in the tree.";
+      background_.store(false, std::memory_order_release);
+      FireStopInternal();
+    }
+    return;
+  }
   // Don't stop when the root node is not yet expanded.
   if (total_playouts_ + initial_visits_ == 0) return;
 
   if (!stop_.load(std::memory_order_acquire)) {
-    if (stopper_->ShouldStop(stats, hints)) FireStopInternal();
+    if (stopper_->ShouldStop(stats, hints)) {
+      // Set before the stop, so that no thread exits in between.
+      background_.store(BackgroundSearchWanted(stats.total_nodes),
+                        std::memory_order_release);
+      FireStopInternal();
+    }
   }
 
   // If we are the first to see that stop is needed.
@@ -636,9 +707,53 @@ void Search::MaybeTriggerStop(const IterationStats& stats,
     stopper_->OnSearchDone(stats);
     bestmove_is_sent_ = true;
     current_best_edge_ = EdgeAndNode();
+    // Until the next command the threads extend the subtree of the move
+    // played, which the next search starts from.
+    if (background_.load(std::memory_order_acquire)) {
+      Node* node = nullptr;
+      background_moves_.clear();
+      for (const auto& edge : root_node_->Edges()) {
+        if (edge.GetMove(played_history_.IsBlackToMove()) == final_bestmove_) {
+          node = edge.node();
+          background_moves_.push_back(edge.GetMove());
+          break;
+        }
+      }
+      if (node && node->GetN() > 0 && !node->IsTerminal() &&
+          stats.total_nodes < params_.GetBackgroundSearchVisits() &&
+          running_workers_.load(std::memory_order_acquire) > 0) {
+        // The next search starts after the reply, most likely the ponder
+        // move, so the visits go below it rather than to every reply.
+        for (const auto& edge : node->Edges()) {
+          if (edge.GetMove(!played_history_.IsBlackToMove()) ==
+              final_pondermove_) {
+            Node* reply = edge.node();
+            if (reply && reply->GetN() > 0 && !reply->IsTerminal()) {
+              node = reply;
+              background_moves_.push_back(edge.GetMove());
+            }
+            break;
+          }
+        }
+        LOGFILE << "Background search started after "
+                << final_bestmove_.as_string() << ", "
+                << background_moves_.size() << " plies deep.";
+        background_start_playouts_ = total_playouts_;
+        background_node_.store(node, std::memory_order_release);
+        stop_.store(false, std::memory_order_release);
+      } else {
+        background_.store(false, std::memory_order_release);
+      }
+    }
   }
 }
 
+bool Search::BackgroundSearchWanted(int64_t total_nodes) const
+    REQUIRES(counters_mutex_) {
+  return ok_to_respond_bestmove_ &&
+         total_nodes < params_.GetBackgroundSearchVisits();
+}
+
 // Return the evaluation of the actual best child, regardless of temperature
 // settings. This differs from GetBestMove, which does obey any temperature
 // settings. So, somethimes, they may return results of different moves.
@@ -668,6 +783,31 @@ std::int64_t Search::GetTotalPlayouts() const {
   return total_playouts_;
 }
 
+std::int64_t Search::GetForegroundPlayouts() const {
+  SharedMutex::SharedLock lock(nodes_mutex_);
+  return background_start_playouts_ < 0 ? total_playouts_
+                                        : background_start_playouts_;
+}
+
+std::int64_t Search::GetBackgroundPlayouts() const {
+  SharedMutex::SharedLock lock(nodes_mutex_);
+  return background_start_playouts_ < 0
+             ? 0
+             : total_playouts_ - background_start_playouts_;
+}
+
+void Search::GetPrefetchStats(uint64_t* evals, uint64_t* used) const {
+  *evals = prefetch_evals_.load(std::memory_order_relaxed);
+  *used = prefetch_used_.load(std::memory_order_relaxed);
+}
+
+void Search::GetTranspositionStats(uint64_t* probes, uint64_t* hits,
+                                   uint64_t* borrowed) const {
+  *probes = tt_probes_.load(std::memory_order_relaxed);
+  *hits = tt_hits_.load(std::memory_order_relaxed);
+  *borrowed = tt_borrowed_.load(std::memory_order_relaxed);
+}
+
 void Search::ResetBestMove() {
   SharedMutex::Lock nodes_lock(nodes_mutex_);
   Mutex::Lock lock(counters_mutex_);
@@ -888,7 +1028,8 @@ EdgeAndNode Search::GetBestRootChildWithTemperature(float temperature) const {
 }
 
 void Search::StartThreads(size_t how_many) {
-  thread_count_.store(how_many, std::memory_order_release);
+  const int coroutines = params_.GetSearchCoroutines();
+  thread_count_.store(how_many * coroutines, std::memory_order_release);
   Mutex::Lock lock(threads_mutex_);
   // First thread is a watchdog thread.
   if (threads_.size() == 0) {
@@ -896,9 +1037,15 @@ void Search::StartThreads(size_t how_many) {
   }
   // Start working threads.
   for (size_t i = 0; i < how_many; i++) {
-    threads_.emplace_back([this, i]() {
-      SearchWorker worker(this, params_, i);
-      worker.RunBlocking();
+    running_workers_.fetch_add(1, std::memory_order_acq_rel);
+    threads_.emplace_back([this, i, coroutines]() {
+      if (coroutines > 1) {
+        RunWorkerCoroutines(i, coroutines);
+      } else {
+        SearchWorker worker(this, params_, i);
+        worker.RunBlocking();
+      }
+      running_workers_.fetch_add(-1, std::memory_order_acq_rel);
     });
   }
   LOGFILE << "Search started. "
@@ -913,8 +1060,85 @@ void Search::RunBlocking(size_t threads) {
   Wait();
 }
 
+void Search::RunWorkerCoroutines(size_t thread_id, int count) {
+  std::vector<std::unique_ptr<SearchWorker>> workers;
+  for (int i = 0; i < count; i++) {
+    workers.push_back(
+        std::make_unique<SearchWorker>(this, params_, thread_id * count + i));
+    workers.back()->SetSleepWhenIdle(false);
+  }
+  LOGFILE << "Started search thread with " << count << " coroutines.";
+  std::vector<SearchWorker*> idle;
+  for (auto& worker : workers) idle.push_back(worker.get());
+  // Workers suspended at their NN computation, oldest first.
+  std::deque<SearchWorker*> suspended;
+  // The thread sleeps like a lone worker once a whole round of its workers
+  // had nothing but collisions and none waits for results, which would clear
+  // the collisions.
+  int idle_iterations = 0;
+  auto finish = [&](SearchWorker* worker) {
+    worker->FinishIteration();
+    idle.push_back(worker);
+    idle_iterations = worker->HadWork() ? 0 : idle_iterations + 1;
+    if (idle_iterations >= count && suspended.empty()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      idle_iterations = 0;
+    }
+  };
+  try {
+    // As in SearchWorker::RunBlocking(), every worker runs at least one
+    // iteration.
+    bool first = true;
+    while (true) {
+      if (first || IsSearchActive()) {
+        // Each worker gathers its batch and suspends once it is handed to the
+        // backend, the next one gathers meanwhile.
+        while (!idle.empty()) {
+          SearchWorker* worker = idle.back();
+          idle.pop_back();
+          if (worker->StartIteration()) {
+            suspended.push_back(worker);
+          } else {
+            idle.insert(idle.begin(), worker);
+            break;
+          }
+        }
+        first = false;
+      } else if (suspended.empty()) {
+        break;
+      }
+      if (suspended.empty()) continue;
+      // Resume the workers whose results are there, or else wait for the
+      // oldest, the backends compute in order.
+      bool resumed = false;
+      for (auto it = suspended.begin(); it != suspended.end();) {
+        if ((*it)->IsNNComputationReady()) {
+          SearchWorker* worker = *it;
+          it = suspended.erase(it);
+          finish(worker);
+          resumed = true;
+        } else {
+          ++it;
+        }
+      }
+      if (!resumed) {
+        SearchWorker* worker = suspended.front();
+        suspended.pop_front();
+        finish(worker);
+      }
+    }
+  } catch (std::exception& e) {
+    std::cerr << "Unhandled exception in worker thread: " << e.what()
+              << std::endl;
+    abort();
+  }
+}
+
 bool Search::IsSearchActive() const {
-  return !stop_.load(std::memory_order_acquire);
+  // Between the stop and bestmove, threads keep going if a background search
+  // follows.
+  return !stop_.load(std::memory_order_acquire) ||
+         background_.load(std::memory_order_acquire);
 }
 
 void Search::PopulateCommonIterationStats(IterationStats* stats) {
@@ -990,6 +1214,7 @@ void Search::WatchdogThread() {
     PopulateCommonIterationStats(&stats);
     MaybeTriggerStop(stats, &hints);
     MaybeOutputInfo();
+    if (params_.GetBackgroundSolidify()) SolidifyTree();
 
     constexpr auto kMaxWaitTimeMs = 100;
     constexpr auto kMinWaitTimeMs = 1;
@@ -997,7 +1222,10 @@ void Search::WatchdogThread() {
     Mutex::Lock lock(counters_mutex_);
     // Only exit when bestmove is responded. It may happen that search threads
     // already all exited, and we need at least one thread that can do that.
-    if (bestmove_is_sent_) break;
+    // A background search is watched for its visits budget.
+    if (bestmove_is_sent_ && !background_.load(std::memory_order_acquire)) {
+      break;
+    }
 
     auto remaining_time = hints.GetEstimatedRemainingTimeMs();
     if (remaining_time > kMaxWaitTimeMs) remaining_time = kMaxWaitTimeMs;
@@ -1015,6 +1243,54 @@ void Search::WatchdogThread() {
   LOGFILE << "End a watchdog thread.";
 }
 
+void Search::SolidifyTree() {
+  const uint32_t solid_threshold =
+      static_cast<uint32_t>(params_.GetSolidTreeThreshold());
+  SharedMutex::Lock lock(nodes_mutex_);
+  // Children of a node have fewer visits, so the walk stays in the part of
+  // the tree past the threshold.
+  std::vector<Node*> nodes;
+  if (root_node_->GetN() >= solid_threshold) nodes.push_back(root_node_);
+  while (!nodes.empty()) {
+    Node* node = nodes.back();
+    nodes.pop_back();
+    if (node->MakeSolid()) OnSolidified(node);
+    for (Node* child : node->VisitedNodes()) {
+      if (child->GetN() >= solid_threshold) nodes.push_back(child);
+    }
+  }
+}
+
+void Search::OnSolidified(Node* node) {
+  // If we make the root solid, the current_best_edge_ becomes invalid and
+  // we should repopulate it.
+  if (node == root_node_) {
+    current_best_edge_ = GetBestChildNoTemperature(root_node_, 0);
+  }
+  // The background node moved if it is below the node, it is found again
+  // either way, the path is at most two plies.
+  if (background_node_.load(std::memory_order_acquire)) {
+    background_node_.store(FindBackgroundNode(), std::memory_order_release);
+  }
+}
+
+Node* Search::FindBackgroundNode() const {
+  Node* node = root_node_;
+  for (const Move move : background_moves_) {
+    Node* child = nullptr;
+    for (auto& edge : node->Edges()) {
+      if (edge.GetMove() == move) {
+        child = edge.node();
+        break;
+      }
+    }
+    // Solidification moves nodes but keeps them all.
+    assert(child);
+    node = child;
+  }
+  return node;
+}
+
 void Search::FireStopInternal() {
   stop_.store(true, std::memory_order_release);
   watchdog_cv_.notify_all();
@@ -1023,12 +1299,16 @@ void Search::FireStopInternal() {
 void Search::Stop() {
   Mutex::Lock lock(counters_mutex_);
   ok_to_respond_bestmove_ = true;
+  // The user asked the engine to stop, so no background search follows and a
+  // running one ends. Only a bestmove of the stoppers starts one.
+  background_.store(false, std::memory_order_release);
   FireStopInternal();
   LOGFILE << "Stopping search due to `stop` uci command.";
 }
 
 void Search::Abort() {
   Mutex::Lock lock(counters_mutex_);
+  background_.store(false, std::memory_order_release);
   if (!stop_.load(std::memory_order_acquire) ||
       (!bestmove_is_sent_ && !ok_to_respond_bestmove_)) {
     bestmove_is_sent_ = true;
@@ -1070,35 +1350,46 @@ Search::~Search() {
 // SearchWorker
 //////////////////////////////////////////////////////////////////////////////
 
+int SearchWorker::TakeTask() {
+  int nta = tasks_taken_.load(std::memory_order_acquire);
+  while (nta < task_count_.load(std::memory_order_acquire)) {
+    // A plain CAS on the counter, on failure nta holds the fresh value.
+    if (tasks_taken_.compare_exchange_weak(nta, nta + 1,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+      return nta;
+    }
+  }
+  return -1;
+}
+
+void SearchWorker::RunTask(int id, TaskWorkspace* workspace) {
+  auto& task = picking_tasks_[id];
+  switch (task.task_type) {
+    case PickTask::kGathering: {
+      PickNodesToExtendTask(task.start, task.base_depth, task.collision_limit,
+                            task.moves_to_base, &(task.results), workspace);
+      break;
+    }
+    case PickTask::kProcessing: {
+      ProcessPickedTask(task.start_idx, task.end_idx, workspace);
+      break;
+    }
+  }
+  task.complete = true;
+  completed_tasks_.fetch_add(1, std::memory_order_acq_rel);
+}
+
 void SearchWorker::RunTasks(int tid) {
   while (true) {
-    PickTask* task = nullptr;
-    int id = 0;
+    int id = -1;
     {
       int spins = 0;
       while (true) {
-        int nta = tasks_taken_.load(std::memory_order_acquire);
+        id = TakeTask();
+        if (id >= 0) break;
         int tc = task_count_.load(std::memory_order_acquire);
-        if (nta < tc) {
-          int val = 0;
-          if (task_taking_started_.compare_exchange_weak(
-                  val, 1, std::memory_order_acq_rel,
-                  std::memory_order_relaxed)) {
-            nta = tasks_taken_.load(std::memory_order_acquire);
-            tc = task_count_.load(std::memory_order_acquire);
-            // We got the spin lock, double check we're still in the clear.
-            if (nta < tc) {
-              id = tasks_taken_.fetch_add(1, std::memory_order_acq_rel);
-              task = &picking_tasks_[id];
-              task_taking_started_.store(0, std::memory_order_release);
-              break;
-            }
-            task_taking_started_.store(0, std::memory_order_release);
-          }
-          SpinloopPause();
-          spins = 0;
-          continue;
-        } else if (tc != -1) {
+        if (tc != -1) {
           spins++;
           if (spins >= 512) {
             std::this_thread::yield();
@@ -1112,7 +1403,7 @@ void SearchWorker::RunTasks(int tid) {
         // Looks like sleep time.
         Mutex::Lock lock(picking_tasks_mutex_);
         // Refresh them now we have the lock.
-        nta = tasks_taken_.load(std::memory_order_acquire);
+        int nta = tasks_taken_.load(std::memory_order_acquire);
         tc = task_count_.load(std::memory_order_acquire);
         if (tc != -1) continue;
         if (nta >= tc && exiting_) return;
@@ -1123,27 +1414,16 @@ void SearchWorker::RunTasks(int tid) {
         if (nta >= tc && exiting_) return;
       }
     }
-    if (task != nullptr) {
-      switch (task->task_type) {
-        case PickTask::kGathering: {
-          PickNodesToExtendTask(task->start, task->base_depth,
-                                task->collision_limit, task->moves_to_base,
-                                &(task->results), &(task_workspaces_[tid]));
-          break;
-        }
-        case PickTask::kProcessing: {
-          ProcessPickedTask(task->start_idx, task->end_idx,
-                            &(task_workspaces_[tid]));
-          break;
-        }
-      }
-      picking_tasks_[id].complete = true;
-      completed_tasks_.fetch_add(1, std::memory_order_acq_rel);
-    }
+    RunTask(id, &(task_workspaces_[tid]));
   }
 }
 
 void SearchWorker::ExecuteOneIteration() {
+  if (StartIteration()) FinishIteration();
+}
+
+bool SearchWorker::StartIteration() {
+  iteration_start_ = std::chrono::steady_clock::now();
   // 1. Initialize internal structures.
   InitializeIteration(search_->network_->NewComputation());
 
@@ -1164,7 +1444,7 @@ void SearchWorker::ExecuteOneIteration() {
       // at least one iteration.
       if (search_->stop_.load(std::memory_order_acquire) &&
           search_->GetTotalPlayouts() + search_->initial_visits_ > 0) {
-        return;
+        return false;
       }
 
       int available =
@@ -1200,6 +1480,11 @@ void SearchWorker::ExecuteOneIteration() {
 
   // 4. Run NN computation.
   RunNNComputation();
+  return true;
+}
+
+void SearchWorker::FinishIteration() {
+  WaitForNNComputation();
   search_->backend_waiting_counter_.fetch_add(-1, std::memory_order_relaxed);
 
   // 5. Retrieve NN computations (and terminal values) into nodes.
@@ -1230,6 +1515,20 @@ void SearchWorker::ExecuteOneIteration() {
       }
     }
   }
+
+  // In background search, sleep so that the thread works its share of the
+  // time only.
+  const int cpu_share = params_.GetBackgroundSearchCpuShare();
+  if (cpu_share < 100 &&
+      search_->background_.load(std::memory_order_acquire)) {
+    const auto now = std::chrono::steady_clock::now();
+    const auto wake_time =
+        now + (now - iteration_start_) * (100 - cpu_share) / cpu_share;
+    while (search_->IsSearchActive() &&
+           std::chrono::steady_clock::now() < wake_time) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
 }
 
 // 1. Initialize internal structures.
@@ -1241,6 +1540,13 @@ void SearchWorker::InitializeIteration(
   computation_->Reserve(params_.GetMiniBatchSize());
   minibatch_.clear();
   minibatch_.reserve(2 * params_.GetMiniBatchSize());
+  // No task runs between iterations.
+  main_workspace_.tt_keys.clear();
+  main_workspace_.input_planes.clear();
+  for (auto& workspace : task_workspaces_) {
+    workspace.tt_keys.clear();
+    workspace.input_planes.clear();
+  }
 }
 
 // 2. Gather minibatch.
@@ -1340,6 +1646,7 @@ void SearchWorker::GatherMinibatch() {
       needs_wait = true;
       ResetTasks();
       int found = 0;
+      int pushed = 0;
       for (int i = new_start; i < static_cast<int>(minibatch_.size()); i++) {
         auto& picked_node = minibatch_[i];
         if (picked_node.IsCollision()) {
@@ -1347,11 +1654,10 @@ void SearchWorker::GatherMinibatch() {
         }
         ++found;
         if (found == per_worker) {
-          picking_tasks_.emplace_back(ppt_start, i + 1);
-          task_count_.fetch_add(1, std::memory_order_acq_rel);
+          PushTask(PickTask(ppt_start, i + 1));
           ppt_start = i + 1;
           found = 0;
-          if (picking_tasks_.size() == static_cast<size_t>(num_tasks - 1)) {
+          if (++pushed == num_tasks - 1) {
             break;
           }
         }
@@ -1403,8 +1709,9 @@ void SearchWorker::GatherMinibatch() {
         computation_->AddInputByHash(minibatch_[i].hash,
                                      std::move(minibatch_[i].lock));
       } else {
-        computation_->AddInput(minibatch_[i].hash,
-                               std::move(minibatch_[i].input_planes),
+        auto& planes =
+            (*minibatch_[i].input_planes)[minibatch_[i].input_planes_idx];
+        computation_->AddInput(minibatch_[i].hash, std::move(planes),
                                std::move(minibatch_[i].probabilities_to_cache));
       }
     }
@@ -1450,17 +1757,38 @@ void SearchWorker::ProcessPickedTask(int start_idx, int end_idx,
     if (picked_node.IsExtendable()) {
       // Node was never visited, extend it.
       ExtendNode(node, picked_node.depth, picked_node.moves_to_visit, &history);
+      if (search_->transpositions_) {
+        // History now holds the whole path, keys are taken for the backup.
+        const int root_idx = search_->played_history_.GetLength() - 1;
+        auto& tt_keys = workspace->tt_keys;
+        picked_node.tt_keys = &tt_keys;
+        picked_node.tt_key_start = static_cast<uint32_t>(tt_keys.size());
+        picked_node.tt_key_count = history.GetLength() - root_idx;
+        for (int idx = root_idx; idx < history.GetLength(); idx++) {
+          tt_keys.push_back(TranspositionTable::Key(history.GetPositionAt(idx)));
+        }
+      }
       if (!node->IsTerminal()) {
         picked_node.nn_queried = true;
         const auto hash = history.HashLast(params_.GetCacheHistoryLength() + 1);
         picked_node.hash = hash;
         picked_node.lock = NNCacheLock(search_->cache_, hash);
         picked_node.is_cache_hit = picked_node.lock;
+        if (picked_node.is_cache_hit &&
+            picked_node.lock->prefetched.load(std::memory_order_relaxed) &&
+            picked_node.lock->prefetched.exchange(false,
+                                                  std::memory_order_relaxed)) {
+          search_->prefetch_used_.fetch_add(1, std::memory_order_relaxed);
+        }
         if (!picked_node.is_cache_hit) {
           int transform;
-          picked_node.input_planes = EncodePositionForNN(
+          auto& input_planes = workspace->input_planes;
+          picked_node.input_planes = &input_planes;
+          picked_node.input_planes_idx =
+              static_cast<uint32_t>(input_planes.size());
+          input_planes.push_back(EncodePositionForNN(
               search_->network_->GetCapabilities().input_format, history, 8,
-              params_.GetHistoryFill(), &transform);
+              params_.GetHistoryFill(), &transform));
           picked_node.probability_transform = transform;
 
           std::vector<uint16_t>& moves = picked_node.probabilities_to_cache;
@@ -1483,24 +1811,41 @@ void SearchWorker::ProcessPickedTask(int start_idx, int end_idx,
   }
 }
 
-#define MAX_TASKS 100
-
 void SearchWorker::ResetTasks() {
   task_count_.store(0, std::memory_order_release);
+  tasks_reserved_.store(0, std::memory_order_release);
   tasks_taken_.store(0, std::memory_order_release);
   completed_tasks_.store(0, std::memory_order_release);
-  picking_tasks_.clear();
-  // Reserve because resizing breaks pointers held by the task threads.
-  picking_tasks_.reserve(MAX_TASKS);
+}
+
+bool SearchWorker::PushTask(PickTask&& task) {
+  const int slot = tasks_reserved_.fetch_add(1, std::memory_order_acq_rel);
+  if (slot >= kMaxPickTasks) return false;
+  picking_tasks_[slot] = std::move(task);
+  // Publish in slot order, so task_count_ never covers a slot still being
+  // written by another thread. Writers only wait for each other here.
+  int expected = slot;
+  while (!task_count_.compare_exchange_weak(expected, slot + 1,
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_relaxed)) {
+    expected = slot;
+    SpinloopPause();
+  }
+  return true;
 }
 
 int SearchWorker::WaitForTasks() {
-  // Spin lock, other tasks should be done soon.
+  // Other tasks should be done soon, help with the ones nobody took yet.
   while (true) {
     int completed = completed_tasks_.load(std::memory_order_acquire);
     int todo = task_count_.load(std::memory_order_acquire);
     if (todo == completed) return completed;
-    SpinloopPause();
+    const int id = TakeTask();
+    if (id >= 0) {
+      RunTask(id, &main_workspace_);
+    } else {
+      SpinloopPause();
+    }
   }
 }
 
@@ -1517,11 +1862,26 @@ void SearchWorker::PickNodesToExtend(int collision_limit) {
   // Since the tasks perform work which assumes they have the lock, even though
   // actually this thread does.
   SharedMutex::Lock lock(search_->nodes_mutex_);
-  PickNodesToExtendTask(search_->root_node_, 0, collision_limit, empty_movelist,
-                        &minibatch_, &main_workspace_);
+  Node* background_node =
+      search_->background_node_.load(std::memory_order_acquire);
+  if (background_node) {
+    // The moves are played, so the background search picks below them, like
+    // a task split off at the root.
+    for (Node* n = background_node; n != search_->root_node_->GetParent();
+         n = n->GetParent()) {
+      n->IncrementNInFlight(collision_limit);
+    }
+    PickNodesToExtendTask(
+        background_node, static_cast<int>(search_->background_moves_.size()),
+        collision_limit, search_->background_moves_, &minibatch_,
+        &main_workspace_);
+  } else {
+    PickNodesToExtendTask(search_->root_node_, 0, collision_limit,
+                          empty_movelist, &minibatch_, &main_workspace_);
+  }
 
-  WaitForTasks();
-  for (int i = 0; i < static_cast<int>(picking_tasks_.size()); i++) {
+  const int task_count = WaitForTasks();
+  for (int i = 0; i < task_count; i++) {
     for (int j = 0; j < static_cast<int>(picking_tasks_[i].results.size());
          j++) {
       minibatch_.emplace_back(std::move(picking_tasks_[i].results[j]));
@@ -1615,6 +1975,7 @@ void SearchWorker::PickNodesToExtendTask(
   const float odd_draw_score = search_->GetDrawScore(true);
   const auto& root_move_filter = search_->root_move_filter_;
   auto m_evaluator = moves_left_support_ ? MEvaluator(params_) : MEvaluator();
+  const bool vectorized_puct = params_.GetVectorizedPuct();
 
   int max_limit = std::numeric_limits<int>::max();
 
@@ -1726,6 +2087,27 @@ void SearchWorker::PickNodesToExtendTask(
         float second_best = std::numeric_limits<float>::lowest();
         bool can_exit = false;
         best_edge.Reset();
+        if (vectorized_puct && cache_filled_idx + 1 < max_needed &&
+            node->HasSolidChildren()) {
+          // Solid children are one array, walking it is cheap, so take a
+          // snapshot of the visits of all the children at once and score them
+          // together instead of one by one in the loop below.
+          for (int idx = cache_filled_idx + 1; idx < max_needed; ++idx) {
+            if (idx == 0) {
+              cur_iters[idx] = node->Edges();
+            } else {
+              cur_iters[idx] = cur_iters[idx - 1];
+              ++cur_iters[idx];
+            }
+            current_nstarted[idx] = cur_iters[idx].GetNStarted();
+          }
+          ComputePuctScores(current_pol.data() + cache_filled_idx + 1,
+                            current_nstarted.data() + cache_filled_idx + 1,
+                            current_util.data() + cache_filled_idx + 1,
+                            puct_mult, max_needed - cache_filled_idx - 1,
+                            current_score.data() + cache_filled_idx + 1);
+          cache_filled_idx = max_needed - 1;
+        }
         for (int idx = 0; idx < max_needed; ++idx) {
           if (idx > cache_filled_idx) {
             if (idx == 0) {
@@ -1861,24 +2243,15 @@ void SearchWorker::PickNodesToExtendTask(
           // Don't split if not expanded or terminal.
           if (child_node->GetN() == 0 || child_node->IsTerminal()) continue;
 
-          bool passed = false;
-          {
-            // Multiple writers, so need mutex here.
-            Mutex::Lock lock(picking_tasks_mutex_);
-            // Ensure not to exceed size of reservation.
-            if (picking_tasks_.size() < MAX_TASKS) {
-              moves_to_path.push_back(cur_iters[i].GetMove());
-              picking_tasks_.emplace_back(
-                  child_node, current_path.size() - 1 + base_depth + 1,
-                  moves_to_path, child_limit);
-              moves_to_path.pop_back();
-              task_count_.fetch_add(1, std::memory_order_acq_rel);
-              task_added_.notify_all();
-              passed = true;
-              passed_off += child_limit;
-            }
-          }
+          // Multiple writers, PushTask handles them without a mutex. Task
+          // threads spin while tasks are being picked, so no notify here.
+          moves_to_path.push_back(cur_iters[i].GetMove());
+          const bool passed = PushTask(
+              PickTask(child_node, current_path.size() - 1 + base_depth + 1,
+                       moves_to_path, child_limit));
+          moves_to_path.pop_back();
           if (passed) {
+            passed_off += child_limit;
             (*visits_to_perform.back())[i] = 0;
           }
         }
@@ -2014,7 +2387,8 @@ void SearchWorker::ExtendNode(Node* node, int depth,
   node->CreateEdges(legal_moves);
 }
 
-// Returns whether node was already in cache.
+// Adds the position of history_ to the computation as prefetched. Returns
+// whether it was already in cache.
 bool SearchWorker::AddNodeToComputation(Node* node) {
   const auto hash = history_.HashLast(params_.GetCacheHistoryLength() + 1);
   if (search_->cache_->ContainsKey(hash)) {
@@ -2044,7 +2418,7 @@ bool SearchWorker::AddNodeToComputation(Node* node) {
     }
   }
 
-  computation_->AddInput(hash, std::move(planes), std::move(moves));
+  computation_->AddInput(hash, std::move(planes), std::move(moves), true);
   return false;
 }
 
@@ -2063,112 +2437,91 @@ void SearchWorker::CollectCollisions() {
 // 3. Prefetch into cache.
 // ~~~~~~~~~~~~~~~~~~~~~~~
 void SearchWorker::MaybePrefetchIntoCache() {
-  // TODO(mooskagh) Remove prefetch into cache if node collisions work well.
-  // If there are requests to NN, but the batch is not full, try to prefetch
-  // nodes which are likely useful in future.
+  // If there are requests to NN, but the batch is not full, fill the idle
+  // slots with positions which are likely to be visited soon.
   if (search_->stop_.load(std::memory_order_acquire)) return;
-  if (computation_->GetCacheMisses() > 0 &&
-      computation_->GetCacheMisses() < params_.GetMaxPrefetchBatch()) {
-    history_.Trim(search_->played_history_.GetLength());
-    SharedMutex::SharedLock lock(search_->nodes_mutex_);
-    PrefetchIntoCache(
-        search_->root_node_,
-        params_.GetMaxPrefetchBatch() - computation_->GetCacheMisses(), false);
-  }
+  const int misses = computation_->GetCacheMisses();
+  if (misses == 0) return;
+  int budget =
+      std::min(params_.GetMaxPrefetchBatch(), params_.GetMiniBatchSize()) -
+      misses;
+  if (budget <= 0) return;
+  // Once there are enough of them to tell, prefetch less when few of the
+  // earlier prefetched evaluations got used. One slot keeps measuring.
+  const uint64_t evals =
+      search_->prefetch_evals_.load(std::memory_order_relaxed);
+  if (evals >= static_cast<uint64_t>(4 * params_.GetMiniBatchSize())) {
+    const float used_rate =
+        search_->prefetch_used_.load(std::memory_order_relaxed) /
+        static_cast<float>(evals);
+    budget = std::max(
+        1, static_cast<int>(budget * std::min(1.0f, 2.0f * used_rate)));
+  }
+  SharedMutex::SharedLock lock(search_->nodes_mutex_);
+  const int prefetched = PrefetchAlongPv(budget);
+  search_->prefetch_evals_.fetch_add(prefetched, std::memory_order_relaxed);
 }
 
-// Prefetches up to @budget nodes into cache. Returns number of nodes
-// prefetched.
-int SearchWorker::PrefetchIntoCache(Node* node, int budget, bool is_odd_depth) {
-  const float draw_score = search_->GetDrawScore(is_odd_depth);
-  if (budget <= 0) return 0;
-
-  // We are in a leaf, which is not yet being processed.
-  if (!node || node->GetNStarted() == 0) {
-    if (AddNodeToComputation(node)) {
-      // Make it return 0 to make it not use the slot, so that the function
-      // tries hard to find something to cache even among unpopular moves.
-      // In practice that slows things down a lot though, as it's not always
-      // easy to find what to cache.
-      return 1;
+int SearchWorker::PrefetchAlongPv(int budget) {
+  struct Candidate {
+    float score;
+    int depth;
+    Move move;
+  };
+  std::vector<Candidate> candidates;
+  std::vector<Move> pv;
+  // Follow the most visited children, collecting the unexpanded ones.
+  for (Node* node = search_->root_node_;
+       node && node->GetN() > 0 && !node->IsTerminal();) {
+    const float parent_sqrt_n = std::sqrt(static_cast<float>(node->GetN()));
+    EdgeAndNode best;
+    for (auto& edge : node->Edges()) {
+      if (node == search_->root_node_ &&
+          !search_->root_move_filter_.empty() &&
+          std::find(search_->root_move_filter_.begin(),
+                    search_->root_move_filter_.end(),
+                    edge.GetMove()) == search_->root_move_filter_.end()) {
+        continue;
+      }
+      if (edge.GetNStarted() == 0) {
+        // The U term of PUCT without cpuct: of equal priors, children of the
+        // busier node get visited sooner.
+        if (edge.GetP() > 0.0f) {
+          candidates.push_back({edge.GetP() * parent_sqrt_n,
+                                static_cast<int>(pv.size()), edge.GetMove()});
+        }
+      } else if (!best || edge.GetN() > best.GetN()) {
+        best = edge;
+      }
     }
-    return 1;
+    if (!best || best.GetN() == 0) break;
+    pv.push_back(best.GetMove());
+    node = best.node();
   }
 
-  assert(node);
-  // n = 0 and n_in_flight_ > 0, that means the node is being extended.
-  if (node->GetN() == 0) return 0;
-  // The node is terminal; don't prefetch it.
-  if (node->IsTerminal()) return 0;
-
-  // Populate all subnodes and their scores.
-  typedef std::pair<float, EdgeAndNode> ScoredEdge;
-  std::vector<ScoredEdge> scores;
-  const float cpuct =
-      ComputeCpuct(params_, node->GetN(), node == search_->root_node_);
-  const float puct_mult =
-      cpuct * std::sqrt(std::max(node->GetChildrenVisits(), 1u));
-  const float fpu =
-      GetFpu(params_, node, node == search_->root_node_, draw_score);
-  for (auto& edge : node->Edges()) {
-    if (edge.GetP() == 0.0f) continue;
-    // Flip the sign of a score to be able to easily sort.
-    // TODO: should this use logit_q if set??
-    scores.emplace_back(-edge.GetU(puct_mult) - edge.GetQ(fpu, draw_score),
-                        edge);
-  }
-
-  size_t first_unsorted_index = 0;
-  int total_budget_spent = 0;
-  int budget_to_spend = budget;  // Initialize for the case where there's only
-                                 // one child.
-  for (size_t i = 0; i < scores.size(); ++i) {
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate& a, const Candidate& b) {
+              return a.score > b.score;
+            });
+  // Candidates prefetched by earlier batches are in the cache already, they
+  // are skipped rather than taking up the budget.
+  const int misses = computation_->GetCacheMisses();
+  for (const auto& candidate : candidates) {
+    if (computation_->GetCacheMisses() - misses >= budget) break;
     if (search_->stop_.load(std::memory_order_acquire)) break;
-    if (budget <= 0) break;
-
-    // Sort next chunk of a vector. 3 at a time. Most of the time it's fine.
-    if (first_unsorted_index != scores.size() &&
-        i + 2 >= first_unsorted_index) {
-      const int new_unsorted_index =
-          std::min(scores.size(), budget < 2 ? first_unsorted_index + 2
-                                             : first_unsorted_index + 3);
-      std::partial_sort(scores.begin() + first_unsorted_index,
-                        scores.begin() + new_unsorted_index, scores.end(),
-                        [](const ScoredEdge& a, const ScoredEdge& b) {
-                          return a.first < b.first;
-                        });
-      first_unsorted_index = new_unsorted_index;
-    }
-
-    auto edge = scores[i].second;
-    // Last node gets the same budget as prev-to-last node.
-    if (i != scores.size() - 1) {
-      // Sign of the score was flipped for sorting, so flip it back.
-      const float next_score = -scores[i + 1].first;
-      // TODO: As above - should this use logit_q if set?
-      const float q = edge.GetQ(-fpu, draw_score);
-      if (next_score > q) {
-        budget_to_spend =
-            std::min(budget, int(edge.GetP() * puct_mult / (next_score - q) -
-                                 edge.GetNStarted()) +
-                                 1);
-      } else {
-        budget_to_spend = budget;
-      }
-    }
-    history_.Append(edge.GetMove());
-    const int budget_spent =
-        PrefetchIntoCache(edge.node(), budget_to_spend, !is_odd_depth);
-    history_.Pop();
-    budget -= budget_spent;
-    total_budget_spent += budget_spent;
+    history_.Trim(search_->played_history_.GetLength());
+    for (int j = 0; j < candidate.depth; j++) history_.Append(pv[j]);
+    history_.Append(candidate.move);
+    AddNodeToComputation(nullptr);
   }
-  return total_budget_spent;
+  return computation_->GetCacheMisses() - misses;
 }
 
 // 4. Run NN computation.
 // ~~~~~~~~~~~~~~~~~~~~~~
-void SearchWorker::RunNNComputation() { computation_->ComputeBlocking(); }
+void SearchWorker::RunNNComputation() { computation_->ComputeAsync(); }
+
+void SearchWorker::WaitForNNComputation() { computation_->Wait(); }
 
 // 5. Retrieve NN computations (and terminal values) into nodes.
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -2215,6 +2568,22 @@ void SearchWorker::FetchSingleNodeResult(NodeToProcess* node_to_process,
   node_to_process->v = v;
   node_to_process->d = d;
   node_to_process->m = computation.GetMVal(idx_in_computation);
+  // A position already searched by another move order starts from the
+  // subtree average instead of its own NN value.
+  if (search_->transpositions_ && node_to_process->tt_key_count > 0) {
+    TranspositionTable::Stats stats;
+    search_->tt_probes_.fetch_add(1, std::memory_order_relaxed);
+    if (search_->transpositions_->Probe(
+            (*node_to_process->tt_keys)[node_to_process->tt_key_start +
+                                        node_to_process->tt_key_count - 1],
+            &stats)) {
+      search_->tt_hits_.fetch_add(1, std::memory_order_relaxed);
+      search_->tt_borrowed_.fetch_add(stats.n, std::memory_order_relaxed);
+      node_to_process->v = stats.wl;
+      node_to_process->d = stats.d;
+      node_to_process->m = stats.m;
+    }
+  }
   // ...and secondly, the policy data.
   // Calculate maximum first.
   float max_p = -std::numeric_limits<float>::infinity();
@@ -2270,6 +2639,15 @@ void SearchWorker::DoBackupUpdate() {
   search_->total_batches_ += 1;
 }
 
+void SearchWorker::MaybeStoreTransposition(const NodeToProcess& node_to_process,
+                                           int tt_idx, const Node* node) {
+  // The keys cover the last tt_key_count nodes of the path, leaf last.
+  if (tt_idx < 0 || node->GetN() < 2 || node->IsTerminal()) return;
+  search_->transpositions_->Store(
+      (*node_to_process.tt_keys)[node_to_process.tt_key_start + tt_idx],
+      {node->GetWL(), node->GetD(), node->GetM(), node->GetN()});
+}
+
 void SearchWorker::DoBackupUpdateSingleNode(
     const NodeToProcess& node_to_process) REQUIRES(search_->nodes_mutex_) {
   Node* node = node_to_process.node;
@@ -2292,7 +2670,9 @@ void SearchWorker::DoBackupUpdateSingleNode(
   float m_delta = 0.0f;
   uint32_t solid_threshold =
       static_cast<uint32_t>(params_.GetSolidTreeThreshold());
-  for (Node *n = node, *p; n != search_->root_node_->GetParent(); n = p) {
+  int tt_idx = static_cast<int>(node_to_process.tt_key_count) - 1;
+  for (Node *n = node, *p; n != search_->root_node_->GetParent();
+       n = p, --tt_idx) {
     p = n->GetParent();
 
     // Current node might have become terminal from some other descendant, so
@@ -2306,13 +2686,9 @@ void SearchWorker::DoBackupUpdateSingleNode(
     if (n_to_fix > 0 && !n->IsTerminal()) {
       n->AdjustForTerminal(v_delta, d_delta, m_delta, n_to_fix);
     }
-    if (n->GetN() >= solid_threshold) {
-      if (n->MakeSolid() && n == search_->root_node_) {
-        // If we make the root solid, the current_best_edge_ becomes invalid and
-        // we should repopulate it.
-        search_->current_best_edge_ =
-            search_->GetBestChildNoTemperature(search_->root_node_, 0);
-      }
+    MaybeStoreTransposition(node_to_process, tt_idx, n);
+    if (!params_.GetBackgroundSolidify() && n->GetN() >= solid_threshold) {
+      if (n->MakeSolid()) search_->OnSolidified(n);
     }
 
     // Nothing left to do without ancestors to update.
@@ -2431,16 +2807,16 @@ void SearchWorker::UpdateCounters() {
   // If this thread had no work, not even out of order, then sleep for some
   // milliseconds. Collisions don't count as work, so have to enumerate to find
   // out if there was anything done.
-  bool work_done = number_out_of_order_ > 0;
-  if (!work_done) {
+  work_done_ = number_out_of_order_ > 0;
+  if (!work_done_) {
     for (NodeToProcess& node_to_process : minibatch_) {
       if (!node_to_process.IsCollision()) {
-        work_done = true;
+        work_done_ = true;
         break;
       }
     }
   }
-  if (!work_done) {
+  if (!work_done_ && sleep_when_idle_) {
     std::this_thread::sleep_for(std::chrono::milliseconds(10));
   }
 }
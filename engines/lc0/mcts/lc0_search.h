@@ -38,6 +38,7 @@
 #include "chess/lc0_uciloop.h"
 #include "mcts/lc0_node.h"
 #include "mcts/lc0_params.h"
+#include "mcts/lc0_transpositions.h"
 #include "mcts/stoppers/lc0_timemgr.h"
 #include "neural/lc0_cache.h"
 #include "neural/lc0_network.h"
@@ -55,11 +56,13 @@ class Search {
          std::chrono::steady_clock::time_point start_time,
          std::unique_ptr<SearchStopper> stopper, bool infinite, bool ponder,
          const OptionsDict& options, NNCache* cache,
-         SyzygyTablebase* syzygy_tb);
+         SyzygyTablebase* syzygy_tb,
+         TranspositionTable* transpositions = nullptr);
 
   ~Search();
 
-  // Starts worker threads and returns immediately.
+  // Starts worker threads and returns immediately. Each thread runs
+  // SearchCoroutines workers.
   void StartThreads(size_t how_many);
 
   // Starts search with k threads and wait until it finishes.
@@ -88,6 +91,17 @@ class Search {
   Eval GetBestEval(Move* move = nullptr, bool* is_terminal = nullptr) const;
   // Returns the total number of playouts in the search.
   std::int64_t GetTotalPlayouts() const;
+  // Returns the playouts until bestmove, and those of the background search
+  // after it.
+  std::int64_t GetForegroundPlayouts() const;
+  std::int64_t GetBackgroundPlayouts() const;
+  // Returns the transposition table probes and hits of the search, and the
+  // visits the hits brought along.
+  void GetTranspositionStats(uint64_t* probes, uint64_t* hits,
+                             uint64_t* borrowed) const;
+  // Returns the number of prefetched NN evaluations and how many of them the
+  // search used.
+  void GetPrefetchStats(uint64_t* evals, uint64_t* used) const;
   // Returns the search parameters.
   const SearchParams& GetParams() const { return params_; }
 
@@ -113,6 +127,9 @@ class Search {
   int64_t GetTimeSinceStart() const;
   int64_t GetTimeSinceFirstBatch() const;
   void MaybeTriggerStop(const IterationStats& stats, StoppersHints* hints);
+  // Returns whether the threads may go on with a background search once
+  // bestmove is sent.
+  bool BackgroundSearchWanted(int64_t total_nodes) const;
   void MaybeOutputInfo();
   void SendUciInfo();  // Requires nodes_mutex_ to be held.
   // Sets stop to true and notifies watchdog thread.
@@ -122,6 +139,17 @@ class Search {
   // Function which runs in a separate thread and watches for time and
   // uci `stop` command;
   void WatchdogThread();
+  // Runs @count workers on the calling thread while needed, each suspending
+  // when its batch goes to the backend so that the thread gathers the batches
+  // of the others until the results are there.
+  void RunWorkerCoroutines(size_t thread_id, int count);
+  // Makes solid the nodes past SolidTreeThreshold, from the root down. Run by
+  // the watchdog thread when BackgroundSolidify is set.
+  void SolidifyTree();
+  // Finds again the pointers to nodes below @node after it got solid.
+  void OnSolidified(Node* node) REQUIRES(nodes_mutex_);
+  // The node at the end of background_moves_.
+  Node* FindBackgroundNode() const REQUIRES(nodes_mutex_);
 
   // Fills IterationStats with global (rather than per-thread) portion of search
   // statistics. Currently all stats there (in IterationStats) are global
@@ -143,6 +171,14 @@ class Search {
   mutable Mutex counters_mutex_ ACQUIRED_AFTER(nodes_mutex_);
   // Tells all threads to stop.
   std::atomic<bool> stop_{false};
+  // Set when the threads go on with a background search after bestmove, until
+  // its visits budget is reached or the search is stopped or aborted.
+  std::atomic<bool> background_{false};
+  // The node which the background search extends, after the move played and,
+  // when the tree has it, the expected reply; and the moves from the root to
+  // it. Set once bestmove is sent.
+  std::atomic<Node*> background_node_{nullptr};
+  std::vector<Move> background_moves_;
   // Condition variable used to watch stop_ variable.
   std::condition_variable watchdog_cv_;
   // Tells whether it's ok to respond bestmove when limits are reached.
@@ -164,6 +200,13 @@ class Search {
   Node* root_node_;
   NNCache* cache_;
   SyzygyTablebase* syzygy_tb_;
+  // Null unless transpositions are enabled.
+  TranspositionTable* transpositions_;
+  std::atomic<uint64_t> tt_probes_{0};
+  std::atomic<uint64_t> tt_hits_{0};
+  std::atomic<uint64_t> tt_borrowed_{0};
+  std::atomic<uint64_t> prefetch_evals_{0};
+  std::atomic<uint64_t> prefetch_used_{0};
   // Fixed positions which happened before the search.
   const PositionHistory& played_history_;
 
@@ -183,6 +226,8 @@ class Search {
   Edge* last_outputted_info_edge_ GUARDED_BY(nodes_mutex_) = nullptr;
   ThinkingInfo last_outputted_uci_info_ GUARDED_BY(nodes_mutex_);
   int64_t total_playouts_ GUARDED_BY(nodes_mutex_) = 0;
+  // Playouts when the background search started, -1 before.
+  int64_t background_start_playouts_ GUARDED_BY(nodes_mutex_) = -1;
   int64_t total_batches_ GUARDED_BY(nodes_mutex_) = 0;
   // Maximum search depth = length of longest path taken in PickNodetoExtend.
   uint16_t max_depth_ GUARDED_BY(nodes_mutex_) = 0;
@@ -195,6 +240,8 @@ class Search {
   std::atomic<int> pending_searchers_{0};
   std::atomic<int> backend_waiting_counter_{0};
   std::atomic<int> thread_count_{0};
+  // Worker threads which did not exit yet.
+  std::atomic<int> running_workers_{0};
 
   std::vector<std::pair<Node*, int>> shared_collisions_
       GUARDED_BY(nodes_mutex_);
@@ -216,6 +263,7 @@ class SearchWorker {
         moves_left_support_(search_->network_->GetCapabilities().moves_left !=
                             pblczero::NetworkFormat::MOVES_LEFT_NONE) {
     search_->network_->InitThread(id);
+    picking_tasks_.resize(kMaxPickTasks);
     for (int i = 0; i < params.GetTaskWorkersPerSearchWorker(); i++) {
       task_workspaces_.emplace_back();
       task_threads_.emplace_back([this, i]() {
@@ -252,7 +300,8 @@ class SearchWorker {
     }
   }
 
-  // Does one full iteration of MCTS search:
+  // Does one full iteration of MCTS search, StartIteration() and
+  // FinishIteration():
   // 1. Initialize internal structures.
   // 2. Gather minibatch.
   // 3. Prefetch into cache.
@@ -262,6 +311,19 @@ class SearchWorker {
   // 7. Update the Search's status and progress information.
   void ExecuteOneIteration();
 
+  // Steps 1 to 4 with the NN computation started but not waited for. Returns
+  // false if the search stopped before anything was gathered.
+  bool StartIteration();
+  // True once the results of the NN computation started are there.
+  bool IsNNComputationReady() const { return computation_->IsReady(); }
+  // Steps 5 to 7, waiting for the NN computation first.
+  void FinishIteration();
+  // Whether the last iteration had anything but collisions.
+  bool HadWork() const { return work_done_; }
+  // A worker without work sleeps a little, unless it is a coroutine, which
+  // must not stop the others on its thread.
+  void SetSleepWhenIdle(bool sleep) { sleep_when_idle_ = sleep; }
+
   // The same operations one by one:
   // 1. Initialize internal structures.
   // @computation is the computation to use on this iteration.
@@ -276,8 +338,10 @@ class SearchWorker {
   // 3. Prefetch into cache.
   void MaybePrefetchIntoCache();
 
-  // 4. Run NN computation.
+  // 4. Run NN computation. Backends computing on threads of their own return
+  // before it is done, WaitForNNComputation() waits for the results.
   void RunNNComputation();
+  void WaitForNNComputation();
 
   // 5. Retrieve NN computations (and terminal values) into nodes.
   void FetchMinibatchResults();
@@ -322,9 +386,18 @@ class SearchWorker {
 
     // Details that are filled in as we go.
     uint64_t hash;
+    // Transposition keys of the positions from the root to the node, only
+    // with transpositions enabled: tt_key_count keys from tt_key_start in the
+    // tt_keys of the workspace which extended the node.
+    const std::vector<uint64_t>* tt_keys = nullptr;
+    uint32_t tt_key_start = 0;
+    uint32_t tt_key_count = 0;
     NNCacheLock lock;
     std::vector<uint16_t> probabilities_to_cache;
-    InputPlanes input_planes;
+    // Encoded input of a cache miss, entry input_planes_idx of the
+    // input_planes of the workspace which extended the node.
+    std::vector<InputPlanes>* input_planes = nullptr;
+    uint32_t input_planes_idx = 0;
     mutable int last_idx = 0;
     bool ooo_completed = false;
 
@@ -383,6 +456,11 @@ class SearchWorker {
     std::vector<int> current_path;
     std::vector<Move> moves_to_path;
     PositionHistory history;
+    // Transposition keys of the nodes extended with this workspace in the
+    // current iteration, one after the other.
+    std::vector<uint64_t> tt_keys;
+    // Inputs encoded with this workspace in the current iteration.
+    std::vector<InputPlanes> input_planes;
     TaskWorkspace() {
       vtp_buffer.reserve(30);
       visits_to_perform.reserve(30);
@@ -393,6 +471,8 @@ class SearchWorker {
     }
   };
 
+  static constexpr int kMaxPickTasks = 100;
+
   struct PickTask {
     enum PickTaskType { kGathering, kProcessing };
     PickTaskType task_type;
@@ -410,6 +490,7 @@ class SearchWorker {
 
     bool complete = false;
 
+    PickTask() : task_type(kGathering) {}
     PickTask(Node* node, uint16_t depth, const std::vector<Move>& base_moves,
              int collision_limit)
         : task_type(kGathering),
@@ -423,8 +504,15 @@ class SearchWorker {
 
   NodeToProcess PickNodeToExtend(int collision_limit);
   bool AddNodeToComputation(Node* node);
-  int PrefetchIntoCache(Node* node, int budget, bool is_odd_depth);
+  // Adds up to @budget unexpanded children along the PV which are not in the
+  // cache yet to the computation, highest prior first. Returns the number of
+  // NN evaluations added.
+  int PrefetchAlongPv(int budget);
   void DoBackupUpdateSingleNode(const NodeToProcess& node_to_process);
+  // Stores the stats of @node, whose key is the @tt_idx-th of
+  // @node_to_process, in the transposition table.
+  void MaybeStoreTransposition(const NodeToProcess& node_to_process, int tt_idx,
+                               const Node* node);
   // Returns whether a node's bounds were set based on its children.
   bool MaybeSetBounds(Node* p, float m, int* n_to_fix, float* v_delta,
                       float* d_delta, float* m_delta) const;
@@ -445,13 +533,22 @@ class SearchWorker {
                              int idx_in_computation);
   void RunTasks(int tid);
   void ResetTasks();
-  // Returns how many tasks there were.
+  // Publishes a task without locking, returns false if all slots are taken.
+  bool PushTask(PickTask&& task);
+  // Claims the next published task, if any, and returns its slot or -1.
+  int TakeTask();
+  void RunTask(int id, TaskWorkspace* workspace);
+  // Returns how many tasks there were. The caller steals pending tasks
+  // rather than spinning idle.
   int WaitForTasks();
 
   Search* const search_;
   // List of nodes to process.
   std::vector<NodeToProcess> minibatch_;
   std::unique_ptr<CachingComputation> computation_;
+  std::chrono::steady_clock::time_point iteration_start_;
+  bool work_done_ = true;
+  bool sleep_when_idle_ = true;
   // History is reset and extended by PickNodeToExtend().
   PositionHistory history_;
   int number_out_of_order_ = 0;
@@ -464,9 +561,11 @@ class SearchWorker {
   // Multigather task related fields.
 
   Mutex picking_tasks_mutex_;
+  // Fixed slots, so tasks can be added and taken without the mutex.
   std::vector<PickTask> picking_tasks_;
+  // Published tasks, always a prefix of the reserved slots.
   std::atomic<int> task_count_ = -1;
-  std::atomic<int> task_taking_started_ = 0;
+  std::atomic<int> tasks_reserved_ = 0;
   std::atomic<int> tasks_taken_ = 0;
   std::atomic<int> completed_tasks_ = 0;
   std::condition_variable task_added_;
@@ -0,0 +1,114 @@
+/*
+  This file is part of Leela Chess Zero.
+  Copyright (C) 2018-2019 The LCZero Authors
+
+  Leela Chess is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Leela Chess is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Leela Chess.  If not, see <http://www.gnu.org/licenses/>.
+
+  Additional permission under GNU GPL version 3 section 7
+
+  If you modify this Program, or any covered work, by linking or
+  combining it with NVIDIA Corporation's libraries from the NVIDIA CUDA
+  Toolkit and the NVIDIA CUDA Deep Neural Network library (or a
+  modified version of those libraries), containing parts covered by the
+  terms of the respective license agreement, the licensors of this
+  Program grant you additional permission to convey the resulting work.
+*/
+
+#include "mcts/lc0_transpositions.h"
+
+#include <cstring>
+
+#include "utils/lc0_hashcat.h"
+
+namespace lczero {
+
+namespace {
+uint32_t FloatBits(float x) {
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+float BitsFloat(uint32_t bits) {
+  float x;
+  std::memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+}  // namespace
+
+uint64_t TranspositionTable::Key(const Position& position) {
+  // Early in the 50 move count nearby counts are the same position for the
+  // search, close to 100 plies every ply matters.
+  const int rule50 = position.GetRule50Ply();
+  return HashCat(position.Hash(), rule50 < 80 ? rule50 / 8 : rule50);
+}
+
+void TranspositionTable::SetSizeMB(size_t size_mb) {
+  if (size_mb == size_mb_) return;
+  size_mb_ = size_mb;
+  entries_.reset();
+  mask_ = 0;
+  if (size_mb == 0) return;
+  // The largest power of two number of entries which fits.
+  const size_t max_entries = (size_mb << 20) / sizeof(Entry);
+  size_t entries = 1;
+  while (entries * 2 <= max_entries) entries *= 2;
+  entries_ = std::make_unique<Entry[]>(entries);
+  mask_ = entries - 1;
+}
+
+void TranspositionTable::Clear() {
+  for (size_t i = 0; entries_ && i <= mask_; i++) {
+    entries_[i].check.store(0, std::memory_order_relaxed);
+    entries_[i].values.store(0, std::memory_order_relaxed);
+    entries_[i].visits.store(0, std::memory_order_relaxed);
+  }
+}
+
+void TranspositionTable::Store(uint64_t key, const Stats& stats) {
+  if (!entries_) return;
+  Entry& entry = entries_[key & mask_];
+  const uint64_t old_values = entry.values.load(std::memory_order_relaxed);
+  const uint64_t old_visits = entry.visits.load(std::memory_order_relaxed);
+  const uint64_t old_check = entry.check.load(std::memory_order_relaxed);
+  const uint32_t old_n = static_cast<uint32_t>(old_visits);
+  if ((old_check ^ old_values ^ old_visits) == key) {
+    if (stats.n < old_n) return;
+  } else if (stats.n < old_n / 4) {
+    return;
+  }
+  const uint64_t values =
+      static_cast<uint64_t>(FloatBits(stats.wl)) << 32 | FloatBits(stats.d);
+  const uint64_t visits =
+      static_cast<uint64_t>(FloatBits(stats.m)) << 32 | stats.n;
+  entry.values.store(values, std::memory_order_relaxed);
+  entry.visits.store(visits, std::memory_order_relaxed);
+  entry.check.store(key ^ values ^ visits, std::memory_order_relaxed);
+}
+
+bool TranspositionTable::Probe(uint64_t key, Stats* stats) const {
+  if (!entries_) return false;
+  const Entry& entry = entries_[key & mask_];
+  const uint64_t values = entry.values.load(std::memory_order_relaxed);
+  const uint64_t visits = entry.visits.load(std::memory_order_relaxed);
+  const uint64_t check = entry.check.load(std::memory_order_relaxed);
+  if ((check ^ values ^ visits) != key) return false;
+  stats->wl = BitsFloat(static_cast<uint32_t>(values >> 32));
+  stats->d = BitsFloat(static_cast<uint32_t>(values));
+  stats->m = BitsFloat(static_cast<uint32_t>(visits >> 32));
+  stats->n = static_cast<uint32_t>(visits);
+  return stats->n > 0;
+}
+
+}  // namespace lczero
@@ -0,0 +1,82 @@
+/*
+  This file is part of Leela Chess Zero.
+  Copyright (C) 2018-2019 The LCZero Authors
+
+  Leela Chess is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Leela Chess is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Leela Chess.  If not, see <http://www.gnu.org/licenses/>.
+
+  Additional permission under GNU GPL version 3 section 7
+
+  If you modify this Program, or any covered work, by linking or
+  combining it with NVIDIA Corporation's libraries from the NVIDIA CUDA
+  Toolkit and the NVIDIA CUDA Deep Neural Network library (or a
+  modified version of those libraries), containing parts covered by the
+  terms of the respective license agreement, the licensors of this
+  Program grant you additional permission to convey the resulting work.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "chess/lc0_position.h"
+
+namespace lczero {
+
+// Subtree statistics (averaged WL, D, M and visits) of positions met in the
+// search, so that a node reached by another move order can start from what
+// the search already knows about its position instead of a single NN eval.
+// The tree itself stays a tree: nodes are not shared, only their statistics.
+//
+// Fixed size, no locks. Entries are written and read as three independent
+// atomics and checked against the key, so a torn entry reads as a miss.
+// Must not be resized or cleared while a search is running.
+class TranspositionTable {
+ public:
+  struct Stats {
+    float wl;
+    float d;
+    float m;
+    uint32_t n;
+  };
+
+  // Key of a position: the board with its repetition count and the rule50
+  // counter, bucketed while it is far from deciding the game.
+  static uint64_t Key(const Position& position);
+
+  // Reallocates the table if the size changed; 0 frees it.
+  void SetSizeMB(size_t size_mb);
+  size_t GetSizeMB() const { return size_mb_; }
+  void Clear();
+
+  // Stores @stats under @key. An entry of the same key is replaced by one
+  // with at least as many visits, another key by one not much smaller.
+  void Store(uint64_t key, const Stats& stats);
+  // Returns whether the table has an entry for @key, filling @stats.
+  bool Probe(uint64_t key, Stats* stats) const;
+
+ private:
+  struct Entry {
+    std::atomic<uint64_t> check{0};  // key ^ values ^ visits
+    std::atomic<uint64_t> values{0};
+    std::atomic<uint64_t> visits{0};
+  };
+
+  std::unique_ptr<Entry[]> entries_;
+  size_t mask_ = 0;
+  size_t size_mb_ = 0;
+};
+
+}  // namespace lczero
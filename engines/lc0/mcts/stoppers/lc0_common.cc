@@ -35,6 +35,13 @@ const OptionId kNNCacheSizeId{
     "nncache", "NNCacheSize",
     "Number of positions to store in a memory cache. A large cache can speed "
     "up searching, but takes memory."};
+const OptionId kMaxTreeMemoryMbId{
+    "max-tree-memory-mb", "MaxTreeMemoryMB",
+    "Maximum memory of the search tree, in megabytes, counted exactly from "
+    "the nodes and edges allocated, including the kept subtrees of earlier "
+    "positions. The search stops when it is reached, and before a search the "
+    "least visited subtrees are pruned when the tree is close to it. When set "
+    "to 0, the tree memory is not limited."};
 
 namespace {
 
@@ -83,6 +90,7 @@ void PopulateCommonStopperOptions(RunType for_what, OptionsParser* options) {
 
   if (for_what == RunType::kUci) {
     options->Add<IntOption>(kRamLimitMbId, 0, 100000000) = 0;
+    options->Add<IntOption>(kMaxTreeMemoryMbId, 0, 100000000) = 0;
     options->HideOption(kMinimumKLDGainPerNodeId);
     options->HideOption(kKLDGainAverageIntervalId);
     options->HideOption(kNodesAsPlayoutsId);
@@ -123,6 +131,13 @@ void PopulateCommonUciStoppers(ChainedSearchStopper* stopper,
         options.Get<float>(kSmartPruningFactorId) > 0.0f));
   }
 
+  // Tree memory stopper.
+  const int max_tree_memory = options.Get<int>(kMaxTreeMemoryMbId);
+  if (max_tree_memory) {
+    stopper->AddStopper(std::make_unique<TreeMemoryStopper>(
+        max_tree_memory, options.Get<float>(kSmartPruningFactorId) > 0.0f));
+  }
+
   // "go nodes" stopper.
   int64_t node_limit = 0;
   if (params.nodes) {
@@ -39,6 +39,9 @@ void PopulateCommonStopperOptions(RunType for_what, OptionsParser* options);
 // Option ID for a cache size. It's used from multiple places and there's no
 // really nice place to declare, so let it be here.
 extern const OptionId kNNCacheSizeId;
+// Option ID for the tree memory limit, also used to prune the tree between
+// searches.
+extern const OptionId kMaxTreeMemoryMbId;
 
 // Populates KLDGain and SmartPruning stoppers.
 void PopulateIntrinsicStoppers(ChainedSearchStopper* stopper,
@@ -112,6 +112,34 @@ MemoryWatchingStopper::MemoryWatchingStopper(int cache_size, int ram_limit_mb,
           << " nodes.";
 }
 
+///////////////////////////
+// TreeMemoryStopper
+///////////////////////////
+
+TreeMemoryStopper::TreeMemoryStopper(int max_tree_memory_mb,
+                                     bool populate_remaining_playouts)
+    : limit_bytes_(max_tree_memory_mb * 1048576LL),
+      populate_remaining_playouts_(populate_remaining_playouts) {}
+
+bool TreeMemoryStopper::ShouldStop(const IterationStats& stats,
+                                   StoppersHints* hints) {
+  const int64_t bytes = Node::GetAllocatedBytes();
+  if (initial_bytes_ < 0) initial_bytes_ = bytes;
+  if (populate_remaining_playouts_ && stats.nodes_since_movestart > 0 &&
+      bytes > initial_bytes_) {
+    const double bytes_per_visit = static_cast<double>(bytes - initial_bytes_) /
+                                   stats.nodes_since_movestart;
+    hints->UpdateEstimatedRemainingPlayouts(
+        static_cast<int64_t>((limit_bytes_ - bytes) / bytes_per_visit));
+  }
+  if (bytes >= limit_bytes_) {
+    LOGFILE << "Stopped search: Reached tree memory limit: " << bytes
+            << ">=" << limit_bytes_;
+    return true;
+  }
+  return false;
+}
+
 ///////////////////////////
 // TimelimitStopper
 ///////////////////////////
@@ -88,6 +88,19 @@ class MemoryWatchingStopper : public VisitsStopper {
                         bool populate_remaining_playouts);
 };
 
+// Stops when the Node and Edge objects alive take the given memory, counted
+// exactly, and predicts remaining visits from the bytes per visit so far.
+class TreeMemoryStopper : public SearchStopper {
+ public:
+  TreeMemoryStopper(int max_tree_memory_mb, bool populate_remaining_playouts);
+  bool ShouldStop(const IterationStats&, StoppersHints*) override;
+
+ private:
+  const int64_t limit_bytes_;
+  const bool populate_remaining_playouts_;
+  int64_t initial_bytes_ = -1;
+};
+
 // Stops after time budget is gone.
 class TimeLimitStopper : public SearchStopper {
  public:
@@ -63,6 +63,10 @@ class BlasComputation : public NetworkComputation {
   // Adds a sample to the batch.
   void AddInput(InputPlanes&& input) override { planes_.emplace_back(input); }
 
+  void AddInputs(const InputPlanes* inputs, int count) override {
+    planes_.insert(planes_.end(), inputs, inputs + count);
+  }
+
   // Do the computation.
   void ComputeBlocking() override;
 
@@ -62,12 +62,13 @@ void CachingComputation::PopCacheHit() {
 
 void CachingComputation::AddInput(
     uint64_t hash, InputPlanes&& input,
-    std::vector<uint16_t>&& probabilities_to_cache) {
+    std::vector<uint16_t>&& probabilities_to_cache, bool prefetch) {
   if (AddInputByHash(hash)) return;
   batch_.emplace_back();
   batch_.back().hash = hash;
   batch_.back().idx_in_parent = parent_->GetBatchSize();
   batch_.back().probabilities_to_cache = probabilities_to_cache;
+  batch_.back().prefetch = prefetch;
   parent_->AddInput(std::move(input));
 }
 
@@ -78,8 +79,22 @@ void CachingComputation::PopLastInputHit() {
 }
 
 void CachingComputation::ComputeBlocking() {
+  ComputeAsync();
+  Wait();
+}
+
+void CachingComputation::ComputeAsync() {
+  if (parent_->GetBatchSize() == 0) return;
+  parent_->ComputeAsync();
+}
+
+bool CachingComputation::IsReady() const {
+  return parent_->GetBatchSize() == 0 || parent_->IsReady();
+}
+
+void CachingComputation::Wait() {
   if (parent_->GetBatchSize() == 0) return;
-  parent_->ComputeBlocking();
+  parent_->Wait();
 
   // Fill cache with data from NN.
   for (const auto& item : batch_) {
@@ -89,6 +104,7 @@ void CachingComputation::ComputeBlocking() {
     req->q = parent_->GetQVal(item.idx_in_parent);
     req->d = parent_->GetDVal(item.idx_in_parent);
     req->m = parent_->GetMVal(item.idx_in_parent);
+    req->prefetched.store(item.prefetch, std::memory_order_relaxed);
     int idx = 0;
     for (auto x : item.probabilities_to_cache) {
       req->p[idx++] =
@@ -26,6 +26,8 @@
 */
 #pragma once
 
+#include <atomic>
+
 #include "neural/lc0_network.h"
 #include "utils/lc0_cache.h"
 #include "utils/lc0_smallarray.h"
@@ -40,6 +42,8 @@ struct CachedNNRequest {
   float m;
   // TODO(mooskagh) Don't really need index if using perfect hash.
   SmallArray<IdxAndProb> p;
+  // Set for prefetched positions until the search first uses the result.
+  std::atomic<bool> prefetched{false};
 };
 
 typedef HashKeyedCache<CachedNNRequest> NNCache;
@@ -67,13 +71,20 @@ class CachingComputation {
   // Adds a sample to the batch.
   // @hash is a hash to store/lookup it in the cache.
   // @probabilities_to_cache is which indices of policy head to store.
+  // @prefetch marks the result in the cache as prefetched.
   void AddInput(uint64_t hash, InputPlanes&& input,
-                std::vector<uint16_t>&& probabilities_to_cache);
+                std::vector<uint16_t>&& probabilities_to_cache,
+                bool prefetch = false);
   // Undos last AddInput. If it was a cache miss, the it's actually not removed
   // from parent's batch.
   void PopLastInputHit();
   // Do the computation.
   void ComputeBlocking();
+  // The same in two steps, see NetworkComputation::ComputeAsync(). The cache
+  // is filled by Wait().
+  void ComputeAsync();
+  bool IsReady() const;
+  void Wait();
   // Returns Q value of @sample.
   float GetQVal(int sample) const;
   // Returns probability of draw if NN has WDL value head.
@@ -96,6 +107,7 @@ class CachingComputation {
     int idx_in_parent = -1;
     std::vector<uint16_t> probabilities_to_cache;
     mutable int last_idx = 0;
+    bool prefetch = false;
   };
 
   std::unique_ptr<NetworkComputation> parent_;
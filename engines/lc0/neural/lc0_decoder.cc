@@ -56,7 +56,7 @@ BoardSquare OldPosition(const InputPlane& prev, BitBoard mask_diff) {
 }  // namespace
 
 void PopulateBoard(pblczero::NetworkFormat::InputFormat input_format,
-                   InputPlanes planes, ChessBoard* board, int* rule50,
+                   const InputPlanes& planes, ChessBoard* board, int* rule50,
                    int* gameply) {
   auto pawnsOurs = BitBoard(planes[0].mask);
   auto knightsOurs = BitBoard(planes[1].mask);
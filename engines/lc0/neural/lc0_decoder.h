@@ -45,7 +45,7 @@ Move DecodeMoveFromInput(const InputPlanes& planes, const InputPlanes& prev);
 //
 // NOTE: Assumes InputPlanes are not transformed, regardless of input_format.
 void PopulateBoard(pblczero::NetworkFormat::InputFormat input_format,
-                   InputPlanes planes, ChessBoard* board, int* rule50,
+                   const InputPlanes& planes, ChessBoard* board, int* rule50,
                    int* gameply);
 
 }  // namespace lczero
@@ -135,7 +135,8 @@ InputPlanes EncodePositionForNN(
     pblczero::NetworkFormat::InputFormat input_format,
     const PositionHistory& history, int history_planes,
     FillEmptyHistory fill_empty_history, int* transform_out) {
-  InputPlanes result(kAuxPlaneBase + 8);
+  static_assert(kAuxPlaneBase + 8 == kInputPlanes, "input plane count");
+  InputPlanes result;
 
   int transform = 0;
   // Canonicalization format needs to stop early to avoid applying transform in
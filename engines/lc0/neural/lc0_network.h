@@ -27,7 +27,9 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 #include "proto/net.pb.h"
@@ -50,15 +52,33 @@ struct InputPlane {
   std::uint64_t mask = 0ull;
   float value = 1.0f;
 };
-using InputPlanes = std::vector<InputPlane>;
+// The input of one sample, a fixed size value type so that computations keep
+// their batch in one contiguous buffer and no heap allocation is made per leaf.
+using InputPlanes = std::array<InputPlane, kInputPlanes>;
+static_assert(std::is_trivially_copyable<InputPlanes>::value,
+              "InputPlanes must be copyable as plain memory");
 
 // An interface to implement by computing backends.
 class NetworkComputation {
  public:
   // Adds a sample to the batch.
   virtual void AddInput(InputPlanes&& input) = 0;
+  // Adds @count samples stored one after the other, as the batching wrappers
+  // hand over whole batches. Backends keeping their batch in one buffer copy
+  // them in one go.
+  virtual void AddInputs(const InputPlanes* inputs, int count) {
+    for (int i = 0; i < count; i++) AddInput(InputPlanes(inputs[i]));
+  }
   // Do the computation.
   virtual void ComputeBlocking() = 0;
+  // Starts the computation and, if the backend computes on threads of its
+  // own, returns before it is done; Wait() then waits for the results. The
+  // default computes on the calling thread before returning.
+  virtual void ComputeAsync() { ComputeBlocking(); }
+  // True once the results of ComputeAsync() are there.
+  virtual bool IsReady() const { return true; }
+  // Waits for the results of ComputeAsync().
+  virtual void Wait() {}
   // Returns how many times AddInput() was called.
   virtual int GetBatchSize() const = 0;
   // Returns Q value of @sample.
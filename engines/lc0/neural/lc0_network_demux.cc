@@ -31,6 +31,7 @@
 
 #include "neural/lc0_factory.h"
 #include "utils/lc0_exception.h"
+#include "utils/lc0_mutex.h"
 
 namespace lczero {
 namespace {
@@ -42,6 +43,10 @@ class DemuxingComputation : public NetworkComputation {
 
   void AddInput(InputPlanes&& input) override { planes_.emplace_back(input); }
 
+  void AddInputs(const InputPlanes* inputs, int count) override {
+    planes_.insert(planes_.end(), inputs, inputs + count);
+  }
+
   void ComputeBlocking() override;
 
   int GetBatchSize() const override { return planes_.size(); }
@@ -71,22 +76,19 @@ class DemuxingComputation : public NetworkComputation {
   }
 
   void NotifyComplete() {
-    std::unique_lock<std::mutex> lock(mutex_);
-    dataready_--;
-    if (dataready_ == 0) {
-      dataready_cv_.notify_one();
-    }
+    if (remaining_.fetch_sub(1) == 1) done_.Notify();
   }
 
+  // Takes the next split of the batch, the slots of parents_ are reserved
+  // before the splits are enqueued so the workers share no lock.
   NetworkComputation* AddParentFromNetwork(Network* network) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    parents_.emplace_back(network->NewComputation());
-    const int cur_idx = (parents_.size() - 1) * partial_size_;
-    for (int i = cur_idx; i < std::min(GetBatchSize(), cur_idx + partial_size_);
-         i++) {
-      parents_.back()->AddInput(std::move(planes_[i]));
-    }
-    return parents_.back().get();
+    const int split = next_split_.fetch_add(1, std::memory_order_relaxed);
+    auto& parent = parents_[split];
+    parent = network->NewComputation();
+    const int cur_idx = split * partial_size_;
+    parent->AddInputs(&planes_[cur_idx],
+                      std::min(GetBatchSize() - cur_idx, partial_size_));
+    return parent.get();
   }
 
  private:
@@ -94,9 +96,9 @@ class DemuxingComputation : public NetworkComputation {
   DemuxingNetwork* network_;
   std::vector<std::unique_ptr<NetworkComputation>> parents_;
 
-  std::mutex mutex_;
-  std::condition_variable dataready_cv_;
-  int dataready_ = 0;
+  std::atomic<int> next_split_{0};
+  std::atomic<int> remaining_{0};
+  CompletionEvent done_;
   int partial_size_ = 0;
 };
 
@@ -229,12 +231,15 @@ void DemuxingComputation::ComputeBlocking() {
   }
   const int splits = (GetBatchSize() + partial_size_ - 1) / partial_size_;
 
-  std::unique_lock<std::mutex> lock(mutex_);
-  dataready_ = splits;
+  parents_.clear();
+  parents_.resize(splits);
+  next_split_ = 0;
+  remaining_ = splits;
+  done_.Reset();
   for (int j = 0; j < splits; j++) {
     network_->Enqueue(this);
   }
-  dataready_cv_.wait(lock, [this]() { return dataready_ == 0; });
+  done_.Wait();
 }
 
 std::unique_ptr<Network> MakeDemuxingNetwork(
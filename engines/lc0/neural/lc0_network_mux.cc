@@ -31,6 +31,7 @@
 
 #include "neural/lc0_factory.h"
 #include "utils/lc0_exception.h"
+#include "utils/lc0_mutex.h"
 
 namespace lczero {
 namespace {
@@ -42,7 +43,20 @@ class MuxingComputation : public NetworkComputation {
 
   void AddInput(InputPlanes&& input) override { planes_.emplace_back(input); }
 
-  void ComputeBlocking() override;
+  void AddInputs(const InputPlanes* inputs, int count) override {
+    planes_.insert(planes_.end(), inputs, inputs + count);
+  }
+
+  void ComputeBlocking() override {
+    ComputeAsync();
+    Wait();
+  }
+
+  void ComputeAsync() override;
+
+  bool IsReady() const override { return ready_.IsNotified(); }
+
+  void Wait() override { ready_.Wait(); }
 
   int GetBatchSize() const override { return planes_.size(); }
 
@@ -66,14 +80,10 @@ class MuxingComputation : public NetworkComputation {
     // Populate our batch into batch of batches.
     parent_ = parent;
     idx_in_parent_ = parent->GetBatchSize();
-    for (auto& x : planes_) parent_->AddInput(std::move(x));
+    parent_->AddInputs(planes_.data(), static_cast<int>(planes_.size()));
   }
 
-  void NotifyReady() {
-    std::unique_lock<std::mutex> lock(mutex_);
-    dataready_ = true;
-    dataready_cv_.notify_one();
-  }
+  void NotifyReady() { ready_.Notify(); }
 
  private:
   std::vector<InputPlanes> planes_;
@@ -81,9 +91,7 @@ class MuxingComputation : public NetworkComputation {
   std::shared_ptr<NetworkComputation> parent_;
   int idx_in_parent_ = 0;
 
-  std::mutex mutex_;
-  std::condition_variable dataready_cv_;
-  bool dataready_ = false;
+  CompletionEvent ready_;
 };
 
 class MuxingNetwork : public Network {
@@ -154,9 +162,10 @@ class MuxingNetwork : public Network {
   }
 
   void Worker(Network* network, const int max_batch) {
+    std::vector<MuxingComputation*> children;
     // While Abort() is not called (and it can only be called from destructor).
     while (!abort_) {
-      std::vector<MuxingComputation*> children;
+      children.clear();
       // Create new computation in "upstream" network, to gather batch into
       // there.
       std::shared_ptr<NetworkComputation> parent(network->NewComputation());
@@ -167,23 +176,24 @@ class MuxingNetwork : public Network {
         if (abort_) break;
 
         // While there is a work in queue, add it.
+        int batch_size = 0;
         while (!queue_.empty()) {
           // If we are reaching batch size limit, stop adding.
           // However, if a single input batch is larger than output batch limit,
           // we still have to add it.
-          if (parent->GetBatchSize() != 0 &&
-              parent->GetBatchSize() + queue_.front()->GetBatchSize() >
-                  max_batch) {
-            break;
-          }
+          const int size = queue_.front()->GetBatchSize();
+          if (batch_size != 0 && batch_size + size > max_batch) break;
           // Remember which of "input" computations we serve.
           children.push_back(queue_.front());
           queue_.pop();
-          // Make "input" computation populate data into output batch.
-          children.back()->PopulateToParent(parent);
+          batch_size += size;
         }
       }
 
+      // Make "input" computations populate data into output batch, outside
+      // of the lock so that the search threads can keep enqueueing.
+      for (auto child : children) child->PopulateToParent(parent);
+
       // Compute.
       parent->ComputeBlocking();
       // Notify children that data is ready!
@@ -218,10 +228,9 @@ class MuxingNetwork : public Network {
   std::vector<std::thread> threads_;
 };
 
-void MuxingComputation::ComputeBlocking() {
+void MuxingComputation::ComputeAsync() {
+  ready_.Reset();
   network_->Enqueue(this);
-  std::unique_lock<std::mutex> lock(mutex_);
-  dataready_cv_.wait(lock, [this]() { return dataready_; });
 }
 
 std::unique_ptr<Network> MakeMuxingNetwork(
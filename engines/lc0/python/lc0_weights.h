@@ -124,7 +124,7 @@ class Input {
     }
   }
 
-  InputPlanes data_{kInputPlanes};
+  InputPlanes data_{};
 };
 
 class Output {
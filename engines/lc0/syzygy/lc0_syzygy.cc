@@ -47,11 +47,9 @@
 #include "utils/lc0_exception.h"
 #include "utils/lc0_logging.h"
 #include "utils/lc0_mutex.h"
+#include "syzygymap.h"
 
 #ifndef _WIN32
-#include <fcntl.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
 #include <unistd.h>
 #else
 #define WIN32_LEAN_AND_MEAN
@@ -1038,22 +1036,16 @@ class SyzygyTablebaseImpl {
     std::string fname = name_for_tb(name, suffix);
     void* base_address;
 #ifndef _WIN32
-    struct stat statbuf;
-    int fd = ::open(fname.c_str(), O_RDONLY);
-    if (fd == -1) return nullptr;
-    fstat(fd, &statbuf);
-    if (statbuf.st_size % 64 != 16) {
+    // Added by BanksiaGUI. The mapping is shared with the other engines.
+    uint64_t size;
+    base_address = const_cast<void*>(syzygy_mapFile(fname.c_str(), &size));
+    if (!base_address && !size) return nullptr;
+    if (size % 64 != 16) {
+      syzygy_unmapFile(base_address);
       throw Exception("Corrupt tablebase file " + fname);
     }
-    *mapping = statbuf.st_size;
-    base_address = mmap(nullptr, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
-#if defined(MADV_RANDOM)
-    // For context: <https://github.com/official-stockfish/Stockfish/pull/1829>
-    // and <https://github.com/official-stockfish/Stockfish/pull/3094>.
-    madvise(base_address, statbuf.st_size, MADV_RANDOM);
-#endif
-    ::close(fd);
-    if (base_address == MAP_FAILED) {
+    *mapping = size;
+    if (!base_address) {
       throw Exception("Could not mmap() " + fname);
     }
 #else
@@ -1083,7 +1075,8 @@ class SyzygyTablebaseImpl {
 
   void unmap_file(void* base_address, map_t mapping) {
 #ifndef _WIN32
-    munmap(base_address, mapping);
+    (void)mapping;
+    syzygy_unmapFile(base_address);
 #else
     UnmapViewOfFile(base_address);
     CloseHandle(mapping);
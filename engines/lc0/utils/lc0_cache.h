@@ -114,12 +114,14 @@ class HashKeyedCache {
     if (capacity_.load(std::memory_order_relaxed) == 0) return nullptr;
 
     SpinMutex::Lock lock(mutex_);
+    ++lookups_;
 
     size_t idx = key % hash_.size();
     while (true) {
       if (!hash_[idx].in_use) break;
       if (hash_[idx].key == key) {
         ++hash_[idx].pins;
+        ++hits_;
         return hash_[idx].value.get();
       }
       ++idx;
@@ -208,6 +210,17 @@ class HashKeyedCache {
     return size_;
   }
   int GetCapacity() const { return capacity_.load(std::memory_order_relaxed); }
+  // Number of LookupAndPin calls, and how many of them found the key, since
+  // the last ResetStats().
+  void GetStats(uint64_t* lookups, uint64_t* hits) const {
+    SpinMutex::Lock lock(mutex_);
+    *lookups = lookups_;
+    *hits = hits_;
+  }
+  void ResetStats() {
+    SpinMutex::Lock lock(mutex_);
+    lookups_ = hits_ = 0;
+  }
   static constexpr size_t GetItemStructSize() { return sizeof(Entry); }
 
  private:
@@ -277,6 +290,8 @@ class HashKeyedCache {
   std::atomic<int> capacity_;
   int size_ GUARDED_BY(mutex_) = 0;
   int allocated_ GUARDED_BY(mutex_) = 0;
+  uint64_t lookups_ GUARDED_BY(mutex_) = 0;
+  uint64_t hits_ GUARDED_BY(mutex_) = 0;
   // Fresh in back, stale at front.
   std::deque<uint64_t> GUARDED_BY(mutex_) insertion_order_;
   std::vector<Entry> GUARDED_BY(mutex_) evicted_;
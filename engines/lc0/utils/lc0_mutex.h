@@ -28,6 +28,7 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <shared_mutex>
 #include <thread>
@@ -168,4 +169,58 @@ class CAPABILITY("mutex") SpinMutex {
   std::atomic<int> mutex_{0};
 };
 
+// One-shot completion signal between two threads. The waiter may spin for a
+// few iterations before it parks on a condition variable, and Notify() only
+// takes the lock when the waiter is parked.
+class CompletionEvent {
+ public:
+  // Default spin count of Wait(), a few microseconds at most. Backend results
+  // take far longer, so spinning longer would only burn a core.
+  static constexpr int kDefaultSpinIterations = 64;
+
+  // Prepares the event for the next Wait(), no thread may be using it.
+  void Reset() {
+    state_.store(kWaiting, std::memory_order_relaxed);
+    signaled_ = false;
+  }
+
+  void Notify() {
+    if (state_.exchange(kReady) != kParked) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    signaled_ = true;
+    cv_.notify_one();
+  }
+
+  // True once Notify() was called, without waiting.
+  bool IsNotified() const {
+    return state_.load(std::memory_order_acquire) == kReady;
+  }
+
+  // Spins at most spin_iterations times, 0 blocks right away.
+  void Wait(int spin_iterations = kDefaultSpinIterations) {
+    // Spinning only helps if the notifying thread runs at the same time.
+    static const bool can_spin = std::thread::hardware_concurrency() > 1;
+    if (!can_spin) spin_iterations = 0;
+    for (int i = 0; i < spin_iterations; i++) {
+      if (state_.load(std::memory_order_acquire) == kReady) return;
+      SpinloopPause();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    int expected = kWaiting;
+    // If Notify() comes first it never touches the event again, otherwise it
+    // signals under the lock and we must not return before that.
+    if (state_.compare_exchange_strong(expected, kParked)) {
+      cv_.wait(lock, [this]() { return signaled_; });
+    }
+  }
+
+ private:
+  enum { kWaiting, kParked, kReady };
+
+  std::atomic<int> state_{kWaiting};
+  bool signaled_ = false;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
 }  // namespace lczero
@@ -83,6 +83,8 @@
 #include <algorithm>
 #include <iterator>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <map>
 #include <time.h>
 #include <array>
@@ -96,6 +98,8 @@
 #include "zlib/zlib.h"
 #endif
 
+#include "../simdkernels.h"
+
 #define USE_SIMD
 #if defined(USE_SSE2)
 #include <immintrin.h>
@@ -772,6 +776,7 @@ string IndexToAlgebraic(int i);
 void BitboardDraw(U64 b);
 U64 getTime();
 string CurrentWorkingDir();
+bool bindThisThread(int binding, int index, int threads);
 #ifdef _WIN32
 void* my_large_malloc(size_t s);
 void my_large_free(void *m);
@@ -797,6 +802,7 @@ enum NnueType { NnueDisabled = 0, NnueArchV1, NnueArchV5 };
 #define NNUEFILEVERSIONSFNNv5_1024  0x7af32f20u
 #define NNUEFILEVERSIONSFNNv5_512   0x7af32f30u
 #define NNUEFILEVERSIONSFNNv5_768   0x7af32f31u
+#define NNUEFILEVERSIONNATIVE       0x7af32f40u     // RubiChess specific, weights in the memory layout of the build (export native)
 #define NNUENETLAYERHASH            0xCC03DAE4u
 #define NNUECLIPPEDRELUHASH         0x538D24C7u
 #define NNUEFEATUREHASH_HalfKP      0x5D69D5B8u
@@ -806,6 +812,7 @@ enum NnueType { NnueDisabled = 0, NnueArchV1, NnueArchV5 };
 #define ORIENT(c,i) ((c) ? (i) ^ 0x3f : (i))
 #define HMORIENT(c,i,k) (i ^ (bool(c) * 56) ^ ((FILE(k) < 4) * 7))
 #define MULTIPLEOFN(i,n) (((i) + (n - 1)) / n * n)
+#define NNUENATIVEALIGN 64
 
 #if defined(USE_SSE2) && !defined(USE_SSSE3) && defined FASTSSE2
 // for native SSE2 platforms we have faster intrinsics for 16bit integers
@@ -817,6 +824,24 @@ typedef int8_t weight_t;
 typedef int8_t clipped_t;
 #endif
 
+// The order of the network layer weights in memory (see NnueNetworkLayer::shuffleWeightIndex).
+// Native network files are only valid for builds with the same layout
+#if defined(USE_AVX512)
+#define NNUENATIVELAYOUT 5
+#elif defined(USE_AVX2)
+#define NNUENATIVELAYOUT 4
+#elif defined(USE_SSSE3)
+#define NNUENATIVELAYOUT 3
+#elif defined(USE_ARM64)
+#define NNUENATIVELAYOUT 2
+#elif defined(USE_NEON)
+#define NNUENATIVELAYOUT 1
+#elif defined(USE_FASTSSE2)
+#define NNUENATIVELAYOUT 6      // 16bit weights
+#else
+#define NNUENATIVELAYOUT 0
+#endif
+
 // All pieces and both kings for HalfKA are inputs => 32 dimensions
 typedef struct {
     size_t size;
@@ -834,16 +859,22 @@ typedef struct {
 class NnueNetsource {
 public:
     ~NnueNetsource() {
-        if (readbuffer)
-            freealigned64(readbuffer);
-        readbuffer = nullptr;
+        close();
     };
-    unsigned char* readbuffer;
-    size_t readbuffersize;
-    unsigned char* next;
+    unsigned char* readbuffer = nullptr;
+    size_t readbuffersize = 0;
+    unsigned char* next = nullptr;
+    size_t mappedsize = 0;      // readbuffer is a private mapping of a native network file
+    bool handedover = false;    // the buffer belongs to the feature transformer now
+    bool native = false;        // read/write the weights in the memory layout of this build
     bool open();
+    bool mapNative(string filename);
+    void close();
+    void handOver(NnueNetsource* owner);
     bool read(unsigned char* target, size_t readsize);
     bool write(unsigned char* source, size_t writesize);
+    unsigned char* map(size_t size);
+    bool writeAligned(unsigned char* source, size_t writesize);
     bool endOfNet();
 };
 
@@ -851,6 +882,7 @@ public:
 class NnueArchitecture
 {
 public:
+    virtual ~NnueArchitecture() {}
     virtual bool ReadFeatureWeights(NnueNetsource* nr, bool bpz) = 0;
     virtual bool ReadWeights(NnueNetsource* nr, uint32_t nethash) = 0;
     virtual void WriteFeatureWeights(NnueNetsource* nr, bool bpz) = 0;
@@ -907,9 +939,12 @@ template <int ftdims, int inputdims, int psqtbuckets>
 class NnueFeatureTransformer : public NnueLayer
 {
 public:
-    alignas(64) int16_t bias[ftdims];
-    alignas(64) int16_t weight[ftdims * inputdims];
-    alignas(64) int32_t psqtWeights[psqtbuckets ? psqtbuckets * inputdims : 1];    // hack to avoid zero-sized array
+    // The weights are far too big to copy around, they point into storage which is either
+    // an allocated buffer or the mapping of a native network file
+    int16_t* bias = nullptr;
+    int16_t* weight = nullptr;
+    int32_t* psqtWeights = nullptr;
+    NnueNetsource storage;
 
     NnueFeatureTransformer() : NnueLayer(NULL) {}
     bool ReadFeatureWeights(NnueNetsource* nr, bool bpz);
@@ -1095,6 +1130,16 @@ public:
 };
 
 
+// The big layer has a dot product kernel for the NEON weight layout which needs more than the
+// instruction set of the binary. It is compiled with a target attribute and used at runtime if
+// the cpu has it, the other NNUE kernels are in simdkernels.cpp
+#if defined(USE_NEON) && defined(__aarch64__) && (defined(__ARM_FEATURE_DOTPROD) \
+    || (defined(__apple_build_version__) && __clang_major__ >= 16) \
+    || (!defined(__apple_build_version__) && defined(__clang_major__) && __clang_major__ >= 17) \
+    || (!defined(__clang_major__) && defined(__GNUC__) && __GNUC__ >= 8))
+#define USE_RUNTIMEDOTPROD
+#endif
+
 void NnueInit();
 void NnueRemove();
 bool NnueReadNet(NnueNetsource* nr);
@@ -1135,7 +1180,7 @@ struct Binpack
     bool debug() { return false; /*size_t offset = *data - base; return numChunks == 3 && offset > 0x170 && offset < 0x200; */ }
 };
 
-void gensfen(vector<string> args);
+U64 gensfen(vector<string> args, U64* elapsedms = nullptr);
 void convert(vector<string> args);
 void learn(vector<string> args);
 
@@ -1237,7 +1282,8 @@ public:
 };
 
 
-typedef struct pawnhashentry {
+// One entry per cache line
+typedef struct alignas(64) pawnhashentry {
     uint32_t hashupper;
     int32_t value;
     U64 passedpawnbb[2];
@@ -1248,22 +1294,26 @@ typedef struct pawnhashentry {
 } S_PAWNHASHENTRY;
 
 
+// Per thread tables, the probe counters are reset with 'stats reset' or reallocation
 class Pawnhash
 {
 public:
     S_PAWNHASHENTRY *table;
     U64 sizemask;
+    U64 probes;
+    U64 hits;
     void setSize(int sizeMb);
     void remove();
     bool probeHash(U64 hash, pawnhashentry **entry);
+    void prefetch(U64 hash) { PREFETCH(&table[hash & sizemask]); }
 };
 
 
-#define MATERIALHASHSIZE 0x10000
-#define MATERIALHASHMASK (MATERIALHASHSIZE - 1)
+#define MATERIALHASHDEFAULTMB 2
 
 
-struct Materialhashentry {
+// Two entries per cache line
+struct alignas(32) Materialhashentry {
     U64 hash;
     int scale[2];
     bool onlyPawns;
@@ -1275,7 +1325,10 @@ class Materialhash
 {
 public:
     Materialhashentry *table;
-    void init();
+    U64 sizemask;
+    U64 probes;
+    U64 hits;
+    void init(int sizeMb = MATERIALHASHDEFAULTMB);
     void remove();
     bool probeHash(U64 hash, Materialhashentry **entry);
 };
@@ -1646,6 +1699,41 @@ enum PvAbortType {
 // Replace the occupied bitboards with the first two so far unused piece bitboards
 #define occupied00 piece00
 
+// Search counters that are always compiled in, one cache aligned block per thread (no races)
+// Summed over the threads by the 'stats' command; STATISTICS builds have the detailed global ones
+struct alignas(64) searchcounters
+{
+    U64 qs_n;                   // calls to qsearch
+    U64 qs_moves;               // moves done in qs
+    U64 ab_n;                   // calls to alphabeta
+    U64 ab_pv;                  // PV nodes
+    U64 ab_tt;                  // alphabeta exits by tt hit
+    U64 prune_threat;           // nodes pruned by (no opponents) threat
+    U64 prune_futility;         // nodes pruned by reverse futility
+    U64 prune_nm;               // nodes pruned by null move
+    U64 prune_probcut;          // nodes pruned by ProbCut
+    U64 prune_multicut;         // nodes pruned by Multicut
+    U64 moves_loop_n;           // alphabeta move loops entered
+    U64 moves_pruned_lmp;       // move loops left by lmp
+    U64 moves_pruned_futility;  // moves pruned by futility
+    U64 moves_pruned_badsee;    // moves pruned by bad see
+    U64 moves_played;           // moves played in alphabeta
+    U64 moves_fail_high;        // moves that cause a fail high
+    U64 moves_fail_high_first;  // ... and were the first legal move
+    U64 red_n;                  // late move reductions
+    U64 red_total;              // total plies reduced by them
+    U64 extend_singular;        // singular extensions
+    U64 nnue_accupdate_all;     // calls to UpdateAccumulator
+    U64 nnue_accupdate_cache;   // already up-to-date accumulators
+    U64 nnue_accupdate_inc;     // incremental updates
+    U64 nnue_accupdate_full;    // full updates
+};
+
+extern const char* searchcounternames[sizeof(searchcounters) / sizeof(U64)];
+
+#define COUNTERINC(x)       counters.x++
+#define COUNTERADD(x, v)    counters.x += (v)
+
 class chessposition
 {
 public:
@@ -1707,6 +1795,8 @@ public:
     // The following members get an explicit init in engine::prepareThreads()
     U64 nodes;
     U64 tbhits;
+    U64 ttprobes;
+    U64 tthits;
     int nullmoveside;
     int nullmoveply;
     int nodesToNextCheck;
@@ -1735,6 +1825,7 @@ public:
     int16_t staticevalstack[MAXDEPTH];
     Materialhash mtrlhsh;                               // init in alloc
     Pawnhash pwnhsh;                                    // init in alloc
+    searchcounters counters;                            // init in alloc, reset by 'stats reset'
     bool computationState[MAXDEPTH][2];
     int16_t* accumulation;
     int32_t* psqtAccumulation;
@@ -1830,6 +1921,7 @@ public:
     template <Color me> inline int CreateMovelistCastle(chessmove* mstart);
     template <MoveType Mt> void evaluateMoves(chessmovelist* ml);
     int probe_wdl(int* success);
+    int probe_wdl_uncached(int* success);
     int probe_dtz(int* success);
     int root_probe_dtz();
     int root_probe_wdl();
@@ -1940,9 +2032,7 @@ const map<string, GuiToken> GuiCommandMap = {
     { "convert", CONVERT },
     { "learn", LEARN },
 #endif
-#ifdef STATISTICS
     { "stats", STATS },
-#endif
     { "uci", UCI },
     { "debug", UCIDEBUG },
     { "isready", ISREADY },
@@ -1997,6 +2087,10 @@ typedef map<string, ucioption_t>::iterator optionmapiterator;
 #define NODESPERCHECK 0xfff
 enum ponderstate_t { NO, PONDERING };
 
+// Values of the ThreadBinding and HelperDepthSkip combo options
+enum { ThreadBindNone, ThreadBindCores, ThreadBindNuma };
+enum { DepthSkipLaser, DepthSkipHalf, DepthSkipNone };
+
 
 #define CPUSSE2     (1 << 0)
 #define CPUSSSE3    (1 << 1)
@@ -2008,10 +2102,13 @@ enum ponderstate_t { NO, PONDERING };
 #define CPUAVX512   (1 << 7)
 #define CPUNEON     (1 << 8)
 #define CPUARM64    (1 << 9)
+#define CPUDOTPROD  (1 << 10)
+#define CPUAVXVNNI  (1 << 11)
+#define CPUAVX512VNNI (1 << 12)
 
 class compilerinfo
 {
-    const string strCpuFeatures[10] = { "sse2","ssse3","popcnt","lzcnt","bmi1","avx2","bmi2", "avx512", "neon", "arm64"};
+    const string strCpuFeatures[13] = { "sse2","ssse3","popcnt","lzcnt","bmi1","avx2","bmi2", "avx512", "neon", "arm64", "dotprod", "avxvnni", "avx512vnni"};
 public:
     const U64 binarySupports = 0ULL
 #ifdef USE_POPCNT
@@ -2040,9 +2137,19 @@ public:
 #endif
 #ifdef USE_ARM64
         | CPUARM64
+#endif
+#ifdef USE_VNNI
+        | CPUAVX512VNNI
 #endif
         ;
 
+    // Features used by the NNUE kernels of simdkernels.cpp when the machine supports them
+    const U64 runtimeSupports = (simd_supported(SimdAvx2) ? CPUAVX2 : 0ULL)
+        | (simd_supported(SimdAvxVnni) ? CPUAVXVNNI : 0ULL)
+        | (simd_supported(SimdAvx512) ? CPUAVX512 : 0ULL)
+        | (simd_supported(SimdAvx512Vnni) ? CPUAVX512VNNI : 0ULL)
+        | (simd_supported(SimdDotprod) ? CPUDOTPROD : 0ULL);
+
     U64 machineSupports;
     string system;
     int cpuVendor;
@@ -2102,6 +2209,10 @@ public:
     chessposition rootposition;
     int Threads;
     int oldThreads;
+    int ThreadBinding;
+    int HelperDepthSkip;
+    int PawnHash;       // MB per thread, 0 = sized from what the TT leaves of Hash
+    int MaterialHash;   // MB per thread
     searchthread *sthread;
     ponderstate_t pondersearch;
     int ponderhitbonus;
@@ -2174,6 +2285,8 @@ public:
     void communicate(string inputstring);
     void allocThreads();
     void getNodesAndTbhits(U64 *nodes, U64 *tbhits);
+    void getTtStats(U64 *probes, U64 *hits);
+    void outputStats(vector<string> args);
     U64 perft(int depth, bool printsysteminfo = false);
     void bench(int constdepth, string epdfilename, int consttime, int startnum, bool openbench);
     void prepareThreads();
@@ -2315,17 +2428,29 @@ public:
     uint64_t toppadding[8];
     chessposition pos;
     thread thr;
+    // Persistent search thread, parked in idleLoop between searches
+    thread poolthr;
+    mutex poolmutex;
+    condition_variable poolcv;
+    void (*job)(searchthread*);
+    bool searching;
+    bool exiting;
+    int binding;
     int index;
     int depth;
     int lastCompleteDepth;
     U64 nps;
 #ifdef NNUELEARN
-    PackedSfenValue* psvbuffer;
+    PackedSfenValue* psvbuffer;     // positions of the current game
     PackedSfenValue* psv;
-    int totalchunks;
-    int chunkstate[2];
 #endif
     uint64_t bottompadding[8];
+    void startPool(void (*initjob)(searchthread*));
+    void stopPool();
+    void startSearching(void (*f)(searchthread*));
+    void waitForSearchFinished();
+private:
+    void idleLoop();
 };
 
 
@@ -2590,11 +2715,6 @@ namespace Simd {
         int16x8_t sum = vpaddq_s16(product0, product1);
         acc = vpadalq_s16(acc, sum);
     }
-#ifdef USE_DOTPROD
-    inline void dotprod_m128_add_dpbusd_32(int32x4_t& acc, int8x16_t a, int8x16_t b) {
-        acc = vdotq_s32(acc, a, b);
-    }
-#endif
 #endif
 
     inline int neon_m128_reduce_add_epi32(int32x4_t s) {
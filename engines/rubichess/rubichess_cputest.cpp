@@ -27,13 +27,15 @@ using namespace rubichess;
 #if defined _MSC_VER && !defined(__clang_major__)
 #include <intrin.h>
 #define CPUID(x,i) __cpuid(x, i)
+#define CPUIDEX(x,i,s) __cpuidex(x, i, s)
 #endif
 
 #if defined(__MINGW64__) || defined(__gnu_linux__) || defined(__clang_major__) || defined(__GNUC__)
 #include <cpuid.h>
-#define CPUID(x,i) cpuid(x, i)
-static void cpuid(int32_t out[4], int32_t x) {
-    __cpuid_count(x, 0, out[0], out[1], out[2], out[3]);
+#define CPUID(x,i) cpuid(x, i, 0)
+#define CPUIDEX(x,i,s) cpuid(x, i, s)
+static void cpuid(int32_t out[4], int32_t x, int32_t s) {
+    __cpuid_count(x, s, out[0], out[1], out[2], out[3]);
 }
 #endif
 
@@ -90,6 +92,13 @@ void compilerinfo::GetSystemInfo()
             if (CPUInfo[1] & (1 << 8)) machineSupports |= CPUBMI2;
             if (CPUInfo[1] & (1 << 5)) machineSupports |= CPUAVX2;
             if (CPUInfo[1] & ((1 << 16) | (1 << 30))) machineSupports |= CPUAVX512; // AVX512F + AVX512BW needed
+            if ((CPUInfo[1] & (1 << 16)) && (CPUInfo[2] & (1 << 11))) machineSupports |= CPUAVX512VNNI;
+            if (CPUInfo[0] >= 1)
+            {
+                int CPUInfo1[4];
+                CPUIDEX(CPUInfo1, 7, 1);
+                if (CPUInfo1[0] & (1 <<  4)) machineSupports |= CPUAVXVNNI;
+            }
         }
     }
 
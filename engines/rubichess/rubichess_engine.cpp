@@ -31,6 +31,7 @@ void engineHeader()
     guiCom << "System: " + cinfo.SystemName() + "\n";
     guiCom << "CPU-Features of system: " + cinfo.PrintCpuFeatures(cinfo.machineSupports) + "\n";
     guiCom << "CPU-Features of binary: " + cinfo.PrintCpuFeatures(cinfo.binarySupports) + "\n";
+    guiCom << "NNUE kernels: " + string(simd_levelName(simd_level())) + "\n";
     guiCom << "========================================================================================\n";
 }
 
@@ -58,10 +59,16 @@ static void uciAllowLargePages()
 
 static void uciSetThreads()
 {
-    en.sizeOfPh = min(128, max(16, en.restSizeOfTp / en.Threads));
+    en.sizeOfPh = (en.PawnHash ? en.PawnHash : min(128, max(16, en.restSizeOfTp / en.Threads)));
     en.allocThreads();
 }
 
+static void uciSetEvalHash()
+{
+    if (en.Threads)     // not while registering the options
+        uciSetThreads();
+}
+
 static void uciSetHash()
 {
     int newRestSizeTp = tp.setSize(en.Hash);
@@ -211,6 +218,10 @@ void engine::registerOptions()
 #ifdef _WIN32
     ucioptions.Register(&allowlargepages, "Allow Large Pages", ucicheck, "true", 0, 0, uciAllowLargePages);
 #endif
+    ucioptions.Register(&ThreadBinding, "ThreadBinding", ucicombo, "None", 0, 0, nullptr, "None/Cores/Numa");    // applied by the threads at their next search
+    ucioptions.Register(&HelperDepthSkip, "HelperDepthSkip", ucicombo, "Laser", 0, 0, nullptr, "Laser/Half/None");
+    ucioptions.Register(&PawnHash, "PawnHash", ucispin, "0", 0, 1024, uciSetEvalHash);    // 0 = auto, at least 16
+    ucioptions.Register(&MaterialHash, "MaterialHash", ucispin, to_string(MATERIALHASHDEFAULTMB), 1, 64, uciSetEvalHash);
     ucioptions.Register(&Threads, "Threads", ucispin, "1", 1, MAXTHREADS, uciSetThreads);  // order is important as the pawnhash depends on Threads > 0
     ucioptions.Register(&Hash, "Hash", ucispin, to_string(DEFAULTHASH), 1, MAXHASH, uciSetHash);
     ucioptions.Register(&moveOverhead, "Move_Overhead", ucispin, "100", 0, 5000, nullptr);
@@ -231,17 +242,30 @@ void engine::registerOptions()
 }
 
 
+// Initial job of a pool thread
+static void allocThreadTables(searchthread* thr)
+{
+    chessposition* pos = &thr->pos;
+    pos->pwnhsh.setSize(en.sizeOfPh);
+    pos->mtrlhsh.init(en.MaterialHash);
+    memset(&pos->counters, 0, sizeof(searchcounters));
+    pos->accumulation = NnueCurrentArch ? NnueCurrentArch->CreateAccumulationStack() : nullptr;
+    pos->psqtAccumulation = NnueCurrentArch ? NnueCurrentArch->CreatePsqtAccumulationStack() : nullptr;
+}
+
+
 void engine::allocThreads()
 {
     // first cleanup the old searchthreads memory
     for (int i = 0; i < oldThreads; i++)
     {
+        sthread[i].stopPool();
         chessposition* pos = &sthread[i].pos;
         pos->mtrlhsh.remove();
         pos->pwnhsh.remove();
         freealigned64(pos->accumulation);
         freealigned64(pos->psqtAccumulation);
-        pos->~chessposition();
+        sthread[i].~searchthread();
     }
 
     freealigned64(sthread);
@@ -259,18 +283,86 @@ void engine::allocThreads()
     sthread = new (buf) searchthread[Threads];
     for (int i = 0; i < Threads; i++)
     {
+        // The thread allocates its own tables so they are placed on its node after binding
         sthread[i].index = i;
-        chessposition* pos = &sthread[i].pos;
-        pos->pwnhsh.setSize(sizeOfPh);
-        pos->mtrlhsh.init();
-        pos->accumulation = NnueCurrentArch ? NnueCurrentArch->CreateAccumulationStack() : nullptr;
-        pos->psqtAccumulation = NnueCurrentArch ? NnueCurrentArch->CreatePsqtAccumulationStack() : nullptr;
+        sthread[i].startPool(allocThreadTables);
     }
+    for (int i = 0; i < Threads; i++)
+        sthread[i].waitForSearchFinished();
     prepareThreads();
     resetStats();
 }
 
 
+//
+// Persistent thread pool
+// The search threads live from allocThreads to the next one and sleep in idleLoop between searches
+//
+void searchthread::startPool(void (*initjob)(searchthread*))
+{
+    job = initjob;
+    searching = true;
+    exiting = false;
+    binding = ThreadBindNone;
+    poolthr = thread(&searchthread::idleLoop, this);
+}
+
+
+void searchthread::stopPool()
+{
+    if (!poolthr.joinable())
+        return;
+    waitForSearchFinished();
+    {
+        unique_lock<mutex> lk(poolmutex);
+        exiting = true;
+        searching = true;
+    }
+    poolcv.notify_one();
+    poolthr.join();
+}
+
+
+void searchthread::startSearching(void (*f)(searchthread*))
+{
+    {
+        unique_lock<mutex> lk(poolmutex);
+        job = f;
+        searching = true;
+    }
+    poolcv.notify_one();
+}
+
+
+void searchthread::waitForSearchFinished()
+{
+    unique_lock<mutex> lk(poolmutex);
+    poolcv.wait(lk, [&] { return !searching; });
+}
+
+
+void searchthread::idleLoop()
+{
+    while (true)
+    {
+        // (Re)bind before the job so that memory touched first by the thread is local
+        if (binding != en.ThreadBinding)
+        {
+            bindThisThread(en.ThreadBinding, index, en.Threads);
+            binding = en.ThreadBinding;
+        }
+        job(this);
+
+        unique_lock<mutex> lk(poolmutex);
+        searching = false;
+        poolcv.notify_one();    // wake up waitForSearchFinished
+        poolcv.wait(lk, [&] { return searching; });
+        if (exiting)
+            return;
+    }
+}
+
+
 void engine::prepareThreads()
 {
     for (int i = 0; i < Threads; i++)
@@ -285,6 +377,8 @@ void engine::prepareThreads()
         pos->pondermove = 0;
         pos->nodes = 0;
         pos->tbhits = 0;
+        pos->ttprobes = 0;
+        pos->tthits = 0;
         pos->nullmoveply = 0;
         pos->nullmoveside = 0;
         pos->nodesToNextCheck = 0;
@@ -345,6 +439,100 @@ void engine::getNodesAndTbhits(U64* nodes, U64* tbhits)
 }
 
 
+void engine::getTtStats(U64* probes, U64* hits)
+{
+    U64 myprobes = 0;
+    U64 myhits = 0;
+    for (int i = 0; i < Threads; i++) {
+        myprobes += sthread[i].pos.ttprobes;
+        myhits += sthread[i].pos.tthits;
+    }
+
+    *probes = myprobes;
+    *hits = myhits;
+}
+
+
+//
+// stats [reset|json]: hit rates of the hash tables and the search counters summed over the threads
+// The TT counters cover the last search, the others the time since the last reset
+//
+const char* rubichess::searchcounternames[sizeof(searchcounters) / sizeof(U64)] = {
+    "qs_n", "qs_moves", "ab_n", "ab_pv", "ab_tt",
+    "prune_threat", "prune_futility", "prune_nm", "prune_probcut", "prune_multicut",
+    "moves_loop_n", "moves_pruned_lmp", "moves_pruned_futility", "moves_pruned_badsee",
+    "moves_played", "moves_fail_high", "moves_fail_high_first", "red_n", "red_total", "extend_singular",
+    "nnue_accupdate_all", "nnue_accupdate_cache", "nnue_accupdate_inc", "nnue_accupdate_full"
+};
+
+void engine::outputStats(vector<string> args)
+{
+    bool json = (args.size() && args[0] == "json");
+#ifdef STATISTICS
+    if (!json)
+        statistics.output(args);
+#endif
+    if (args.size() && args[0] == "reset")
+    {
+        for (int i = 0; i < Threads; i++)
+        {
+            chessposition* pos = &sthread[i].pos;
+            pos->pwnhsh.probes = pos->pwnhsh.hits = 0;
+            pos->mtrlhsh.probes = pos->mtrlhsh.hits = 0;
+            memset(&pos->counters, 0, sizeof(searchcounters));
+        }
+        return;
+    }
+
+    const int numcounters = sizeof(searchcounters) / sizeof(U64);
+    U64 probes[3] = { 0 }, hits[3] = { 0 };
+    U64 counters[numcounters] = { 0 };
+    getTtStats(&probes[0], &hits[0]);
+    for (int i = 0; i < Threads; i++)
+    {
+        chessposition* pos = &sthread[i].pos;
+        probes[1] += pos->pwnhsh.probes;
+        hits[1] += pos->pwnhsh.hits;
+        probes[2] += pos->mtrlhsh.probes;
+        hits[2] += pos->mtrlhsh.hits;
+        const U64* c = (const U64*)&pos->counters;
+        for (int j = 0; j < numcounters; j++)
+            counters[j] += c[j];
+    }
+    size_t sizeKb[3] = {
+        (size_t)((tp.sizemask + 1) * sizeof(transpositioncluster) >> 10),
+        Threads ? (size_t)((sthread[0].pos.pwnhsh.sizemask + 1) * sizeof(S_PAWNHASHENTRY) >> 10) : 0,
+        Threads ? (size_t)((sthread[0].pos.mtrlhsh.sizemask + 1) * sizeof(Materialhashentry) >> 10) : 0 };
+    const char* names[3] = { "hash", "pawnhash", "materialhash" };
+    char str[256];
+
+    if (json)
+    {
+        // one line for scripts
+        string out = "{\"threads\":" + to_string(Threads);
+        for (int i = 0; i < 3; i++)
+            out += ",\"" + string(names[i]) + "\":{\"size_kb\":" + to_string(sizeKb[i]) + ",\"probes\":" + to_string(probes[i]) + ",\"hits\":" + to_string(hits[i]) + "}";
+        out += ",\"search\":{";
+        for (int j = 0; j < numcounters; j++)
+            out += string(j ? "," : "") + "\"" + searchcounternames[j] + "\":" + to_string(counters[j]);
+        guiCom << out + "}}\n";
+        return;
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        snprintf(str, sizeof(str), "info string %-12s size %8zu kB%s  probes %12llu  hits %12llu  hitrate %5.1f%%\n",
+            names[i], sizeKb[i], i ? " per thread" : "           ", probes[i], hits[i], probes[i] ? 100.0 * hits[i] / probes[i] : 0.0);
+        guiCom << str;
+    }
+    for (int j = 0; j < numcounters; j++)
+    {
+        snprintf(str, sizeof(str), "info string %-22s %14llu\n", searchcounternames[j], counters[j]);
+        guiCom << str;
+    }
+}
+
+
 void engine::measureOverhead(bool wasPondering)
 {
     if (!wasPondering && lastmytime && lastmyinc == myinc)
@@ -740,11 +928,9 @@ void engine::communicate(string inputstring)
             case EXPORT:
                 NnueWriteNet(commandargs);
                 break;
-#ifdef STATISTICS
             case STATS:
-                statistics.output(commandargs);
+                outputStats(commandargs);
                 break;
-#endif
             default:
                 break;
             }
@@ -895,7 +1081,7 @@ void engine::searchStart()
     tp.nextSearch();
 
     for (int tnum = 0; tnum < Threads; tnum++)
-        sthread[tnum].thr = thread(mainSearch<RT>, &sthread[tnum]);
+        sthread[tnum].startSearching(mainSearch<RT>);
 }
 
 
@@ -908,8 +1094,7 @@ void engine::searchWaitStop(bool forceStop)
     if (forceStop)
         stopLevel = ENGINESTOPIMMEDIATELY;
     for (int tnum = 0; tnum < Threads; tnum++)
-        if (sthread[tnum].thr.joinable())
-            sthread[tnum].thr.join();
+        sthread[tnum].waitForSearchFinished();
     stopLevel = ENGINETERMINATEDSEARCH;
 }
 
@@ -998,7 +1183,22 @@ void ucioptions_t::Set(string n, string v, bool force)
             *(bool*)op->enginevar = bVal;
         break;
     case ucicombo:
-        break;  // FIXME: to be implemented when Rubi gets first combo option
+        // enginevar is the index of the value in the '/' separated varlist
+        {
+            string vl = op->varlist + "/";
+            transform(vl.begin(), vl.end(), vl.begin(), ::tolower);
+            transform(v.begin(), v.end(), v.begin(), ::tolower);
+            int cVal = 0;
+            size_t start = 0, end;
+            while ((end = vl.find('/', start)) != string::npos && vl.substr(start, end - start) != v)
+            {
+                start = end + 1;
+                cVal++;
+            }
+            if (end != string::npos && (bChanged = (force || cVal != *(int*)(op->enginevar))))
+                *(int*)(op->enginevar) = cVal;
+        }
+        break;
     case ucibutton:
         bChanged = true;
         break;
@@ -1075,7 +1275,14 @@ void ucioptions_t::Print()
             break;
 #endif
         case ucicombo:
-            break; // FIXME: to be implemented...
+        {
+            string vars = op->varlist;
+            size_t pos;
+            while ((pos = vars.find('/')) != string::npos)
+                vars.replace(pos, 1, " var ");
+            guiCom << optionStr + "combo default " + op->def + " var " + vars + "\n";
+            break;
+        }
         default:
             break;
         }
@@ -20,6 +20,7 @@
 
 #ifdef NNUELEARN
 #include <atomic>
+#include <condition_variable>
 #include <mutex>
 
 using namespace rubichess;
@@ -120,14 +121,8 @@ inline uint32_t rubiFromBinpack(chessposition* pos, uint16_t c)
 // Sfen/bin related code
 //
 
-#define GENSFEN_HASH_SIZE 0x1000000
-alignas(64) U64 sfenhash[GENSFEN_HASH_SIZE];
-
 const unsigned int sfenchunksize = 0x1000;
 const int sfenchunknums = 2;
-bool gensfenstop;
-
-enum { CHUNKFREE, CHUNKINUSE, CHUNKFULL };
 
 struct HuffmanedPiece
 {
@@ -323,38 +318,6 @@ void chessposition::toSfen(PackedSfen *sfen)
 }
 
 
-void flush_psv(int result, searchthread* thr)
-{
-    PackedSfenValue* p;
-    int fullchunk = -1;
-
-    if (!thr->psv)
-        // Not a single position of this game stored
-        return;
-
-    U64 offset = thr->psv - thr->psvbuffer;
-    while (true)
-    {
-        p = thr->psvbuffer + offset;
-        if (abs(p->game_result) != 2)
-            break;
-        p->game_result = p->game_result / 2 * result;
-        if (offset % sfenchunksize == 0)
-        {
-            fullchunk = ((int)(offset / sfenchunksize) + sfenchunknums - 1) % sfenchunknums;
-            if (offset == 0)
-                offset = sfenchunknums * sfenchunksize;
-        }
-        offset--;
-    }
-    if (fullchunk >= 0 && thr->chunkstate[fullchunk] == CHUNKINUSE)
-    {
-        thr->chunkstate[fullchunk] = CHUNKFULL;
-    }
-}
-
-
-
 //
 // BINPACK related code
 //
@@ -362,6 +325,26 @@ void flush_psv(int result, searchthread* thr)
 const size_t maxBinpackChunkSize = 1 * 1024 * 1024;
 size_t maxContinuationSize;
 
+static void flushBinpack(ostream *os, char *buffer, Binpack* bp)
+{
+    size_t size = *bp->data - buffer;   // default: copy everything up to the end
+    if (bp->flushAt) {
+        // buffer full, flushAt is the cutting point
+        size = bp->flushAt - buffer;
+    }
+
+    *((uint32_t*)(buffer + 4)) = (uint32_t)size - 8;
+    os->write(buffer, size);
+    if (bp->flushAt) {
+        size_t wrappedbytes = *bp->data - bp->flushAt;
+        memcpy(buffer + 8, bp->flushAt, wrappedbytes + 1);
+        *bp->data -= size - 8;
+        if (wrappedbytes)
+            bp->compmvsptr -= size - 8;
+        bp->flushAt = nullptr;
+    }
+}
+
 #define SHORTFROMBIGENDIAN(c) ((uint8_t)(c)[1] | ((uint8_t)(c)[0] << 8))
 #define LONGLONGFROMBIGENDIAN(c) ((U64)((uint8_t)(c)[7]) | ((U64)((uint8_t)(c)[6]) << 8) | ((U64)((uint8_t)(c)[5]) << 16) | (((U64)((uint8_t)(c)[4])) << 24ULL) | ((U64)((uint8_t)(c)[3]) << 32) | ((U64)((uint8_t)(c)[2]) << 40) | ((U64)((uint8_t)(c)[1]) << 48) | ((U64)((uint8_t)(c)[0]) << 56))
 #define GETBITINDEX(b,i) (POPCOUNT((b) & (((BITSET(i) - 1) << 1) + 1)) - 1)
@@ -917,6 +900,34 @@ void chessposition::nextToBinpack(Binpack* bp)
 
 
 
+// A position to decode sfens and binpacks into
+static chessposition* allocSfenPosition()
+{
+    int rookfiles[2][2] = { { 0 , 7 }, {0 , 7} };
+    int kingfile[2] = { 4, 4 };
+    chessposition* pos = (chessposition*)allocalign64(sizeof(chessposition));
+    pos->pwnhsh.setSize(1);
+    pos->mtrlhsh.init();
+    pos->initCastleRights(rookfiles, kingfile);
+    pos->accumulation = NnueCurrentArch ? NnueCurrentArch->CreateAccumulationStack() : nullptr;
+    pos->psqtAccumulation = NnueCurrentArch ? NnueCurrentArch->CreatePsqtAccumulationStack() : nullptr;
+    pos->resetStats();
+    memset(pos->prerootmovestack, 0xff, sizeof(chessposition::prerootmovestack));
+    memset(pos->movestack, 0, sizeof(chessposition::movestack));
+    pos->prerootmovenum = 0;
+    pos->prerootmovecode[PREROOTMOVES - 1] = 0x00000001; // satisfy 'no nullmove eval available' and 'unused countermove within bounds'
+    return pos;
+}
+
+
+static void freeSfenPosition(chessposition* pos)
+{
+    pos->pwnhsh.remove();
+    pos->mtrlhsh.remove();
+    freealigned64(pos);
+}
+
+
 //
 // Stuff related to generating fens for training
 //
@@ -985,20 +996,231 @@ static void freeBookPositions()
 }
 
 
-static void gensfenthread(searchthread* thr, U64 rndseed)
+//
+// Parallel generation: every thread encodes the positions of its finished games into the
+// chunks of its own queue and the writer thread writes the full chunks to the output file.
+// A chunk changes hands by its state (release/acquire), so the threads don't share a lock.
+// The only shared data is the dedup hash.
+//
+
+const int sfenqueuelength = 4;
+
+enum { CHUNKFREE, CHUNKFULL };
+
+struct sfenchunk
+{
+    char* data;
+    size_t size;
+    U64 positions;
+    atomic<int> state;
+};
+
+struct alignas(64) sfenqueue
+{
+    sfenchunk chunk[sfenqueuelength];
+    int head;                   // chunk the thread is filling
+    int tail;                   // next chunk for the writer
+    atomic<U64> positions;      // positions encoded by the thread
+    U64 stalls;                 // waits for the writer
+    // binpack encoder of the thread
+    char* bpbuffer;
+    char* bpptr;
+    Binpack bp;
+    chessposition* inpos;
+    U64 bppositions;            // positions in bpbuffer
+};
+
+// Dedup hash, a slot holds the full key and is replaced by an atomic exchange
+static atomic<U64>* sfenhash;
+static U64 sfenhashmask;
+
+static sfenqueue* sfenqueues;
+static bool gensfenbinpack;
+static size_t sfenchunkbytes;
+static U64 gensfenseed;
+static atomic<bool> gensfenstop;
+static atomic<bool> gensfenfinished;
+static mutex writermt;
+static condition_variable writercv;
+static mutex stopmt;
+static condition_variable stopcv;
+
+// ostream into the memory of a chunk
+class chunkbuf : public streambuf
+{
+public:
+    chunkbuf(char* p, size_t n) { setp(p, p + n); }
+    size_t size() { return pptr() - pbase(); }
+};
+
+
+// Returns true if the position was not seen before
+static bool sfenhashInsert(U64 key)
+{
+    return sfenhash[key & sfenhashmask].exchange(key, memory_order_relaxed) != key;
+}
+
+
+// Hands the current chunk to the writer and continues with the next one
+static void publishChunk(sfenqueue* q)
+{
+    q->chunk[q->head].state.store(CHUNKFULL, memory_order_release);
+    writercv.notify_one();
+    q->head = (q->head + 1) % sfenqueuelength;
+    sfenchunk* c = &q->chunk[q->head];
+    while (c->state.load(memory_order_acquire) != CHUNKFREE)
+    {
+        q->stalls++;
+        Sleep(1);
+    }
+    c->size = 0;
+    c->positions = 0;
+}
+
+
+static void writeBin(sfenqueue* q, PackedSfenValue* psv)
+{
+    sfenchunk* c = &q->chunk[q->head];
+    memcpy(c->data + c->size, psv, sizeof(PackedSfenValue));
+    c->size += sizeof(PackedSfenValue);
+    if (++c->positions == sfenchunksize)
+        publishChunk(q);
+}
+
+
+static void writeBinpack(sfenqueue* q, PackedSfenValue* psv)
+{
+    Binpack* bp = &q->bp;
+    if (bp->flushAt)
+    {
+        // The last position starts the next chunk
+        sfenchunk* c = &q->chunk[q->head];
+        chunkbuf cb(c->data, sfenchunkbytes);
+        ostream os(&cb);
+        flushBinpack(&os, q->bpbuffer, bp);
+        c->size = cb.size();
+        c->positions = q->bppositions - 1;
+        q->bppositions = 1;
+        publishChunk(q);
+    }
+
+    if (q->bpptr == q->bpbuffer)
+    {
+        // start new chunk
+        strcpy(q->bpptr, "BINP");
+        q->bpptr += 8;
+        bp->fullmove = 0;
+    }
+
+    q->inpos->getFromSfen(&psv->sfen);
+    uint32_t fullmove = rubiFromSf(q->inpos, psv->move);
+    if (!bp->outpos)
+    {
+        bp->outpos = (chessposition*)allocalign64(sizeof(chessposition));
+        q->inpos->copyToLight(bp->outpos);
+        memcpy(bp->outpos->castlerights, q->inpos->castlerights, sizeof(q->inpos->castlerights));
+    }
+
+    bp->lastFullmove = bp->fullmove;
+    bp->fullmove = fullmove;
+    bp->lastScore = -bp->score;
+    bp->score = psv->score;
+    bp->gamePly = psv->gamePly;
+    bp->gameResult = psv->game_result;
+    bp->outpos->nextToBinpack(bp);
+    bp->fullmove = fullmove;
+    q->bppositions++;
+}
+
+
+// Writes the remaining positions of a queue, only called when all threads have finished
+static void flushSfenqueue(sfenqueue* q, ostream* os)
+{
+    for (int i = 0; i < sfenqueuelength; i++)
+    {
+        sfenchunk* c = &q->chunk[(q->tail + i) % sfenqueuelength];
+        if (c->state.load(memory_order_acquire) == CHUNKFULL)
+            os->write(c->data, c->size);
+    }
+    if (gensfenbinpack)
+    {
+        prepareNextBinpackPosition(&q->bp);
+        if (q->bpptr > q->bpbuffer + 8)
+            flushBinpack(os, q->bpbuffer, &q->bp);
+    }
+    else
+    {
+        sfenchunk* c = &q->chunk[q->head];
+        os->write(c->data, c->size);
+    }
+}
+
+
+void flush_psv(int result, searchthread* thr)
+{
+    sfenqueue* q = &sfenqueues[thr->index];
+    for (PackedSfenValue* p = thr->psvbuffer; p < thr->psv; p++)
+    {
+        p->game_result = p->game_result / 2 * result;
+        if (gensfenbinpack)
+            writeBinpack(q, p);
+        else
+            writeBin(q, p);
+    }
+    q->positions.fetch_add(thr->psv - thr->psvbuffer, memory_order_relaxed);
+    thr->psv = thr->psvbuffer;
+}
+
+
+// Writes the full chunks of all threads in the order they get ready and stops the
+// generation when enough positions are encoded
+static void gensfenwriter(ostream* os, U64 loop, U64* written)
+{
+    while (true)
+    {
+        bool idle = true;
+        U64 positions = 0;
+        for (int tnum = 0; tnum < en.Threads; tnum++)
+        {
+            sfenqueue* q = &sfenqueues[tnum];
+            sfenchunk* c = &q->chunk[q->tail];
+            if (c->state.load(memory_order_acquire) == CHUNKFULL)
+            {
+                os->write(c->data, c->size);
+                *written += c->positions;
+                c->state.store(CHUNKFREE, memory_order_release);
+                q->tail = (q->tail + 1) % sfenqueuelength;
+                idle = false;
+            }
+            positions += q->positions.load(memory_order_relaxed);
+        }
+        if (positions >= loop && !gensfenstop)
+        {
+            // wake the main thread which waits for the end of the run
+            lock_guard<mutex> lk(stopmt);
+            gensfenstop = true;
+            stopcv.notify_one();
+        }
+        if (gensfenfinished)
+            return;
+        if (idle)
+        {
+            unique_lock<mutex> lk(writermt);
+            writercv.wait_for(lk, chrono::milliseconds(10));
+        }
+    }
+}
+
+
+static void gensfenthread(searchthread* thr)
 {
     ranctx rnd;
-    U64 key;
-    U64 hash_index;
-    U64 key2;
-    raninit(&rnd, rndseed);
+    raninit(&rnd, gensfenseed ^ ((U64)thr->index << 32));
     chessmovelist movelist;
-    U64 psvnums = 0;
     uint32_t nmc;
     chessposition* pos = &thr->pos;
     pos->resetStats();
     const int depthvariance = max(1, depth2 - depth + 1);
-    thr->totalchunks = 0;
 
     while (true)
     {
@@ -1024,10 +1246,14 @@ static void gensfenthread(searchthread* thr, U64 rndseed)
         for (int i = 0; i < random_opening_ply; ++i)
             random_move_flag[i] = true;
 
-        thr->psv = nullptr;
+        thr->psv = thr->psvbuffer;
 
         for (int ply = 0; ; ++ply)
         {
+            if (gensfenstop)
+                // drop the unfinished game
+                return;
+
             if (ply > maxply) // default: 200; SF: 400
             {
                 if (generate_draw) flush_psv(0, thr);
@@ -1069,48 +1295,21 @@ static void gensfenthread(searchthread* thr, U64 rndseed)
                 break;
             }
 
-            // Skip first plies
-            if (ply < write_minply - 1) // default: 16
-                goto SKIP_SAVE;
-
-            // Skip position already in hash table
-            key = pos->hash;
-            hash_index = key & (GENSFEN_HASH_SIZE - 1);
-            key2 = sfenhash[hash_index];
-            if (key == key2)
-                goto SKIP_SAVE;
-
-            sfenhash[hash_index] = key; // Replace with the current key.
-
-            // generate sfen and values
-            thr->psv = thr->psvbuffer + psvnums;
-            pos->toSfen(&thr->psv->sfen);
-            thr->psv->score = score;
-            thr->psv->gamePly = ply;
-            thr->psv->move = sfFromRubi(pos->pvtable[0][0]);
-            thr->psv->game_result = 2 * S2MSIGN(pos->state & S2MMASK); // not yet known
-            thr->psv->padding = 0xff;
-
-            if (thr->psv->move)
+            // Skip first plies and positions already in hash table
+            if (ply >= write_minply - 1 && sfenhashInsert(pos->hash)) // default: 16
             {
-                psvnums++;
-
-                if (psvnums % sfenchunksize == 0)
-                {
-                    thr->totalchunks++;
-                    int thischunk = (int)(psvnums / sfenchunksize - 1);
-                    int nextchunk = (thischunk + 1) % sfenchunknums;
-                    while (thr->chunkstate[nextchunk] != CHUNKFREE)
-                    {
-                        printf("\rThread %d waiting for main thread...", thr->index);
-                        Sleep(100);
-                    }
-                    thr->chunkstate[nextchunk] = CHUNKINUSE;
-                    psvnums = psvnums % (sfenchunknums * sfenchunksize);
-                }
+                // generate sfen and values
+                PackedSfenValue* psv = thr->psv;
+                pos->toSfen(&psv->sfen);
+                psv->score = score;
+                psv->gamePly = ply;
+                psv->move = sfFromRubi(pos->pvtable[0][0]);
+                psv->game_result = 2 * S2MSIGN(pos->state & S2MMASK); // not yet known
+                psv->padding = 0xff;
+                if (psv->move)
+                    thr->psv++;
             }
 
-SKIP_SAVE:
             // preset move for next ply with the pv move
             nmc = pos->pvtable[0][0];
             if (!nmc)
@@ -1172,10 +1371,12 @@ SKIP_SAVE:
 }
 
 
-void gensfen(vector<string> args)
+U64 rubichess::gensfen(vector<string> args, U64* elapsedms)
 {
     U64 loop = 10000;
     string outputfile = "sfens.bin";
+    string outputformat = "";
+    size_t sfenhash_mb = 128;
     size_t cs = args.size();
     size_t ci = 0;
 
@@ -1188,9 +1389,13 @@ void gensfen(vector<string> args)
         if (cmd == "depth2" && ci < cs)
             depth2 = stoi(args[ci++]);
         if (cmd == "loop" && ci < cs)
-            loop = stoi(args[ci++]);
+            loop = stoull(args[ci++]);
         if (cmd == "output_file_name" && ci < cs)
             outputfile = args[ci++];
+        if (cmd == "output_format" && ci < cs)
+            outputformat = args[ci++];
+        if (cmd == "sfenhash_mb" && ci < cs)
+            sfenhash_mb = stoi(args[ci++]);
         if (cmd == "random_multi_pv" && ci < cs)
             random_multi_pv = stoi(args[ci++]);
         if (cmd == "random_multi_pv_depth" && ci < cs)
@@ -1213,9 +1418,14 @@ void gensfen(vector<string> args)
 
     int tnum;
     gensfenstop = false;
+    gensfenfinished = false;
+    if (outputformat == "")
+        outputformat = (outputfile.find(".binpack") != string::npos ? "binpack" : "bin");
+    gensfenbinpack = (outputformat == "binpack");
 
     cout << "Generating sfnes with these parameters:\n";
     cout << "output_file_name:      " << outputfile << "\n";
+    cout << "output_format:         " << outputformat << "\n";
     cout << "loop:                  " << loop << "\n";
     cout << "depth:                 " << depth << "\n";
     cout << "depth2:                " << depth2 << "\n";
@@ -1233,121 +1443,128 @@ void gensfen(vector<string> args)
     cout << "random_multi_pv_diff:  " << random_multi_pv_diff << "\n";
     cout << "disable_prune:         " << disable_prune << "\n";
     cout << "book:                  " << book << "\n";
+    cout << "sfenhash_mb:           " << sfenhash_mb << "\n";
+    cout << "threads:               " << en.Threads << "\n";
 
-    // create full chunks but ensure at least loop positions
-    const unsigned int chunksneeded = (unsigned int)((loop - 1) / sfenchunksize) + 1;
     ofstream os(outputfile, ios::binary | fstream::app);
     if (!os)
     {
         cout << "Cannot open file " << outputfile << "\n";
-        return;
+        return 0;
     }
 
     if (!en.chess960 && !getBookPositions())
-        return;
-
+        return 0;
+
+    // dedup hash with a power of two number of slots
+    int msb;
+    U64 slots = max(sfenhash_mb, (size_t)1) * 1024 * 1024 / sizeof(U64);
+    GETMSB(msb, slots);
+    size_t hashsize = (size_t)1 << msb;
+    sfenhashmask = hashsize - 1;
+    sfenhash = (atomic<U64>*)allocalign64(hashsize * sizeof(atomic<U64>));
+    for (size_t i = 0; i < hashsize; i++)
+        sfenhash[i].store(0, memory_order_relaxed);
+
+    maxContinuationSize = 10 * 1024;
+    sfenchunkbytes = (gensfenbinpack ? maxBinpackChunkSize + 2 * maxContinuationSize : sfenchunksize * sizeof(PackedSfenValue));
+    sfenqueues = new sfenqueue[en.Threads]();
+    gensfenseed = getTime() ^ zb.getRnd();
     for (tnum = 0; tnum < en.Threads; tnum++)
     {
+        sfenqueue* q = &sfenqueues[tnum];
+        for (int i = 0; i < sfenqueuelength; i++)
+            q->chunk[i].data = (char*)allocalign64(sfenchunkbytes);
+        if (gensfenbinpack)
+        {
+            q->bpptr = q->bpbuffer = (char*)allocalign64(maxBinpackChunkSize + 2 * maxContinuationSize);
+            q->inpos = allocSfenPosition();
+            q->bp.base = q->bpbuffer;
+            q->bp.data = &q->bpptr;
+            q->bp.inpos = q->inpos;
+            q->bp.outpos = nullptr;
+        }
         en.sthread[tnum].index = tnum;
-        en.sthread[tnum].chunkstate[0] = CHUNKINUSE;
-        en.sthread[tnum].chunkstate[1] = CHUNKFREE;
-        en.sthread[tnum].psvbuffer = (PackedSfenValue*)allocalign64(sfenchunknums * sfenchunksize * sizeof(PackedSfenValue));
-        en.sthread[tnum].thr = thread(&gensfenthread, &en.sthread[tnum], getTime() ^ zb.getRnd() );
+        en.sthread[tnum].psvbuffer = (PackedSfenValue*)allocalign64(((size_t)maxply + 2) * sizeof(PackedSfenValue));
     }
 
-    U64 chunkswritten = 0;
-    tnum = 0;
-    const int charsperline = 100;
+    U64 written = 0;
+    thread writer(&gensfenwriter, &os, loop, &written);
     U64 starttime = getTime();
-    string sProgress(charsperline,'.');
-    cout << "\r  ?h??m??s |" << sProgress << "|";
-    const double dotsperthread = (double)charsperline / en.Threads;
-    const double chunksperthread = (double)chunksneeded / en.Threads;
-    const char finedotchar[] = { '-', '\\', '|', '/', 'X'};
-    bool showPps = false;
-    U64 lastSwitch = starttime;
-    const int minShowSec = 30;
-    while (chunkswritten < chunksneeded)
+    for (tnum = 0; tnum < en.Threads; tnum++)
+        en.sthread[tnum].startSearching(gensfenthread);
+
+    const int charsperline = 50;
+    while (true)
     {
-        searchthread* thr = &en.sthread[tnum];
-        Sleep(100);
-        for (int i = 0; i < sfenchunknums; i++)
         {
-            if (thr->chunkstate[i] == CHUNKFULL)
-            {
-                os.write((char*)(thr->psvbuffer + i * sfenchunksize), sfenchunksize * sizeof(PackedSfenValue));
-                chunkswritten++;
-                thr->chunkstate[i] = CHUNKFREE;
-                // Update progress
-                U64 now = getTime();
-                stringstream ss;
-                if (showPps)
-                {
-                    int pps = ((now - starttime) < en.frequency) ? 0 : (int)((chunkswritten * sfenchunksize) / (int)((now - starttime) / en.frequency));
-                    ss << setfill(' ') << setw(7) << pps << "pps";
-                }
-                else {
-                    U64 totaltime = max(now - starttime, (now - starttime) / chunkswritten * chunksneeded);
-                    U64 remainingsecs = (totaltime + starttime - now) / en.frequency;
-                    ss  << setfill(' ') << setw(3) << (remainingsecs / (60 * 60)) << "h"
-                        << setfill('0') << setw(2) << (remainingsecs / 60) % 60 << "m"
-                        << setfill('0') << setw(2) << remainingsecs % 60 << "s";
-                }
-                if ((now - lastSwitch) / en.frequency > minShowSec)
-                {
-                    // Switch display
-                    showPps = !showPps;
-                    lastSwitch = now;
-                }
-
-                int firstdot = (int)round((double)thr->index * dotsperthread);
-                int lastdot = (int)round((double)(thr->index + 1) * dotsperthread) - 1;
-                int numdots = lastdot - firstdot + 1;
-                int previousdot = min(charsperline - 1, firstdot + (int)round((double)(thr->totalchunks - 1) * numdots / chunksperthread));
-                int currentdot = firstdot + (int)round(thr->totalchunks * numdots / chunksperthread);
-                for (int c = previousdot; c < currentdot; c++)
-                    sProgress[c] = finedotchar[4];
-                sProgress[currentdot] = finedotchar[thr->totalchunks % 4];
-                cout << "\r" << ss.str() << " |" << sProgress << "|";
-            }
+            // progress every 500ms, but return as soon as the writer has seen all positions
+            unique_lock<mutex> lk(stopmt);
+            if (stopcv.wait_for(lk, chrono::milliseconds(500), [] { return gensfenstop.load(); }))
+                break;
         }
-        tnum = (tnum + 1) % en.Threads;
+        U64 positions = 0;
+        for (tnum = 0; tnum < en.Threads; tnum++)
+            positions += sfenqueues[tnum].positions.load(memory_order_relaxed);
+        U64 now = getTime();
+        U64 pps = positions * en.frequency / max(now - starttime, (U64)1);
+        U64 remainingsecs = (pps && positions < loop) ? (loop - positions) / pps : 0;
+        int dots = (int)min((U64)charsperline, positions * charsperline / loop);
+        stringstream ss;
+        ss  << setfill(' ') << setw(3) << (remainingsecs / (60 * 60)) << "h"
+            << setfill('0') << setw(2) << (remainingsecs / 60) % 60 << "m"
+            << setfill('0') << setw(2) << remainingsecs % 60 << "s |"
+            << string(dots, 'X') << string(charsperline - dots, '.') << "| "
+            << setfill(' ') << setw(7) << pps << "pps";
+        cout << "\r" << ss.str() << flush;
     }
-    gensfenstop = true;
+
+    for (tnum = 0; tnum < en.Threads; tnum++)
+        en.sthread[tnum].waitForSearchFinished();
+    gensfenfinished = true;
+    writercv.notify_one();
+    writer.join();
+    U64 elapsed = max(getTime() - starttime, (U64)1);
+
+    // the unfinished chunks
+    U64 positions = 0;
+    U64 stalls = 0;
     for (tnum = 0; tnum < en.Threads; tnum++)
     {
-        if (en.sthread[tnum].thr.joinable())
-            en.sthread[tnum].thr.join();
+        sfenqueue* q = &sfenqueues[tnum];
+        flushSfenqueue(q, &os);
+        positions += q->positions;
+        stalls += q->stalls;
     }
-    cout << "\n\ngensfen finished.\n";
+    os.close();
+    if (elapsedms)
+        *elapsedms = elapsed * 1000 / en.frequency;
+
+    cout << "\n\ngensfen finished. " << positions << " positions in " << elapsed * 1000 / en.frequency << " ms ("
+        << positions * en.frequency / elapsed << "pps), waits for the writer: " << stalls << "\n";
     en.MultiPV = old_multipv;
 
     freeBookPositions();
     for (tnum = 0; tnum < en.Threads; tnum++)
+    {
+        sfenqueue* q = &sfenqueues[tnum];
+        for (int i = 0; i < sfenqueuelength; i++)
+            freealigned64(q->chunk[i].data);
+        if (gensfenbinpack)
+        {
+            freealigned64(q->bpbuffer);
+            freeSfenPosition(q->inpos);
+            freealigned64(q->bp.outpos);
+        }
         freealigned64(en.sthread[tnum].psvbuffer);
-}
-
-
-static void flushBinpack(ostream *os, char *buffer, Binpack* bp)
-{
-    size_t size = *bp->data - buffer;   // default: copy everything up to the end
-    if (bp->flushAt) {
-        // buffer full, flushAt is the cutting point
-        size = bp->flushAt - buffer;
     }
+    delete[] sfenqueues;
+    freealigned64(sfenhash);
 
-    *((uint32_t*)(buffer + 4)) = (uint32_t)size - 8;
-    os->write(buffer, size);
-    if (bp->flushAt) {
-        size_t wrappedbytes = *bp->data - bp->flushAt;
-        memcpy(buffer + 8, bp->flushAt, wrappedbytes + 1);
-        *bp->data -= size - 8;
-        if (wrappedbytes)
-            bp->compmvsptr -= size - 8;
-        bp->flushAt = nullptr;
-    }
+    return positions;
 }
 
+
 enum SfenFormat { no, bin, binpack, plain };
 
 struct conversion_t {
@@ -1433,30 +1650,16 @@ public:
 
 sfenreader::sfenreader()
 {
-    int rookfiles[2][2] = { { 0 , 7 }, {0 , 7} };
-    int kingfile[2] = { 4, 4 };
     memset((void*)&inbp, 0, sizeof(inbp));
-    pos = (chessposition*)allocalign64(sizeof(chessposition));
-    pos->pwnhsh.setSize(1);
-    pos->mtrlhsh.init();
-    pos->initCastleRights(rookfiles, kingfile);
-    pos->accumulation = NnueCurrentArch ? NnueCurrentArch->CreateAccumulationStack() : nullptr;
-    pos->psqtAccumulation = NnueCurrentArch ? NnueCurrentArch->CreatePsqtAccumulationStack() : nullptr;
-    pos->resetStats();
-    memset(pos->prerootmovestack, 0xff, sizeof(chessposition::prerootmovestack));
-    memset(pos->movestack, 0, sizeof(chessposition::movestack));
-    pos->prerootmovenum = 0;
-    pos->prerootmovecode[PREROOTMOVES - 1] = 0x00000001; // satisfy 'no nullmove eval available' and 'unused countermove within bounds'
+    pos = allocSfenPosition();
     inbuffer = nullptr;
 }
 
 
 sfenreader::~sfenreader()
 {
-    pos->pwnhsh.remove();
-    pos->mtrlhsh.remove();
+    freeSfenPosition(pos);
     freealigned64(inbuffer);
-    freealigned64(pos);
 }
 
 
@@ -1824,7 +2027,7 @@ static void convertthread(searchthread* thr, conversion_t* cv)
 }
 
 
-void convert(vector<string> args)
+void rubichess::convert(vector<string> args)
 {
     string inputfile;
     string comparefile = "";
@@ -1942,6 +2145,7 @@ void convert(vector<string> args)
     while (threadsToStop)
     {
         Sleep(100);
+#ifdef _WIN32
         if (_kbhit())
         {
             char c = _getch();
@@ -1950,6 +2154,7 @@ void convert(vector<string> args)
                 cerr << "Stopping after current chunks";
             }
         }
+#endif
         for (int tnum = 0; tnum < en.Threads; tnum++)
         {
             if (en.sthread[tnum].index < 0 && en.sthread[tnum].thr.joinable())
@@ -1977,7 +2182,7 @@ void convert(vector<string> args)
 
 
 
-void learn(vector<string> args)
+void rubichess::learn(vector<string> args)
 {
     size_t cs = args.size();
     size_t ci = 0;
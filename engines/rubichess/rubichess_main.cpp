@@ -19,7 +19,7 @@
 #include "rubichess_RubiChess.h"
 
 // Add by BanksiaGUI
-#include "engineids.h"
+#include "engines-bridging-header.h"
 void engine_message(int eid, const std::string& s);
 
 using namespace rubichess;
@@ -913,6 +913,17 @@ void rubichess_uci_cmd(const char* str)
     en.communicate(str);
 }
 
+void rubichess_searchStats(EngineSearchStats* stats)
+{
+    U64 nodes, tbhits, probes, hits;
+    en.getNodesAndTbhits(&nodes, &tbhits);
+    en.getTtStats(&probes, &hits);
+    stats->nodes = nodes;
+    stats->hashProbes = probes;
+    stats->hashHits = hits;
+    stats->tbHits = tbhits;
+}
+
 //int _main(int argc, char* argv[])
 //{
 //    int startnum;
@@ -764,6 +764,9 @@ bool chessposition::playMove(uint32_t mc)
         hash ^= zb.cstl[oldcastle];
 
         PREFETCH(&tp.table[hash & tp.sizemask]);
+        // The classical evaluation probes the pawn hash next; the material hash is small enough to stay cached
+        if (!NnueReady && pawnhash != movestack[ply].pawnhash)
+            pwnhsh.prefetch(pawnhash);
 
         conthistptr[ply] = (int16_t*)counterhistory[GETPIECE(mc)][GETCORRECTTO(mc)];
         myassert(piececount == POPCOUNT(occupied00[WHITE] | occupied00[BLACK]), this, 1, piececount);
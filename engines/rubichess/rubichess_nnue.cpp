@@ -24,6 +24,12 @@
 
 #include "rubichess_RubiChess.h"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
 using namespace rubichess;
 
 //
@@ -620,12 +626,8 @@ inline  ft_vec_t vec_msb_pack_16(ft_vec_t a, ft_vec_t b) {
 static const uint32_t NnzMask[4] = { 1, 2, 4, 8 };
 #define vec_nnz(a) vaddvq_u32(vandq_u32(vtstq_u32(a, a), vld1q_u32(NnzMask)))
 #define vec_set_32(a) vreinterpretq_s8_u32(vdupq_n_u32(a))
-#ifdef USE_DOTPROD // FIXME: waits to be implemented
-#define vec_add_dpbusd_32 Simd::dotprod_m128_add_dpbusd_32
-#else
 #define vec_add_dpbusd_32 Simd::neon_m128_add_dpbusd_32
 #endif
-#endif
 
 
 #else
@@ -675,10 +677,52 @@ alignas(64) static const array<array<uint16_t, 8>, 256> lookup_indices = []() {
 }();
 #endif
 
+// The dot product kernel of the big layer with the NEON weight layout, the other
+// kernels for instruction sets above the build are engine independent (simdkernels.h)
+#ifdef USE_RUNTIMEDOTPROD
+#if defined(__clang_major__)
+#define TARGET_DOTPROD __attribute__((target("dotprod")))
+#else
+#define TARGET_DOTPROD __attribute__((target("+dotprod")))
+#endif
+
+#ifdef USE_PROPAGATEBIG
+// Big layer with the NEON weight layout: the two 8 byte blocks of an output are joined for one sdot
+template <unsigned int NumBigBlocks, unsigned int NumOutputRegsBig, unsigned int NumSmallBlocksPerOutput>
+TARGET_DOTPROD
+static void BigLayerDotprod(const clipped_t* input, const weight_t* weight, const int32_t* bias, int32_t* output)
+{
+    constexpr unsigned int SmallBlockSize = 8;
+    constexpr unsigned int BigBlockSize = NumOutputRegsBig * NumSmallBlocksPerOutput * SmallBlockSize;
+    for (unsigned int bigBlock = 0; bigBlock < NumBigBlocks; ++bigBlock)
+    {
+        int32x4_t acc[NumOutputRegsBig];
+        for (unsigned int k = 0; k < NumOutputRegsBig; ++k)
+            acc[k] = vdupq_n_s32(0);
+
+        for (unsigned int smallBlock = 0; smallBlock < NumSmallBlocksPerOutput; smallBlock += 2)
+        {
+            const int8_t* w = weight + bigBlock * BigBlockSize + smallBlock * SmallBlockSize * NumOutputRegsBig;
+            const int8x16_t in = vld1q_s8(input + smallBlock * SmallBlockSize);
+            for (unsigned int k = 0; k < NumOutputRegsBig; ++k)
+                acc[k] = vdotq_s32(acc[k], in, vcombine_s8(vld1_s8(w + k * SmallBlockSize), vld1_s8(w + (k + NumOutputRegsBig) * SmallBlockSize)));
+        }
+
+        for (unsigned int k = 0; k < NumOutputRegsBig; ++k)
+        {
+            const unsigned int idx = bigBlock * NumOutputRegsBig + k;
+            output[idx] = vaddvq_s32(acc[k]) + bias[idx];
+        }
+    }
+}
+#endif
+#endif
+
 
 template <NnueType Nt, Color c, unsigned int NnueFtHalfdims, unsigned int NnuePsqtBuckets> void chessposition::UpdateAccumulator()
 {
     STATISTICSINC(nnue_accupdate_all);
+    COUNTERINC(nnue_accupdate_all);
 
     int16_t* weight = NnueCurrentArch->GetFeatureWeight();
     int16_t* bias = NnueCurrentArch->GetFeatureBias();
@@ -709,10 +753,12 @@ template <NnueType Nt, Color c, unsigned int NnueFtHalfdims, unsigned int NnuePs
     {
         if (mslast == ply) {
             STATISTICSINC(nnue_accupdate_cache);
+            COUNTERINC(nnue_accupdate_cache);
             return;
         }
 
         STATISTICSINC(nnue_accupdate_inc);
+        COUNTERINC(nnue_accupdate_inc);
         NnueIndexList removedIndices[2], addedIndices[2];
         removedIndices[0].size = removedIndices[1].size = 0;
         addedIndices[0].size = addedIndices[1].size = 0;
@@ -725,6 +771,32 @@ template <NnueType Nt, Color c, unsigned int NnueFtHalfdims, unsigned int NnuePs
 
         int pos2update[3] = { mslast + 1, mslast + 1 == ply ? -1 : ply, -1 };
 
+        // Kernel for a wider instruction set than the build
+        if (auto updateAccumulator = simd_kernels()->updateAccumulator)
+        {
+            SimdAccumulatorUpdate updates[2];
+            unsigned int count = 0;
+            for (; pos2update[count] >= 0; count++)
+                updates[count] = { accumulation + (pos2update[count] * 2 + c) * NnueFtHalfdims,
+                                   removedIndices[count].values, (unsigned int)removedIndices[count].size,
+                                   addedIndices[count].values, (unsigned int)addedIndices[count].size };
+            updateAccumulator(accumulation + (mslast * 2 + c) * NnueFtHalfdims, weight, NnueFtHalfdims, updates, count);
+
+            for (unsigned int l = 0; l < count; l++)
+            {
+                int32_t* psqtacm = psqtAccumulation + (pos2update[l] * 2 + c) * NnuePsqtBuckets;
+                memcpy(psqtacm, psqtAccumulation + (mslast * 2 + c) * NnuePsqtBuckets, NnuePsqtBuckets * sizeof(int32_t));
+                mslast = pos2update[l];
+                for (unsigned int k = 0; k < removedIndices[l].size; k++)
+                    for (unsigned int i = 0; i < NnuePsqtBuckets; i++)
+                        psqtacm[i] -= psqtweight[removedIndices[l].values[k] * NnuePsqtBuckets + i];
+                for (unsigned int k = 0; k < addedIndices[l].size; k++)
+                    for (unsigned int i = 0; i < NnuePsqtBuckets; i++)
+                        psqtacm[i] += psqtweight[addedIndices[l].values[k] * NnuePsqtBuckets + i];
+            }
+            return;
+        }
+
 #ifdef USE_SIMD
         for (unsigned int i = 0; i < NnueFtHalfdims / tileHeight; i++)
         {
@@ -834,12 +906,26 @@ template <NnueType Nt, Color c, unsigned int NnueFtHalfdims, unsigned int NnuePs
     else {
         // Full update needed
         STATISTICSINC(nnue_accupdate_full);
+        COUNTERINC(nnue_accupdate_full);
         computationState[ply][c] = true;
         int16_t* acm = accumulation + (ply * 2 + c) * NnueFtHalfdims;
         int32_t* psqtacm = psqtAccumulation + (ply * 2 + c) * NnuePsqtBuckets;
         NnueIndexList activeIndices;
         activeIndices.size = 0;
         HalfkpAppendActiveIndices<Nt, c>(&activeIndices);
+
+        if (auto updateAccumulator = simd_kernels()->updateAccumulator)
+        {
+            const SimdAccumulatorUpdate update = { acm, nullptr, 0, activeIndices.values, (unsigned int)activeIndices.size };
+            updateAccumulator(bias, weight, NnueFtHalfdims, &update, 1);
+
+            memset(psqtacm, 0, NnuePsqtBuckets * sizeof(int32_t));
+            for (unsigned int k = 0; k < activeIndices.size; k++)
+                for (unsigned int i = 0; i < NnuePsqtBuckets; i++)
+                    psqtacm[i] += psqtweight[activeIndices.values[k] * NnuePsqtBuckets + i];
+            return;
+        }
+
 #ifdef USE_SIMD
         for (unsigned int i = 0; i < NnueFtHalfdims / tileHeight; i++)
         {
@@ -934,11 +1020,24 @@ int chessposition::Transform(clipped_t *output, int bucket)
     int32_t* psqtacm = psqtAccumulation + ply * 2 * NnuePsqtBuckets;
 
     const int perspectives[2] = { state & S2MMASK, !(state & S2MMASK) };
+#ifndef USE_FASTSSE2
+    const auto clippedProduct = simd_kernels()->clippedProduct;
+#endif
     for (int p = 0; p < 2; p++)
     {
         const unsigned int offset = (Nt == NnueArchV1 ? NnueFtHalfdims * p : NnueFtHalfdims / 2 * p);
 
 
+#ifndef USE_FASTSSE2
+        // Kernel for a wider instruction set than the build
+        if (Nt == NnueArchV5 && clippedProduct)
+        {
+            clippedProduct(acm + perspectives[p] * NnueFtHalfdims, acm + perspectives[p] * NnueFtHalfdims + NnueFtHalfdims / 2,
+                           (uint8_t*)&output[offset], NnueFtHalfdims / 2);
+            continue;
+        }
+#endif
+
 #ifdef USE_SIMD
         if (Nt == NnueArchV5)
         {
@@ -1096,24 +1195,38 @@ bool NnueFeatureTransformer<ftdims, inputdims, psqtbuckets>::ReadFeatureWeights(
     int i;
     bool okay = true;
 
-    int16_t* src_16 = (int16_t*)calloc(inputdims * ftdims, sizeof(int16_t));
-    int32_t* src_32 = (int32_t*)calloc(inputdims * psqtbuckets, sizeof(int32_t));
-    if (!src_16 || !src_32)
+    if (nr->native) {
+        // The weights are used in place, the buffer now lives as long as this network
+        nr->handOver(&storage);
+        bias = (int16_t*)nr->map(ftdims * sizeof(int16_t));
+        weight = (int16_t*)nr->map((size_t)inputdims * ftdims * sizeof(int16_t));
+        psqtWeights = (int32_t*)nr->map((size_t)inputdims * psqtbuckets * sizeof(int32_t));
+        return (bias && weight && psqtWeights);
+    }
+
+    storage.close();
+    storage.readbuffersize = MULTIPLEOFN(ftdims * sizeof(int16_t), NNUENATIVEALIGN)
+        + MULTIPLEOFN((size_t)inputdims * ftdims * sizeof(int16_t), NNUENATIVEALIGN)
+        + MULTIPLEOFN((size_t)inputdims * psqtbuckets * sizeof(int32_t), NNUENATIVEALIGN);
+    storage.readbuffer = (unsigned char*)allocalign64(storage.readbuffersize);
+    if (!storage.readbuffer)
         return false;
+    storage.next = storage.readbuffer;
+    bias = (int16_t*)storage.map(ftdims * sizeof(int16_t));
+    weight = (int16_t*)storage.map((size_t)inputdims * ftdims * sizeof(int16_t));
+    psqtWeights = (int32_t*)storage.map((size_t)inputdims * psqtbuckets * sizeof(int32_t));
 
     // read bias
     bool isLeb128 = testLeb128(nr);
     if (isLeb128)
-        okay = okay && readLeb128(nr, src_16, ftdims);
+        okay = okay && readLeb128(nr, bias, ftdims);
     else
-        okay = okay && nr->read((unsigned char*)src_16, ftdims * sizeof(int16_t));
-
-    memcpy(bias, src_16, ftdims * sizeof(int16_t));
+        okay = okay && nr->read((unsigned char*)bias, ftdims * sizeof(int16_t));
 
     // read weights
     isLeb128 = testLeb128(nr);
     if (isLeb128) {
-        okay = okay && readLeb128(nr, src_16, inputdims * ftdims);
+        okay = okay && readLeb128(nr, weight, inputdims * ftdims);
     }
     else {
         // Handle bpz
@@ -1122,24 +1235,18 @@ bool NnueFeatureTransformer<ftdims, inputdims, psqtbuckets>::ReadFeatureWeights(
         for (i = 0; i < inputdims; i++) {
             if (bpz && i % (10 * 64) == 0)
                 okay = okay && nr->read((unsigned char*)dummyweight, ftdims * sizeof(int16_t));
-            okay = okay && nr->read((unsigned char*)(src_16 + weightsRead), ftdims * sizeof(int16_t));
+            okay = okay && nr->read((unsigned char*)(weight + weightsRead), ftdims * sizeof(int16_t));
             weightsRead += ftdims;
         }
     }
-    
-    memcpy(weight, src_16, inputdims * ftdims * sizeof(int16_t));
 
     // read psqt weights
     isLeb128 = testLeb128(nr);
     if (isLeb128)
-        okay = okay && readLeb128(nr, src_32, inputdims * psqtbuckets);
+        okay = okay && readLeb128(nr, psqtWeights, inputdims * psqtbuckets);
     else
-        okay = okay && nr->read((unsigned char*)src_32, inputdims * psqtbuckets * sizeof(int32_t));
+        okay = okay && nr->read((unsigned char*)psqtWeights, inputdims * psqtbuckets * sizeof(int32_t));
 
-    memcpy(psqtWeights, src_32, inputdims * psqtbuckets * sizeof(int32_t));
-
-    free(src_16);
-    free(src_32);
     return okay;
 }
 
@@ -1188,7 +1295,12 @@ bool writeLeb128(NnueNetsource* nr, IntType* in, size_t count)
 template <int ftdims, int inputdims, int psqtbuckets>
 void NnueFeatureTransformer<ftdims, inputdims, psqtbuckets>::WriteFeatureWeights(NnueNetsource* nr, bool leb128)
 {
-    if (leb128) {
+    if (nr->native) {
+        nr->writeAligned((unsigned char*)bias, ftdims * sizeof(int16_t));
+        nr->writeAligned((unsigned char*)weight, (size_t)inputdims * ftdims * sizeof(int16_t));
+        nr->writeAligned((unsigned char*)psqtWeights, (size_t)inputdims * psqtbuckets * sizeof(int32_t));
+    }
+    else if (leb128) {
         writeLeb128(nr, bias, ftdims);
         writeLeb128(nr, weight, inputdims * ftdims);
         writeLeb128(nr, psqtWeights, inputdims * psqtbuckets);
@@ -1213,6 +1325,10 @@ bool NnueNetworkLayer<inputdims, outputdims>::ReadWeights(NnueNetsource* nr)
     if (previous)
         okay = previous->ReadWeights(nr);
 
+    if (nr->native)
+        // already shuffled
+        return okay && nr->read((unsigned char*)bias, sizeof(bias)) && nr->read((unsigned char*)weight, sizeof(weight));
+
     for (unsigned int i = 0; i < outputdims; ++i)
         okay = okay && nr->read((unsigned char*)&bias[i], sizeof(int32_t));
 
@@ -1330,6 +1446,12 @@ void NnueNetworkLayer<inputdims, outputdims>::WriteWeights(NnueNetsource* nr)
     if (previous)
         previous->WriteWeights(nr);
 
+    if (nr->native) {
+        nr->write((unsigned char*)bias, sizeof(bias));
+        nr->write((unsigned char*)weight, sizeof(weight));
+        return;
+    }
+
     for (unsigned int i = 0; i < outputdims; ++i)
         nr->write((unsigned char*)&bias[i], sizeof(int32_t));
 
@@ -1422,6 +1544,13 @@ template <unsigned int inputdims, unsigned int outputdims>
 inline void NnueNetworkLayer<inputdims, outputdims>::PropagateBigLayer(clipped_t* input, int32_t* output)
 {
     // Big Layer fast propagation
+#ifdef USE_RUNTIMEDOTPROD
+    if (simd_level() == SimdDotprod)
+    {
+        BigLayerDotprod<NumBigBlocks, NumOutputRegsBig, NumSmallBlocksPerOutput>(input, weight, bias, output);
+        return;
+    }
+#endif
     const in_vec_t* invec = (in_vec_t*)input;
     for (unsigned int bigBlock = 0; bigBlock < NumBigBlocks; ++bigBlock)
     {
@@ -1522,6 +1651,11 @@ inline void NnueNetworkLayer<inputdims, outputdims>::PropagateSparse(clipped_t*
     total_count += count;
 #endif
 
+    // Kernel for a wider instruction set than the build
+    if (auto sparseDot = simd_kernels()->sparseDot)
+        if (sparseDot(bias, input32, nnz, count, weight, outputdims, output))
+            return;
+
 #ifdef NNUEDEBUG
     cout << "\nSparse propagation:\n";
 #endif
@@ -1798,11 +1932,37 @@ void NnueInit()
 void NnueRemove()
 {
     if (NnueCurrentArch) {
+        NnueCurrentArch->~NnueArchitecture();
         freealigned64(NnueCurrentArch);
         NnueCurrentArch = nullptr;
     }
 }
 
+// Architecture V5 with the feature transformer size of a native network, nullptr for an unknown size
+static NnueArchitecture* NnueNewArchitectureV5(uint32_t ftdims)
+{
+    char* buffer;
+    switch (ftdims) {
+    case 512:
+        buffer = (char*)allocalign64(sizeof(NnueArchitectureV5<512>));
+        return new(buffer) NnueArchitectureV5<512>;
+    case 768:
+        buffer = (char*)allocalign64(sizeof(NnueArchitectureV5<768>));
+        return new(buffer) NnueArchitectureV5<768>;
+    case 1024:
+        buffer = (char*)allocalign64(sizeof(NnueArchitectureV5<1024>));
+        return new(buffer) NnueArchitectureV5<1024>;
+    case 1536:
+        buffer = (char*)allocalign64(sizeof(NnueArchitectureV5<1536>));
+        return new(buffer) NnueArchitectureV5<1536>;
+    case 2048:
+        buffer = (char*)allocalign64(sizeof(NnueArchitectureV5<2048>));
+        return new(buffer) NnueArchitectureV5<2048>;
+    default:
+        return nullptr;
+    }
+}
+
 bool NnueReadNet(NnueNetsource* nr)
 {
     NnueType oldnt = NnueReady;
@@ -1813,7 +1973,7 @@ bool NnueReadNet(NnueNetsource* nr)
 
     NnueRemove();
 
-    uint32_t version, hash, fthash, nethash, filehash, size;
+    uint32_t version, hash, fthash, nethash, filehash, size, ftdims = 0, layout;
     string sarchitecture;
 
     if (!nr->read((unsigned char*)&version, sizeof(uint32_t))
@@ -1827,6 +1987,25 @@ bool NnueReadNet(NnueNetsource* nr)
 
     size_t remainingfilesize = nr->readbuffersize - (nr->next - nr->readbuffer);
 
+    nr->native = (version == NNUEFILEVERSIONNATIVE);
+    if (nr->native) {
+        // Native networks store the version of the original format and the feature transformer size
+        if (!nr->read((unsigned char*)&version, sizeof(uint32_t))
+            || !nr->read((unsigned char*)&ftdims, sizeof(uint32_t))
+            || !nr->read((unsigned char*)&layout, sizeof(uint32_t)))
+            return false;
+        if (layout != NNUENATIVELAYOUT) {
+            guiCom << "info string The native network was exported by a build with another weight layout. Export it again with this build.\n";
+            return false;
+        }
+        // V1 has one size, V5 ones are mapped below
+        if ((version == NNUEFILEVERSIONROTATE || version == NNUEFILEVERSIONNOBPZ)
+            && ftdims != NnueArchitectureV1::NnueFtOutputdims) {
+            guiCom << "info string Unknown feature transformer size " + to_string(ftdims) + " of the native network.\n";
+            return false;
+        }
+    }
+
     NnueType nt;
     bool bpz;
     int leb128dim = 0;
@@ -1849,6 +2028,14 @@ bool NnueReadNet(NnueNetsource* nr)
     case NNUEFILEVERSIONSFNNv5_1024:
         nt = NnueArchV5;
         bpz = false;
+        if (nr->native) {
+            // The size is stored, no guessing from the file size or the hash
+            if (!(NnueCurrentArch = NnueNewArchitectureV5(ftdims))) {
+                guiCom << "info string Unknown feature transformer size " + to_string(ftdims) + " of the native network.\n";
+                return false;
+            }
+            break;
+        }
         switch (remainingfilesize) {
         case NnueArchitectureV5<512>::networkfilesize:
             buffer = (char*)allocalign64(sizeof(NnueArchitectureV5<512>));
@@ -1987,12 +2174,17 @@ void NnueWriteNet(vector<string> args)
     bool zExport = false;
     bool leb128 = false;
     bool sort = false;
+    bool native = false;
     if (ci < cs)
         NnueNetPath = args[ci++];
 
     while (ci < cs) {
-        if (args[ci] == "rescale" && ++ci < cs)
+        if (args[ci] == "rescale")
         {
+            if (++ci >= cs) {
+                cout << "Missing value of rescale.\n";
+                return;
+            }
             rescale = stoi(args[ci++]);
         }
         else if (args[ci] == "l")
@@ -2010,6 +2202,21 @@ void NnueWriteNet(vector<string> args)
             sort = true;
             ci++;
         }
+        else if (args[ci] == "native")
+        {
+            native = true;
+            ci++;
+        }
+        else
+        {
+            cout << "Unknown export argument " << args[ci] << ". Known are rescale <n>, l, z, sort and native.\n";
+            return;
+        }
+    }
+
+    if (!NnueReady) {
+        cout << "No network loaded.\n";
+        return;
     }
 
     if (sort)
@@ -2039,16 +2246,29 @@ void NnueWriteNet(vector<string> args)
     uint32_t version = NnueCurrentArch->GetFileVersion();
     string sarchitecture = NnueCurrentArch->GetArchDescription();
     uint32_t size = (uint32_t)sarchitecture.size();
+    uint32_t nativeversion = NNUEFILEVERSIONNATIVE;
+    uint32_t ftdims = NnueCurrentArch->GetAccumulationSize();
+    uint32_t layout = NNUENATIVELAYOUT;
 
     NnueNetsource nr;
     nr.readbuffersize = 3 * sizeof(uint32_t) + size + NnueCurrentArch->GetNetworkFilesize();
+    if (native)
+        // header, alignment of the feature transformer weights and 16bit weights of FASTSSE2 builds
+        nr.readbuffersize += 3 * sizeof(uint32_t) + 4 * NNUENATIVEALIGN + NnueCurrentArch->GetNetworkFilesize() * (sizeof(weight_t) - 1);
     nr.readbuffer = (unsigned char*)allocalign64(nr.readbuffersize);
+    memset(nr.readbuffer, 0, nr.readbuffersize);
     nr.next = nr.readbuffer;
 
-    nr.write((unsigned char*)&version, sizeof(uint32_t));
+    nr.write((unsigned char*)(native ? &nativeversion : &version), sizeof(uint32_t));
     nr.write((unsigned char*)&filehash, sizeof(uint32_t));
     nr.write((unsigned char*)&size, sizeof(uint32_t));
     nr.write((unsigned char*)&sarchitecture[0], size);
+    if (native) {
+        nr.write((unsigned char*)&version, sizeof(uint32_t));
+        nr.write((unsigned char*)&ftdims, sizeof(uint32_t));
+        nr.write((unsigned char*)&layout, sizeof(uint32_t));
+        nr.native = true;
+    }
     nr.write((unsigned char*)&fthash, sizeof(uint32_t));
 
     NnueCurrentArch->WriteFeatureWeights(&nr, leb128);
@@ -2127,6 +2347,8 @@ bool NnueNetsource::open()
         filenames.push_back(en.ExecPath + ".." + sep + NnueNetPath);
     }
     for (unsigned int i = 0; i < filenames.size(); i++) {
+        if (mapNative(filenames[i]))
+            break;
         ifstream is;
         is.open(filenames[i], ios::binary);
         if (!is)
@@ -2152,32 +2374,34 @@ bool NnueNetsource::open()
         if (insize > 0)
             break;
     }
-    if (!insize) {
+    if (!insize && !mappedsize) {
         guiCom << "info string Cannot open file " << NnueNetPath << ". Probably doesn't exist.\n";
         goto cleanup;
     }
 #endif // NNUEINCLUDED
 
-    sourcebuffer = inbuffer;
+    if (!mappedsize) {
+        sourcebuffer = inbuffer;
 
 #if USE_ZLIB
-    // Now test if the input is compressed
-    ret = xFlate(false, inbuffer, &inflatebuffer, insize, &inflatesize);
-    if (ret == Z_OK) {
-        sourcebuffer = inflatebuffer;
-        insize = inflatesize;
-    }
+        // Now test if the input is compressed
+        ret = xFlate(false, inbuffer, &inflatebuffer, insize, &inflatesize);
+        if (ret == Z_OK) {
+            sourcebuffer = inflatebuffer;
+            insize = inflatesize;
+        }
 #endif // USE_ZLIB
 
-    // Finally locate buffer for the NnueNetsource object, copy the network data and free the temporary buffers
-    readbuffer = (unsigned char*)allocalign64(insize);
-    if (!readbuffer) {
-        guiCom << "info string Cannot alloc read buffer for network file.\n";
-        goto cleanup;
+        // Finally locate buffer for the NnueNetsource object, copy the network data and free the temporary buffers
+        readbuffer = (unsigned char*)allocalign64(insize);
+        if (!readbuffer) {
+            guiCom << "info string Cannot alloc read buffer for network file.\n";
+            goto cleanup;
+        }
+        memcpy(readbuffer, sourcebuffer, insize);
+        readbuffersize = insize;
+        next = readbuffer;
     }
-    memcpy(readbuffer, sourcebuffer, insize);
-    readbuffersize = insize;
-    next = readbuffer;
 
     openOk = NnueReadNet(this);
 
@@ -2197,6 +2421,60 @@ cleanup:
     return openOk;
 }
 
+// Maps a network file of the native format, the feature transformer uses its pages in place
+// and they are shared with other processes using the same network until they are written to
+bool NnueNetsource::mapNative(string filename)
+{
+#ifdef _WIN32
+    (void)filename;
+    return false;
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    uint32_t version = 0;
+    void* data = MAP_FAILED;
+    struct stat stat_buf;
+    if (fstat(fd, &stat_buf) == 0
+        && ::read(fd, &version, sizeof(uint32_t)) == sizeof(uint32_t)
+        && version == NNUEFILEVERSIONNATIVE)
+        data = mmap(nullptr, stat_buf.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    readbuffer = next = (unsigned char*)data;
+    readbuffersize = mappedsize = stat_buf.st_size;
+    return true;
+#endif
+}
+
+void NnueNetsource::close()
+{
+    if (readbuffer && !handedover) {
+#ifndef _WIN32
+        if (mappedsize)
+            munmap(readbuffer, mappedsize);
+        else
+#endif
+            freealigned64(readbuffer);
+    }
+    readbuffer = next = nullptr;
+    readbuffersize = mappedsize = 0;
+    handedover = false;
+}
+
+// Passes the buffer to owner, reading continues from it
+void NnueNetsource::handOver(NnueNetsource* owner)
+{
+    owner->close();
+    owner->readbuffer = owner->next = readbuffer;
+    owner->readbuffersize = readbuffersize;
+    owner->mappedsize = mappedsize;
+    handedover = true;
+}
+
 bool NnueNetsource::read(unsigned char* target, size_t readsize)
 {
     if (next - readbuffer + readsize > readbuffersize)
@@ -2215,6 +2493,25 @@ bool NnueNetsource::write(unsigned char* source, size_t writesize)
     return true;
 }
 
+// Returns the next aligned block of size bytes without copying it
+unsigned char* NnueNetsource::map(size_t size)
+{
+    size_t offset = MULTIPLEOFN((size_t)(next - readbuffer), NNUENATIVEALIGN);
+    if (offset + size > readbuffersize)
+        return nullptr;
+    next = readbuffer + offset + size;
+    return readbuffer + offset;
+}
+
+bool NnueNetsource::writeAligned(unsigned char* source, size_t writesize)
+{
+    unsigned char* target = map(writesize);
+    if (!target)
+        return false;
+    memcpy(target, source, writesize);
+    return true;
+}
+
 bool NnueNetsource::endOfNet()
 {
     return (next == readbuffer + readbuffersize);
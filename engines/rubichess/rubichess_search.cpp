@@ -36,9 +36,19 @@ statistic statistics;
 int reductiontable[2][MAXDEPTH][64];
 int lmptable[2][MAXPRUNINGDEPTH + 1];
 
-// Shameless copy of Ethereal/Laser for now; may be improved/changed in the future
-static const int SkipSize[16] = { 1, 1, 1, 2, 2, 2, 1, 3, 2, 2, 1, 3, 3, 2, 2, 1 };
-static const int SkipDepths[16] = { 1, 2, 2, 4, 4, 3, 2, 5, 4, 3, 2, 6, 5, 4, 3, 2 };
+// Depth skipping of the helper threads, selected by the HelperDepthSkip option
+// Laser: shameless copy of Ethereal/Laser for now; may be improved/changed in the future
+// Half: every second helper skips every second depth; None: all threads search every depth
+static const int SkipSize[3][16] = {
+    { 1, 1, 1, 2, 2, 2, 1, 3, 2, 2, 1, 3, 3, 2, 2, 1 },
+    { 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1 },
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }
+};
+static const int SkipDepths[3][16] = {
+    { 1, 2, 2, 4, 4, 3, 2, 5, 4, 3, 2, 6, 5, 4, 3, 2 },
+    { 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2 },
+    { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 }
+};
 
 
 void searchtableinit()
@@ -220,10 +230,13 @@ int chessposition::getQuiescence(int alpha, int beta, int depth)
 #endif
 
     STATISTICSINC(qs_n[myIsCheck]);
+    COUNTERINC(qs_n);
     STATISTICSDO(if (depth < statistics.qs_mindepth) statistics.qs_mindepth = depth);
 
     bool tpHit;
     ttentry* tte = tp.probeHash(hash, &tpHit);
+    ttprobes++;
+    tthits += tpHit;
     int hashscore = tpHit ? FIXMATESCOREPROBE(tte->value, ply) : NOSCORE;
     uint16_t hashmovecode = tpHit ? tte->movecode : 0;
 
@@ -304,6 +317,7 @@ int chessposition::getQuiescence(int alpha, int beta, int depth)
             continue;
 
         STATISTICSINC(qs_moves);
+        COUNTERINC(qs_moves);
         legalMoves++;
         score = -getQuiescence<Pt>(-beta, -alpha, depth - 1);
         unplayMove<false>(mc);
@@ -362,7 +376,9 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
     pvtable[ply][0] = 0;
 
     STATISTICSINC(ab_n);
+    COUNTERINC(ab_n);
     STATISTICSADD(ab_pv, PVNode);
+    COUNTERADD(ab_pv, PVNode);
 
     // test for remis via repetition
     int rep = testRepetition();
@@ -438,6 +454,8 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
     // TT lookup
     bool tpHit;
     ttentry* tte = tp.probeHash(newhash, &tpHit);
+    ttprobes++;
+    tthits += tpHit;
     int hashscore = tpHit ? FIXMATESCOREPROBE(tte->value, ply) : NOSCORE;
     uint16_t hashmovecode = tpHit ? tte->movecode : 0;
     int staticeval = tpHit ? tte->staticeval : NOSCORE;
@@ -452,6 +470,7 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
         }
         // not a single repetition; we can (almost) safely trust the hash value
         STATISTICSINC(ab_tt);
+        COUNTERINC(ab_tt);
 #ifdef SDEBUG
         uint32_t fullhashmove = shortMove2FullMove(hashmovecode);
         SDEBUGDO(isDebugPv, pvabortscore[ply] = hashscore; if (debugMove == hashmovecode) pvaborttype[ply] = PVA_FROMTT; else pvaborttype[ply] = PVA_DIFFERENTFROMTT; );
@@ -552,6 +571,7 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
     if (Pt != MatePrune && !PVNode && !isCheckbb && depth == 1 && staticeval > beta + (positionImproved ? sps.threatprunemarginimprove : sps.threatprunemargin) && !threats)
     {
         STATISTICSINC(prune_threat);
+        COUNTERINC(prune_threat);
         return beta;
     }
 
@@ -563,6 +583,7 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
         if (!isCheckbb && POPCOUNT(threats) < 2 && staticeval - depth * (sps.futilityreversedepthfactor - sps.futilityreverseimproved * positionImproved) > beta)
         {
             STATISTICSINC(prune_futility);
+            COUNTERINC(prune_futility);
             SDEBUGDO(isDebugPv, pvabortscore[ply] = staticeval; pvaborttype[ply] = PVA_REVFUTILITYPRUNED;);
             return staticeval;
         }
@@ -583,6 +604,7 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
         {
             if (abs(beta) < 5000 && (depth < sps.nmverificationdepth || nullmoveply)) {
                 STATISTICSINC(prune_nm);
+                COUNTERINC(prune_nm);
                 SDEBUGDO(isDebugPv, pvabortscore[ply] = score; pvaborttype[ply] = PVA_NMPRUNED;);
                 SDEBUGDO(isDebugPv, pvadditionalinfo[ply] = "NM-Reduction:" +  to_string(depth) + "-" + to_string(nmreduction) + " (no verification)"; );
                 return beta;
@@ -594,6 +616,7 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
             nullmoveside = nullmoveply = 0;
             if (verificationscore >= beta) {
                 STATISTICSINC(prune_nm);
+                COUNTERINC(prune_nm);
                 SDEBUGDO(isDebugPv, pvabortscore[ply] = score; pvaborttype[ply] = PVA_NMPRUNED;);
                 SDEBUGDO(isDebugPv, pvadditionalinfo[ply] = "NM-Reduction:" + to_string(depth) + "-" + to_string(nmreduction) + " (with verification)"; );
                 return beta;
@@ -626,6 +649,7 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
                 {
                     // ProbCut off
                     STATISTICSINC(prune_probcut);
+                    COUNTERINC(prune_probcut);
                     SDEBUGDO(isDebugPv, pvabortscore[ply] = probcutscore; pvaborttype[ply] = PVA_PROBCUTPRUNED; pvadditionalinfo[ply] = "pruned by " + moveToString(mc););
                     tp.addHash(tte, hash, probcutscore, staticeval, HASHBETA, depth - 3, mc);
                     return probcutscore;
@@ -654,6 +678,7 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
 
     ms->SetPreferredMoves(this, hashmovecode, killer[ply][0], killer[ply][1], counter, excludeMove);
     STATISTICSINC(moves_loop_n);
+    COUNTERINC(moves_loop_n);
     STATISTICSDO(ms->depth = min(MAXSTATDEPTH - 2, depth));
     STATISTICSDO(ms->PvNode = PVNode);
     STATISTICSINC(ms_n[PVNode][ms->depth]);
@@ -682,6 +707,7 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
                 // Proceed to next moveselector state manually to save some time
                 ms->state++;
                 STATISTICSINC(moves_pruned_lmp);
+                COUNTERINC(moves_pruned_lmp);
                 SDEBUGDO(isDebugMove, pvaborttype[ply] = PVA_LMPRUNED;);
                 continue;
             }
@@ -691,6 +717,7 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
             if (futilityPrune && legalMoves)
             {
                 STATISTICSINC(moves_pruned_futility);
+                COUNTERINC(moves_pruned_futility);
                 SDEBUGDO(isDebugMove, pvaborttype[ply] = PVA_FUTILITYPRUNED;);
                 continue;
             }
@@ -701,6 +728,7 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
                 && !see(mc, sps.seeprunemarginperdepth * depth * (ISTACTICAL(mc) ? depth : sps.seeprunequietfactor)))
             {
                 STATISTICSINC(moves_pruned_badsee);
+                COUNTERINC(moves_pruned_badsee);
                 SDEBUGDO(isDebugMove, pvaborttype[ply] = PVA_SEEPRUNED;);
                 continue;
             }
@@ -737,12 +765,14 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
                 {
                     // Move is singular
                     STATISTICSINC(extend_singular);
+                    COUNTERINC(extend_singular);
                     extendMove = 1;
                 }
                 else if (bestknownscore >= beta && sBeta >= beta)
                 {
                     // Hashscore for lower depth and static eval cut and we have at least a second good move => lets cut here
                     STATISTICSINC(prune_multicut);
+                    COUNTERINC(prune_multicut);
                     SDEBUGDO(isDebugPv, pvabortscore[ply] = sBeta; pvaborttype[ply] = PVA_MULTICUT;);
                     return sBeta;
                 }
@@ -810,6 +840,7 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
             reduction -= (failhighcount[ply] < 4);
 
             STATISTICSINC(red_pi[positionImproved]);
+            COUNTERINC(red_n);
             STATISTICSADD(red_lmr[positionImproved], reductiontable[positionImproved][depth][min(63, legalMoves + 1)]);
             STATISTICSADD(red_history, -stats / (sps.lmrstatsratio * 8));
             STATISTICSADD(red_historyabs, abs(-stats) / (sps.lmrstatsratio * 8));
@@ -822,11 +853,13 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
             STATISTICSDO(int red1 = reduction);
             STATISTICSADD(red_correction, red1 - red0);
             STATISTICSADD(red_total, reduction);
+            COUNTERADD(red_total, reduction);
         }
         effectiveDepth = depth + extendall - reduction + extendMove;
 
         SDEBUGDO(isDebugMove, debugMovePlayed = true;);
         STATISTICSINC(moves_played[(bool)ISTACTICAL(mc)]);
+        COUNTERINC(moves_played);
 
         CurrentMoveNum[ply] = ++legalMoves;
 
@@ -904,6 +937,8 @@ int chessposition::alphabeta(int alpha, int beta, int depth, bool cutnode)
                     failhighcount[ply] += (!hashmovecode + 1);
 
                     STATISTICSINC(moves_fail_high);
+                    COUNTERINC(moves_fail_high);
+                    COUNTERADD(moves_fail_high_first, legalMoves == 1);
 
                     if (!excludeMove)
                         tp.addHash(tte, newhash, FIXMATESCOREADD(score, ply), staticeval, HASHBETA, effectiveDepth, (uint16_t)bestcode);
@@ -987,6 +1022,8 @@ int chessposition::rootsearch(int alpha, int beta, int *depthptr, int inWindowLa
     bool tpHit;
     int newDepth;
     ttentry* tte = tp.probeHash(hash, &tpHit);
+    ttprobes++;
+    tthits += tpHit;
     int score = tpHit ? tte->value : NOSCORE;
     uint16_t hashmovecode = tpHit ? tte->movecode : 0;
     int staticeval = tpHit ? tte->staticeval : NOSCORE;
@@ -1500,10 +1537,11 @@ void mainSearch(searchthread *thr)
             }
             lastiterationscore = pos->bestmovescore[0];
 
-            // Skip some depths depending on current depth and thread number using Laser's method
+            // Skip some depths depending on current depth and thread number
             int cycle = thr->index % 16;
-            if (thr->index && (thr->depth + cycle) % SkipDepths[cycle] == 0)
-                thr->depth += SkipSize[cycle];
+            int schedule = en.HelperDepthSkip;
+            if (thr->index && (thr->depth + cycle) % SkipDepths[schedule][cycle] == 0)
+                thr->depth += SkipSize[schedule][cycle];
 
             thr->depth++;
             if (en.pondersearch == PONDERING && thr->depth > maxdepth) thr->depth--;  // stay on maxdepth when pondering
@@ -16,9 +16,9 @@
 #include <fcntl.h>
 #ifndef _WIN32
 #include <unistd.h>
-#include <sys/mman.h>
 #endif
 #include "rubichess_tbcore.h"
+#include "../syzygymap.h"
 
 #define TBMAX_PIECE 650
 #define TBMAX_PAWN 861
@@ -91,23 +91,27 @@ static void close_tb(FD fd)
 
 static char *map_file(const char *name, const char *suffix, uint64_t *mapping)
 {
-    FD fd = open_tb(name, suffix);
-    if (fd == FD_ERR)
-        return NULL;
 #ifndef _WIN32
-    struct stat statbuf;
-    fstat(fd, &statbuf);
-    *mapping = statbuf.st_size;
-    char* data = (char*)mmap(NULL, statbuf.st_size, PROT_READ,
-        MAP_SHARED, fd, 0);
-#if defined(MADV_RANDOM)
-    madvise((void*)data, statbuf.st_size, MADV_RANDOM);
-#endif
-    if (data == (char*)(-1)) {
-        printf("Could not mmap() %s.\n", name);
-        exit(1);
+    // The mapping is shared with the other engines, see syzygymap.h
+    char file[256];
+    for (int i = 0; i < num_paths; i++) {
+        strcpy(file, paths[i]);
+        strcat(file, "/");
+        strcat(file, name);
+        strcat(file, suffix);
+        char* data = (char*)syzygy_mapFile(file, mapping);
+        if (data)
+            return data;
+        if (*mapping) {
+            printf("Could not mmap() %s.\n", name);
+            exit(1);
+        }
     }
+    return NULL;
 #else
+    FD fd = open_tb(name, suffix);
+    if (fd == FD_ERR)
+        return NULL;
     DWORD size_low, size_high;
     size_low = GetFileSize(fd, &size_high);
     HANDLE map = CreateFileMapping(fd, NULL, PAGE_READONLY, size_high, size_low,
@@ -122,17 +126,16 @@ static char *map_file(const char *name, const char *suffix, uint64_t *mapping)
         printf("MapViewOfFile() failed, name = %s%s, error = %lu.\n", name, suffix, GetLastError());
         exit(1);
     }
-#endif
     close_tb(fd);
     return data;
+#endif
 }
 
 
 #ifndef _WIN32
 static void unmap_file(char *data, uint64_t size)
 {
-    if (!data) return;
-    munmap(data, size);
+    syzygy_unmapFile(data);
 }
 #else
 static void unmap_file(char *data, uint64_t mapping)
@@ -250,6 +253,8 @@ void init_tablebases(char *path)
         initialized = 1;
     }
 
+    tbWdlCache.clear();
+
     // if path_string is set, we need to clean up first.
     if (path_string) {
         free(path_string);
@@ -1040,6 +1045,9 @@ static int init_table_wdl(struct TBEntry *entry, char *str)
             data += size[4];
         }
 
+        // Every probe reads the headers and indices, only the data is demand paged
+        syzygy_willNeed(entry->data, data - (uint8_t*)entry->data);
+
         data = (uint8_t*)((((uintptr_t)data) + 0x3f) & ~0x3f);
         ptr->precomp[0]->data = data;
         data += size[2];
@@ -1086,6 +1094,8 @@ static int init_table_wdl(struct TBEntry *entry, char *str)
             }
         }
 
+        syzygy_willNeed(entry->data, data - (uint8_t*)entry->data);
+
         for (f = 0; f < files; f++) {
             data = (uint8_t*)((((uintptr_t)data) + 0x3f) & ~0x3f);
             ptr->file[f].precomp[0]->data = data;
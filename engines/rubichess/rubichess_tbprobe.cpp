@@ -31,6 +31,7 @@
 
 #include "rubichess_RubiChess.h"
 #include "rubichess_tbcore.h"
+#include "../syzygycache.h"
 
 using namespace rubichess;
 
@@ -40,6 +41,9 @@ namespace rubichess {
 
 int TBlargest = 0;
 
+// Recent probe_wdl results, the payload is (v + 2) * 4 + success
+SyzygyCache tbWdlCache;
+
 } // namespace rubichess
 
 #include "rubichess_tbcore.c"
@@ -403,6 +407,22 @@ int chessposition::probe_ab(int alpha, int beta, int *success)
 //  1 : win, but draw under 50-move rule
 //  2 : win
 int chessposition::probe_wdl(int *success)
+{
+    uint16_t payload;
+    if (tbWdlCache.probe(hash, payload))
+    {
+        *success = payload & 3;
+        return (payload >> 2) - 2;
+    }
+
+    int v = probe_wdl_uncached(success);
+    if (*success)
+        tbWdlCache.store(hash, uint16_t((v + 2) * 4 + *success));
+
+    return v;
+}
+
+int chessposition::probe_wdl_uncached(int *success)
 {
     *success = 1;
     int best_cap = -3, best_ep = -3;
@@ -325,6 +325,7 @@ void Pawnhash::setSize(int sizeMb)
     size_t tablesize = (size_t)size * sizeof(S_PAWNHASHENTRY);
     table = (S_PAWNHASHENTRY*)allocalign64(tablesize);
     memset(table, 0, tablesize);
+    probes = hits = 0;
 }
 
 
@@ -338,10 +339,12 @@ bool Pawnhash::probeHash(U64 hash, pawnhashentry **entry)
 {
     unsigned long long index = hash & sizemask;
     *entry = &table[index];
+    probes++;
     if (((*entry)->hashupper) == (hash >> 32))
     {
 #ifndef EVALTUNE
         // don't use pawn hash when tuning evaluation
+        hits++;
         return true;
 #endif
     }
@@ -356,11 +359,18 @@ bool Pawnhash::probeHash(U64 hash, pawnhashentry **entry)
 }
 
 
-void Materialhash::init()
+void Materialhash::init(int sizeMb)
 {
-    size_t tablesize = (size_t)MATERIALHASHSIZE * sizeof(Materialhashentry);
+    int msb = 0;
+    U64 size = ((U64)max(sizeMb, 1) << 20) / sizeof(Materialhashentry);
+    GETMSB(msb, size);
+    size = (1ULL << msb);
+
+    sizemask = size - 1;
+    size_t tablesize = (size_t)size * sizeof(Materialhashentry);
     table = (Materialhashentry*)allocalign64(tablesize);
     memset(table, 0, tablesize);
+    probes = hits = 0;
 }
 
 void Materialhash::remove()
@@ -370,9 +380,13 @@ void Materialhash::remove()
 
 bool  Materialhash::probeHash(U64 hash, Materialhashentry **entry)
 {
-    *entry = &table[hash & MATERIALHASHMASK];
+    *entry = &table[hash & sizemask];
+    probes++;
     if ((*entry)->hash == hash)
+    {
+        hits++;
         return true;
+    }
 
     (*entry)->hash = hash;
     return false;
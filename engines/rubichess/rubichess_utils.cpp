@@ -515,13 +515,15 @@ string compilerinfo::PrintCpuFeatures(U64 f, bool onlyHighest)
 #if defined _MSC_VER && !defined(__clang_major__)
 #include <intrin.h>
 #define CPUID(x,i) __cpuid(x, i)
+#define CPUIDEX(x,i,s) __cpuidex(x, i, s)
 #endif
 
 #if defined(__MINGW64__) || defined(__gnu_linux__) || defined(__clang_major__) || defined(__GNUC__)
 #include <cpuid.h>
-#define CPUID(x,i) cpuid(x, i)
-static void cpuid(int32_t out[4], int32_t x) {
-    __cpuid_count(x, 0, out[0], out[1], out[2], out[3]);
+#define CPUID(x,i) cpuid(x, i, 0)
+#define CPUIDEX(x,i,s) cpuid(x, i, s)
+static void cpuid(int32_t out[4], int32_t x, int32_t s) {
+    __cpuid_count(x, s, out[0], out[1], out[2], out[3]);
 }
 #endif
 
@@ -578,6 +580,13 @@ void compilerinfo::GetSystemInfo()
             if (CPUInfo[1] & (1 <<  8)) machineSupports |= CPUBMI2;
             if (CPUInfo[1] & (1 <<  5)) machineSupports |= CPUAVX2;
             if (CPUInfo[1] & ((1 << 16) | (1 << 30))) machineSupports |= CPUAVX512; // AVX512F + AVX512BW needed
+            if ((CPUInfo[1] & (1 << 16)) && (CPUInfo[2] & (1 << 11))) machineSupports |= CPUAVX512VNNI;
+            if (CPUInfo[0] >= 1)
+            {
+                int CPUInfo1[4];
+                CPUIDEX(CPUInfo1, 7, 1);
+                if (CPUInfo1[0] & (1 <<  4)) machineSupports |= CPUAVXVNNI;
+            }
         }
     }
 
@@ -622,12 +631,21 @@ void compilerinfo::GetSystemInfo()
             cout << "info string Warning! You are running the BMI2 binary on an AMD cpu which is known for bad performance. Please use avx2 binary for best performance.\n";
     }
 
-    U64 supportedButunused = machineSupports & ~binarySupports;
+    U64 supportedButunused = machineSupports & ~(binarySupports | runtimeSupports);
     if (supportedButunused)
         cout << "info string Warning! Binary not optimal for this machine. Unused cpu features: " + PrintCpuFeatures(supportedButunused) + ". Please use correct binary for best performance.\n";
 }
 
 #else
+#if defined(__aarch64__) && defined(__APPLE__)
+#include <sys/sysctl.h>
+#elif defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_ASIMDDP
+#define HWCAP_ASIMDDP (1 << 20)
+#endif
+#endif
+
 void compilerinfo::GetSystemInfo()
 {
 #if defined(__arm__) || (defined(USE_NEON) && !defined(USE_ARM64))
@@ -640,6 +658,21 @@ void compilerinfo::GetSystemInfo()
     system = "Some non-x86-64-non-arm platform.";
     machineSupports = 0ULL;
 #endif
+
+#if defined(__aarch64__)
+    // ARMv8.2 dot product instructions (sdot) are optional
+#if defined(__ARM_FEATURE_DOTPROD)
+    machineSupports |= CPUDOTPROD;
+#elif defined(__APPLE__)
+    int dotprod = 0;
+    size_t len = sizeof(dotprod);
+    if (sysctlbyname("hw.optional.arm.FEAT_DotProd", &dotprod, &len, nullptr, 0) == 0 && dotprod)
+        machineSupports |= CPUDOTPROD;
+#elif defined(__linux__)
+    if (getauxval(AT_HWCAP) & HWCAP_ASIMDDP)
+        machineSupports |= CPUDOTPROD;
+#endif
+#endif
 }
 
 #endif
@@ -787,6 +820,94 @@ string CurrentWorkingDir()
     return working_directory + kPathSeparator;
 }
 
+
+//
+// Thread binding
+// None restores the cpus of the process, Cores pins thread index to one of them,
+// Numa spreads the threads in blocks over the nodes and pins each to the cpus of its node
+//
+#if defined(__linux__)
+#include <sched.h>
+
+static vector<int> cpusFromList(string list, const cpu_set_t* allowed)
+{
+    // cpulist format of sysfs, e.g. "0-7,16-23"
+    vector<int> cpus;
+    stringstream ss(list);
+    string range;
+    while (getline(ss, range, ','))
+    {
+        int first, last;
+        int n = sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (n < 1)
+            continue;
+        if (n == 1)
+            last = first;
+        for (int c = first; c <= last && c < CPU_SETSIZE; c++)
+            if (CPU_ISSET(c, allowed))
+                cpus.push_back(c);
+    }
+    return cpus;
+}
+
+bool bindThisThread(int binding, int index, int threads)
+{
+    // The affinity of the process, taken by the first thread to bind (pool threads inherit it)
+    static cpu_set_t processCpus;
+    static bool processCpusValid = (sched_getaffinity(0, sizeof(cpu_set_t), &processCpus) == 0);
+    if (!processCpusValid)
+        return false;
+
+    vector<int> cpus;
+    if (binding == ThreadBindCores)
+    {
+        for (int c = 0; c < CPU_SETSIZE; c++)
+            if (CPU_ISSET(c, &processCpus))
+                cpus.push_back(c);
+        if (cpus.size())
+            cpus = { cpus[index % cpus.size()] };
+    }
+    else if (binding == ThreadBindNuma)
+    {
+        vector<vector<int>> nodes;
+        for (int node = 0; ; node++)
+        {
+            ifstream is("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+            string list;
+            if (!is || !getline(is, list))
+                break;
+            vector<int> nodecpus = cpusFromList(list, &processCpus);
+            if (nodecpus.size())
+                nodes.push_back(nodecpus);
+        }
+        if (nodes.size() > 1)
+            cpus = nodes[(size_t)index * nodes.size() / max(1, threads)];
+    }
+
+    cpu_set_t mask;
+    if (cpus.empty())
+    {
+        mask = processCpus;
+    }
+    else
+    {
+        CPU_ZERO(&mask);
+        for (int c : cpus)
+            CPU_SET(c, &mask);
+    }
+    return sched_setaffinity(0, sizeof(cpu_set_t), &mask) == 0;
+}
+
+#else
+
+bool bindThisThread(int binding, int index, int threads)
+{
+    // No affinity control on Windows processor groups, iOS and macOS yet
+    return binding == ThreadBindNone;
+}
+
+#endif
+
 } // namespace rubichess
 
 
@@ -0,0 +1,540 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "simdkernels.h"
+
+#include <atomic>
+
+// The kernels are compiled with target attributes, the rest of the binary
+// keeps the instruction set of the build flags
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIMD_X86
+#if (defined(__clang_major__) && __clang_major__ >= 13) || (!defined(__clang_major__) && __GNUC__ >= 11)
+#define SIMD_X86_VNNI
+#endif
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__GNUC__) && (defined(__ARM_FEATURE_DOTPROD) \
+    || (defined(__apple_build_version__) && __clang_major__ >= 16) \
+    || (!defined(__apple_build_version__) && defined(__clang_major__) && __clang_major__ >= 17) \
+    || (!defined(__clang_major__) && __GNUC__ >= 8))
+#define SIMD_DOTPROD
+#include <arm_neon.h>
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#elif defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_ASIMDDP
+#define HWCAP_ASIMDDP (1 << 20)
+#endif
+#endif
+#endif
+
+namespace {
+
+#ifdef SIMD_X86
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw")))
+
+//
+// AVX2
+//
+template <unsigned Regs>
+TARGET_AVX2
+inline void updateTileAvx2(const int16_t* src, const int16_t* weights, unsigned dims,
+                           const SimdAccumulatorUpdate* updates, unsigned count, unsigned offset)
+{
+    __m256i acc[Regs];
+    for (unsigned k = 0; k < Regs; ++k)
+        acc[k] = _mm256_loadu_si256((const __m256i*)(src + offset) + k);
+
+    for (unsigned u = 0; u < count; ++u)
+    {
+        const SimdAccumulatorUpdate& up = updates[u];
+        for (unsigned i = 0; i < up.removedCount; ++i)
+        {
+            const __m256i* column = (const __m256i*)(weights + size_t(up.removed[i]) * dims + offset);
+            for (unsigned k = 0; k < Regs; ++k)
+                acc[k] = _mm256_sub_epi16(acc[k], _mm256_loadu_si256(column + k));
+        }
+        for (unsigned i = 0; i < up.addedCount; ++i)
+        {
+            const __m256i* column = (const __m256i*)(weights + size_t(up.added[i]) * dims + offset);
+            for (unsigned k = 0; k < Regs; ++k)
+                acc[k] = _mm256_add_epi16(acc[k], _mm256_loadu_si256(column + k));
+        }
+        for (unsigned k = 0; k < Regs; ++k)
+            _mm256_storeu_si256((__m256i*)(up.dst + offset) + k, acc[k]);
+    }
+}
+
+TARGET_AVX2
+void updateAccumulatorAvx2(const int16_t* src, const int16_t* weights, unsigned dims,
+                           const SimdAccumulatorUpdate* updates, unsigned count)
+{
+    unsigned offset = 0;
+    for (; offset + 256 <= dims; offset += 256)
+        updateTileAvx2<16>(src, weights, dims, updates, count, offset);
+    for (; offset < dims; offset += 64)
+        updateTileAvx2<4>(src, weights, dims, updates, count, offset);
+}
+
+TARGET_AVX2
+void clippedProductAvx2(const int16_t* in0, const int16_t* in1, uint8_t* out, unsigned count)
+{
+    const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi16(127);
+    for (unsigned i = 0; i < count; i += 32)
+    {
+        const __m256i sum0a = _mm256_max_epi16(_mm256_min_epi16(_mm256_loadu_si256((const __m256i*)(in0 + i)), one), zero);
+        const __m256i sum0b = _mm256_max_epi16(_mm256_min_epi16(_mm256_loadu_si256((const __m256i*)(in0 + i + 16)), one), zero);
+        const __m256i sum1a = _mm256_max_epi16(_mm256_min_epi16(_mm256_loadu_si256((const __m256i*)(in1 + i)), one), zero);
+        const __m256i sum1b = _mm256_max_epi16(_mm256_min_epi16(_mm256_loadu_si256((const __m256i*)(in1 + i + 16)), one), zero);
+        const __m256i pa = _mm256_srli_epi16(_mm256_mullo_epi16(sum0a, sum1a), 7);
+        const __m256i pb = _mm256_srli_epi16(_mm256_mullo_epi16(sum0b, sum1b), 7);
+        // packus works on 128 bit lanes, the permute puts the quarters back in order
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(pa, pb), 0xD8);
+        _mm256_storeu_si256((__m256i*)(out + i), packed);
+    }
+}
+
+// Same results as the SSSE3 code of the engines including the int16 saturation of maddubs
+template <unsigned Outputs>
+TARGET_AVX2
+inline void sparseDotTileAvx2(const int32_t* bias, const int32_t* input32, const uint16_t* nnz, unsigned count,
+                              const int8_t* weights, int32_t* output)
+{
+    constexpr unsigned Regs = Outputs / 8;
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i acc[Regs];
+    for (unsigned k = 0; k < Regs; ++k)
+        acc[k] = _mm256_loadu_si256((const __m256i*)bias + k);
+
+    for (unsigned j = 0; j < count; ++j)
+    {
+        const __m256i in = _mm256_set1_epi32(input32[nnz[j]]);
+        const __m256i* col = (const __m256i*)&weights[nnz[j] * Outputs * 4];
+        for (unsigned k = 0; k < Regs; ++k)
+        {
+            const __m256i product = _mm256_madd_epi16(_mm256_maddubs_epi16(in, _mm256_loadu_si256(col + k)), ones);
+            acc[k] = _mm256_add_epi32(acc[k], product);
+        }
+    }
+
+    for (unsigned k = 0; k < Regs; ++k)
+        _mm256_storeu_si256((__m256i*)output + k, acc[k]);
+}
+
+TARGET_AVX2
+bool sparseDotAvx2(const int32_t* bias, const int32_t* input32, const uint16_t* nnz, unsigned count,
+                   const int8_t* weights, unsigned outputs, int32_t* output)
+{
+    switch (outputs)
+    {
+    case 16:
+        sparseDotTileAvx2<16>(bias, input32, nnz, count, weights, output);
+        return true;
+    case 32:
+        sparseDotTileAvx2<32>(bias, input32, nnz, count, weights, output);
+        return true;
+    default:
+        return false;
+    }
+}
+
+//
+// AVX-512 (F and BW)
+//
+template <unsigned Regs>
+TARGET_AVX512
+inline void updateTileAvx512(const int16_t* src, const int16_t* weights, unsigned dims,
+                             const SimdAccumulatorUpdate* updates, unsigned count, unsigned offset)
+{
+    __m512i acc[Regs];
+    for (unsigned k = 0; k < Regs; ++k)
+        acc[k] = _mm512_loadu_si512((const __m512i*)(src + offset) + k);
+
+    for (unsigned u = 0; u < count; ++u)
+    {
+        const SimdAccumulatorUpdate& up = updates[u];
+        for (unsigned i = 0; i < up.removedCount; ++i)
+        {
+            const __m512i* column = (const __m512i*)(weights + size_t(up.removed[i]) * dims + offset);
+            for (unsigned k = 0; k < Regs; ++k)
+                acc[k] = _mm512_sub_epi16(acc[k], _mm512_loadu_si512(column + k));
+        }
+        for (unsigned i = 0; i < up.addedCount; ++i)
+        {
+            const __m512i* column = (const __m512i*)(weights + size_t(up.added[i]) * dims + offset);
+            for (unsigned k = 0; k < Regs; ++k)
+                acc[k] = _mm512_add_epi16(acc[k], _mm512_loadu_si512(column + k));
+        }
+        for (unsigned k = 0; k < Regs; ++k)
+            _mm512_storeu_si512((__m512i*)(up.dst + offset) + k, acc[k]);
+    }
+}
+
+TARGET_AVX512
+void updateAccumulatorAvx512(const int16_t* src, const int16_t* weights, unsigned dims,
+                             const SimdAccumulatorUpdate* updates, unsigned count)
+{
+    unsigned offset = 0;
+    for (; offset + 512 <= dims; offset += 512)
+        updateTileAvx512<16>(src, weights, dims, updates, count, offset);
+    for (; offset < dims; offset += 64)
+        updateTileAvx512<2>(src, weights, dims, updates, count, offset);
+}
+
+TARGET_AVX512
+void clippedProductAvx512(const int16_t* in0, const int16_t* in1, uint8_t* out, unsigned count)
+{
+    const __m512i zero = _mm512_setzero_si512(), one = _mm512_set1_epi16(127);
+    const __m512i order = _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7);
+    for (unsigned i = 0; i < count; i += 64)
+    {
+        const __m512i sum0a = _mm512_max_epi16(_mm512_min_epi16(_mm512_loadu_si512(in0 + i), one), zero);
+        const __m512i sum0b = _mm512_max_epi16(_mm512_min_epi16(_mm512_loadu_si512(in0 + i + 32), one), zero);
+        const __m512i sum1a = _mm512_max_epi16(_mm512_min_epi16(_mm512_loadu_si512(in1 + i), one), zero);
+        const __m512i sum1b = _mm512_max_epi16(_mm512_min_epi16(_mm512_loadu_si512(in1 + i + 32), one), zero);
+        const __m512i pa = _mm512_srli_epi16(_mm512_mullo_epi16(sum0a, sum1a), 7);
+        const __m512i pb = _mm512_srli_epi16(_mm512_mullo_epi16(sum0b, sum1b), 7);
+        const __m512i packed = _mm512_maskz_permutexvar_epi64(0xFF, order, _mm512_packus_epi16(pa, pb));
+        _mm512_storeu_si512(out + i, packed);
+    }
+}
+
+#ifdef SIMD_X86_VNNI
+//
+// VNNI, vpdpbusd replaces maddubs, madd and add. Two accumulator sets hide its latency
+//
+template <unsigned Outputs>
+__attribute__((target("avx2,avxvnni")))
+inline void sparseDotTileAvxVnni(const int32_t* bias, const int32_t* input32, const uint16_t* nnz, unsigned count,
+                                 const int8_t* weights, int32_t* output)
+{
+    constexpr unsigned Regs = Outputs / 8;
+    __m256i acc0[Regs], acc1[Regs];
+    for (unsigned k = 0; k < Regs; ++k)
+    {
+        acc0[k] = _mm256_loadu_si256((const __m256i*)bias + k);
+        acc1[k] = _mm256_setzero_si256();
+    }
+
+    unsigned j = 0;
+    for (; j + 1 < count; j += 2)
+    {
+        const __m256i in0 = _mm256_set1_epi32(input32[nnz[j]]);
+        const __m256i in1 = _mm256_set1_epi32(input32[nnz[j + 1]]);
+        const __m256i* col0 = (const __m256i*)&weights[nnz[j] * Outputs * 4];
+        const __m256i* col1 = (const __m256i*)&weights[nnz[j + 1] * Outputs * 4];
+        for (unsigned k = 0; k < Regs; ++k)
+        {
+            acc0[k] = _mm256_dpbusd_avx_epi32(acc0[k], in0, _mm256_loadu_si256(col0 + k));
+            acc1[k] = _mm256_dpbusd_avx_epi32(acc1[k], in1, _mm256_loadu_si256(col1 + k));
+        }
+    }
+    if (j < count)
+    {
+        const __m256i in = _mm256_set1_epi32(input32[nnz[j]]);
+        const __m256i* col = (const __m256i*)&weights[nnz[j] * Outputs * 4];
+        for (unsigned k = 0; k < Regs; ++k)
+            acc0[k] = _mm256_dpbusd_avx_epi32(acc0[k], in, _mm256_loadu_si256(col + k));
+    }
+
+    for (unsigned k = 0; k < Regs; ++k)
+        _mm256_storeu_si256((__m256i*)output + k, _mm256_add_epi32(acc0[k], acc1[k]));
+}
+
+__attribute__((target("avx2,avxvnni")))
+bool sparseDotAvxVnni(const int32_t* bias, const int32_t* input32, const uint16_t* nnz, unsigned count,
+                      const int8_t* weights, unsigned outputs, int32_t* output)
+{
+    switch (outputs)
+    {
+    case 16:
+        sparseDotTileAvxVnni<16>(bias, input32, nnz, count, weights, output);
+        return true;
+    case 32:
+        sparseDotTileAvxVnni<32>(bias, input32, nnz, count, weights, output);
+        return true;
+    default:
+        return false;
+    }
+}
+
+template <unsigned Outputs>
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+inline void sparseDotTileAvx512Vnni(const int32_t* bias, const int32_t* input32, const uint16_t* nnz, unsigned count,
+                                    const int8_t* weights, int32_t* output)
+{
+    constexpr unsigned Regs = Outputs / 16;
+    __m512i acc0[Regs], acc1[Regs];
+    for (unsigned k = 0; k < Regs; ++k)
+    {
+        acc0[k] = _mm512_loadu_si512((const __m512i*)bias + k);
+        acc1[k] = _mm512_setzero_si512();
+    }
+
+    unsigned j = 0;
+    for (; j + 1 < count; j += 2)
+    {
+        const __m512i in0 = _mm512_set1_epi32(input32[nnz[j]]);
+        const __m512i in1 = _mm512_set1_epi32(input32[nnz[j + 1]]);
+        const __m512i* col0 = (const __m512i*)&weights[nnz[j] * Outputs * 4];
+        const __m512i* col1 = (const __m512i*)&weights[nnz[j + 1] * Outputs * 4];
+        for (unsigned k = 0; k < Regs; ++k)
+        {
+            acc0[k] = _mm512_dpbusd_epi32(acc0[k], in0, _mm512_loadu_si512(col0 + k));
+            acc1[k] = _mm512_dpbusd_epi32(acc1[k], in1, _mm512_loadu_si512(col1 + k));
+        }
+    }
+    if (j < count)
+    {
+        const __m512i in = _mm512_set1_epi32(input32[nnz[j]]);
+        const __m512i* col = (const __m512i*)&weights[nnz[j] * Outputs * 4];
+        for (unsigned k = 0; k < Regs; ++k)
+            acc0[k] = _mm512_dpbusd_epi32(acc0[k], in, _mm512_loadu_si512(col + k));
+    }
+
+    for (unsigned k = 0; k < Regs; ++k)
+        _mm512_storeu_si512((__m512i*)output + k, _mm512_add_epi32(acc0[k], acc1[k]));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+bool sparseDotAvx512Vnni(const int32_t* bias, const int32_t* input32, const uint16_t* nnz, unsigned count,
+                         const int8_t* weights, unsigned outputs, int32_t* output)
+{
+    switch (outputs)
+    {
+    case 16:
+        sparseDotTileAvx512Vnni<16>(bias, input32, nnz, count, weights, output);
+        return true;
+    case 32:
+        sparseDotTileAvx512Vnni<32>(bias, input32, nnz, count, weights, output);
+        return true;
+    default:
+        return false;
+    }
+}
+#endif
+
+// Cpu and OS support, the same cpuid leaves as compilerinfo::GetSystemInfo of
+// RubiChess plus the xgetbv check that the OS saves the wider registers
+unsigned detectLevels()
+{
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & (1 << 27)) || !(ecx & (1 << 28)))
+        return 1 << SimdDefault;
+
+    unsigned xcr0lo, xcr0hi;
+    __asm__("xgetbv" : "=a"(xcr0lo), "=d"(xcr0hi) : "c"(0));
+    const bool ymm = (xcr0lo & 0x06) == 0x06;
+    const bool zmm = ymm && (xcr0lo & 0xe0) == 0xe0;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        return 1 << SimdDefault;
+    const unsigned maxSubleaf = eax;
+    const bool avx2 = ymm && (ebx & (1 << 5));
+    const bool avx512 = zmm && (ebx & (1 << 16)) && (ebx & (1 << 30));
+    const bool avx512vnni = avx512 && (ecx & (1 << 11));
+    bool avxvnni = false;
+    if (maxSubleaf >= 1 && __get_cpuid_count(7, 1, &eax, &ebx, &ecx, &edx))
+        avxvnni = avx2 && (eax & (1 << 4));
+
+    unsigned levels = 1 << SimdDefault;
+    if (avx2) levels |= 1 << SimdAvx2;
+    if (avx512) levels |= 1 << SimdAvx512;
+#ifdef SIMD_X86_VNNI
+    if (avxvnni) levels |= 1 << SimdAvxVnni;
+    if (avx512vnni) levels |= 1 << SimdAvx512Vnni;
+#else
+    (void)avxvnni; (void)avx512vnni;
+#endif
+    return levels;
+}
+
+#endif // SIMD_X86
+
+#ifdef SIMD_DOTPROD
+
+#if defined(__clang_major__)
+#define TARGET_DOTPROD __attribute__((target("dotprod")))
+#else
+#define TARGET_DOTPROD __attribute__((target("+dotprod")))
+#endif
+
+template <unsigned Outputs>
+TARGET_DOTPROD
+inline void sparseDotTileDotprod(const int32_t* bias, const int32_t* input32, const uint16_t* nnz, unsigned count,
+                                 const int8_t* weights, int32_t* output)
+{
+    constexpr unsigned Regs = Outputs / 4;
+    int32x4_t acc[Regs];
+    for (unsigned k = 0; k < Regs; ++k)
+        acc[k] = vld1q_s32(bias + k * 4);
+
+    for (unsigned j = 0; j < count; ++j)
+    {
+        const int8x16_t in = vreinterpretq_s8_s32(vdupq_n_s32(input32[nnz[j]]));
+        const int8_t* col = &weights[nnz[j] * Outputs * 4];
+        for (unsigned k = 0; k < Regs; ++k)
+            acc[k] = vdotq_s32(acc[k], in, vld1q_s8(col + k * 16));
+    }
+
+    for (unsigned k = 0; k < Regs; ++k)
+        vst1q_s32(output + k * 4, acc[k]);
+}
+
+TARGET_DOTPROD
+bool sparseDotDotprod(const int32_t* bias, const int32_t* input32, const uint16_t* nnz, unsigned count,
+                      const int8_t* weights, unsigned outputs, int32_t* output)
+{
+    switch (outputs)
+    {
+    case 16:
+        sparseDotTileDotprod<16>(bias, input32, nnz, count, weights, output);
+        return true;
+    case 32:
+        sparseDotTileDotprod<32>(bias, input32, nnz, count, weights, output);
+        return true;
+    default:
+        return false;
+    }
+}
+
+unsigned detectLevels()
+{
+    unsigned levels = 1 << SimdDefault;
+#if defined(__ARM_FEATURE_DOTPROD)
+    levels |= 1 << SimdDotprod;
+#elif defined(__APPLE__)
+    int dotprod = 0;
+    size_t len = sizeof(dotprod);
+    if (sysctlbyname("hw.optional.arm.FEAT_DotProd", &dotprod, &len, nullptr, 0) == 0 && dotprod)
+        levels |= 1 << SimdDotprod;
+#elif defined(__linux__)
+    if (getauxval(AT_HWCAP) & HWCAP_ASIMDDP)
+        levels |= 1 << SimdDotprod;
+#endif
+    return levels;
+}
+
+#endif // SIMD_DOTPROD
+
+#if !defined(SIMD_X86) && !defined(SIMD_DOTPROD)
+unsigned detectLevels()
+{
+    return 1 << SimdDefault;
+}
+#endif
+
+const SimdKernels kernelSets[SimdLevelNum] = {
+    { nullptr, nullptr, nullptr },
+#ifdef SIMD_X86
+    { updateAccumulatorAvx2, clippedProductAvx2, sparseDotAvx2 },
+#else
+    { nullptr, nullptr, nullptr },
+#endif
+#ifdef SIMD_X86_VNNI
+    { updateAccumulatorAvx2, clippedProductAvx2, sparseDotAvxVnni },
+#else
+    { nullptr, nullptr, nullptr },
+#endif
+#ifdef SIMD_X86
+    { updateAccumulatorAvx512, clippedProductAvx512, sparseDotAvx2 },
+#else
+    { nullptr, nullptr, nullptr },
+#endif
+#ifdef SIMD_X86_VNNI
+    { updateAccumulatorAvx512, clippedProductAvx512, sparseDotAvx512Vnni },
+#else
+    { nullptr, nullptr, nullptr },
+#endif
+#ifdef SIMD_DOTPROD
+    { nullptr, nullptr, sparseDotDotprod },
+#else
+    { nullptr, nullptr, nullptr },
+#endif
+};
+
+unsigned supportedLevels()
+{
+    static const unsigned levels = detectLevels();
+    return levels;
+}
+
+std::atomic<int> activeLevel { -1 };
+
+} // namespace
+
+
+bool simd_supported(int level)
+{
+    return level >= 0 && level < SimdLevelNum && (supportedLevels() & (1 << level));
+}
+
+int simd_bestLevel()
+{
+    // A level covers the accumulator update and the clipped product too, where
+    // 512 bit registers halve the iterations, so both AVX-512 levels come before
+    // AVX-VNNI although 512 bit instructions lower the clock of some cpus. Only
+    // the sparse dot differs between a level and its VNNI variant.
+    // SimdDotprod is left out: its kernels (and the big layer one of RubiChess)
+    // have not been built and checked on ARM against the checksums of the
+    // default level yet. simd_setLevel() still selects it, e.g. in bsgbench nnue
+    const int preferred[] = { SimdAvx512Vnni, SimdAvx512, SimdAvxVnni, SimdAvx2 };
+    for (int level : preferred)
+        if (simd_supported(level))
+            return level;
+    return SimdDefault;
+}
+
+const SimdKernels* simd_kernelSet(int level)
+{
+    return &kernelSets[simd_supported(level) ? level : SimdDefault];
+}
+
+const SimdKernels* simd_kernels()
+{
+    return &kernelSets[simd_level()];
+}
+
+void simd_setLevel(int level)
+{
+    if (simd_supported(level))
+        activeLevel.store(level, std::memory_order_relaxed);
+}
+
+int simd_level()
+{
+    int level = activeLevel.load(std::memory_order_relaxed);
+    if (level < 0)
+    {
+        level = simd_bestLevel();
+        activeLevel.store(level, std::memory_order_relaxed);
+    }
+    return level;
+}
+
+const char* simd_levelName(int level)
+{
+    static const char* const names[SimdLevelNum] = { "default", "avx2", "avxvnni", "avx512", "avx512vnni", "dotprod" };
+    return level >= 0 && level < SimdLevelNum ? names[level] : "unknown";
+}
@@ -0,0 +1,88 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef simdkernels_h
+#define simdkernels_h
+
+#include <stdint.h>
+
+/// The hot NNUE loops of Stockfish and RubiChess, built for instruction sets
+/// above the one the binary is compiled for and picked from cpuid at runtime,
+/// so one binary runs at full speed on every machine. The engines keep their
+/// own code for the compile time instruction set and use a kernel only when
+/// the active set has one (the pointer is not NULL).
+
+enum SimdLevel {
+    SimdDefault = 0,    // no kernels, the engines' own code
+    SimdAvx2,
+    SimdAvxVnni,
+    SimdAvx512,
+    SimdAvx512Vnni,
+    SimdDotprod,        // ARMv8.2 sdot/udot
+    SimdLevelNum
+};
+
+/// One accumulator of an incremental update: dst = previous accumulator
+/// - the weight rows of removed + the weight rows of added
+struct SimdAccumulatorUpdate {
+    int16_t* dst;
+    const uint32_t* removed;
+    unsigned removedCount;
+    const uint32_t* added;
+    unsigned addedCount;
+};
+
+struct SimdKernels {
+    /// Applies count updates one after the other starting from src. A row of
+    /// weights has dims int16 values (a multiple of 64). The tiles stay in
+    /// registers between the updates
+    void (*updateAccumulator)(const int16_t* src, const int16_t* weights, unsigned dims,
+                              const SimdAccumulatorUpdate* updates, unsigned count);
+
+    /// out[i] = clamp(in0[i], 0, 127) * clamp(in1[i], 0, 127) / 128 for count
+    /// values (a multiple of 64), the pairwise product of the feature transformers
+    void (*clippedProduct)(const int16_t* in0, const int16_t* in1, uint8_t* out, unsigned count);
+
+    /// Step 2 of the sparse first layer: output = bias + the 4 byte input blocks
+    /// listed in nnz times their weight columns of outputs * 4 int8 values.
+    /// Returns false for an output count the kernel doesn't handle
+    bool (*sparseDot)(const int32_t* bias, const int32_t* input32, const uint16_t* nnz, unsigned count,
+                      const int8_t* weights, unsigned outputs, int32_t* output);
+};
+
+/// True if this build has kernels for the level and the cpu can run them
+bool simd_supported(int level);
+
+/// The fastest supported level, chosen on first use of simd_kernels(), in the
+/// order avx512vnni, avx512, avxvnni, avx2. Never SimdDotprod, which is only
+/// used when set with simd_setLevel()
+int simd_bestLevel();
+
+/// The kernels of a level, all NULL for SimdDefault or an unsupported level
+const SimdKernels* simd_kernelSet(int level);
+
+/// The kernels the engines use
+const SimdKernels* simd_kernels();
+
+/// Changes the level the engines use (benchmarks), ignored if not supported
+void simd_setLevel(int level);
+int simd_level();
+
+const char* simd_levelName(int level);
+
+#endif /* simdkernels_h */
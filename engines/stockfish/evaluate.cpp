@@ -93,7 +93,8 @@ namespace Eval {
             if (directory != "<internal>")
             {
                 ifstream stream(directory + eval_file, ios::binary);
-                if (NNUE::load_eval(eval_file, stream))
+                if (   NNUE::load_native(eval_file, directory + eval_file)
+                    || NNUE::load_eval(eval_file, stream))
                     currentEvalFileName = eval_file;
             }
 
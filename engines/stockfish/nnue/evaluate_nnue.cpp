@@ -24,6 +24,14 @@
 #include <set>
 #include <sstream>
 #include <string_view>
+#include <type_traits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "../evaluate.h"
 #include "../position.h"
@@ -44,6 +52,13 @@ namespace Stockfish::Eval::NNUE {
   std::string fileName;
   std::string netDescription;
 
+  // Mapping of the native net in use, see load_native()
+  void* nativeData = nullptr;
+  std::size_t nativeSize = 0;
+
+  static_assert(std::is_trivially_copyable_v<FeatureTransformer> && std::is_trivially_copyable_v<Network>,
+                "Native nets are memory images of the parameters");
+
   namespace Detail {
 
   // Initialize the evaluation function parameters
@@ -51,6 +66,7 @@ namespace Stockfish::Eval::NNUE {
   void initialize(AlignedPtr<T>& pointer) {
 
     pointer.reset(reinterpret_cast<T*>(std_aligned_alloc(alignof(T), sizeof(T))));
+    pointer.get_deleter().mapped = false;
     std::memset(pointer.get(), 0, sizeof(T));
   }
 
@@ -59,9 +75,19 @@ namespace Stockfish::Eval::NNUE {
 
     static_assert(alignof(T) <= 4096, "aligned_large_pages_alloc() may fail for such a big alignment requirement of T");
     pointer.reset(reinterpret_cast<T*>(aligned_large_pages_alloc(sizeof(T))));
+    pointer.get_deleter().mapped = false;
     std::memset(pointer.get(), 0, sizeof(T));
   }
 
+  // Use the parameters inside the mapping of a native net
+  template <typename T, typename Pointer>
+  char* map(Pointer& pointer, char* data) {
+
+    pointer.reset(reinterpret_cast<T*>(data));
+    pointer.get_deleter().mapped = true;
+    return data + sizeof(T);
+  }
+
   // Read evaluation function parameters
   template <typename T>
   bool read_parameters(std::istream& stream, T& reference) {
@@ -82,12 +108,30 @@ namespace Stockfish::Eval::NNUE {
 
   }  // namespace Detail
 
+  // Release the mapping of the native net, nothing may point into it anymore
+  static void unmap_native() {
+
+#ifndef _WIN32
+    if (nativeData)
+        munmap(nativeData, nativeSize);
+#endif
+    nativeData = nullptr;
+    nativeSize = 0;
+  }
+
   // Initialize the evaluation function parameters
   static void initialize() {
 
     Detail::initialize(featureTransformer);
     for (std::size_t i = 0; i < LayerStacks; ++i)
       Detail::initialize(network[i]);
+    unmap_native();
+  }
+
+  // The header of a native net: version, hash, layout, description size and
+  // description, padded so that the parameters are aligned as in memory
+  static std::size_t native_header_size(std::size_t descSize) {
+    return ceil_to_multiple<std::size_t>(4 * sizeof(std::uint32_t) + descSize, CacheLineSize);
   }
 
   // Read network header
@@ -371,6 +415,72 @@ namespace Stockfish::Eval::NNUE {
     return write_parameters(stream);
   }
 
+  // Load a native net by mapping the file, the parameters are used in place and
+  // shared with every process using the same file. False if the file is not
+  // a native net of this build
+  bool load_native(std::string name, const std::string& path) {
+
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat statbuf;
+    std::uint32_t header[4] = {};
+    void* data = MAP_FAILED;
+    if (   fstat(fd, &statbuf) == 0
+        && ::read(fd, header, sizeof(header)) == sizeof(header)
+        && header[0] == NativeVersion
+        && header[1] == HashValue
+        && header[2] == NativeLayout
+        && std::size_t(statbuf.st_size) == native_header_size(header[3]) + sizeof(FeatureTransformer) + LayerStacks * sizeof(Network))
+        data = mmap(nullptr, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    char* p = static_cast<char*>(data) + native_header_size(header[3]);
+    p = Detail::map<FeatureTransformer>(featureTransformer, p);
+    for (std::size_t i = 0; i < LayerStacks; ++i)
+        p = Detail::map<Network>(network[i], p);
+
+    unmap_native();
+    nativeData = data;
+    nativeSize = statbuf.st_size;
+    fileName = name;
+    netDescription.assign(static_cast<char*>(data) + sizeof(header), header[3]);
+    return true;
+#else
+    (void)name;
+    (void)path;
+    return false;
+#endif
+  }
+
+  // Save the loaded net as native net, see load_native()
+  bool save_native(const std::string& filename) {
+
+    bool saved = false;
+    if (!fileName.empty())
+    {
+        const std::uint32_t header[4] = { NativeVersion, HashValue, NativeLayout, std::uint32_t(netDescription.size()) };
+        std::string headerBytes(native_header_size(netDescription.size()), '\0');
+        std::memcpy(&headerBytes[0], header, sizeof(header));
+        std::memcpy(&headerBytes[sizeof(header)], netDescription.data(), netDescription.size());
+
+        std::ofstream stream(filename, std::ios_base::binary);
+        stream.write(headerBytes.data(), headerBytes.size());
+        stream.write(reinterpret_cast<const char*>(featureTransformer.get()), sizeof(FeatureTransformer));
+        for (std::size_t i = 0; i < LayerStacks; ++i)
+            stream.write(reinterpret_cast<const char*>(network[i].get()), sizeof(Network));
+        saved = (bool)stream;
+    }
+
+    sync_cout << (saved ? "Native network saved successfully to " + filename
+                        : std::string("Failed to export a native net")) << sync_endl;
+    return saved;
+  }
+
   /// Save eval, to a file given by its name
   bool save_eval(const std::optional<std::string>& filename) {
 
@@ -32,10 +32,34 @@ namespace Stockfish::Eval::NNUE {
       FeatureTransformer::get_hash_value() ^ Network::get_hash_value();
 
 
-  // Deleter for automating release of memory area
+  // Version of the native net format: the parameters as they are laid out in
+  // memory by this build, used in place from a shared read-only mapping
+  constexpr std::uint32_t NativeVersion = 0x7AF32F50u;
+
+  // Order of the affine layer weights in memory, which depends on the SIMD
+  // instructions of the build. Native nets are only valid for the same layout
+  constexpr std::uint32_t NativeLayout =
+#if defined (USE_AVX512)
+      5;
+#elif defined (USE_AVX2)
+      4;
+#elif defined (USE_SSSE3)
+      3;
+#elif defined (USE_NEON_DOTPROD)
+      2;
+#elif defined (USE_NEON)
+      1;
+#else
+      0;
+#endif
+
+  // Deleter for automating release of memory area. Nothing is released
+  // for parameters inside the mapping of a native net
   template <typename T>
   struct AlignedDeleter {
+    bool mapped = false;
     void operator()(T* ptr) const {
+      if (mapped) return;
       ptr->~T();
       std_aligned_free(ptr);
     }
@@ -43,7 +67,9 @@ namespace Stockfish::Eval::NNUE {
 
   template <typename T>
   struct LargePageDeleter {
+    bool mapped = false;
     void operator()(T* ptr) const {
+      if (mapped) return;
       ptr->~T();
       aligned_large_pages_free(ptr);
     }
@@ -62,6 +88,8 @@ namespace Stockfish::Eval::NNUE {
   bool load_eval(std::string name, std::istream& stream);
   bool save_eval(std::ostream& stream);
   bool save_eval(const std::optional<std::string>& filename);
+  bool load_native(std::string name, const std::string& path);
+  bool save_native(const std::string& filename);
 
 }  // namespace Stockfish::Eval::NNUE
 
@@ -28,6 +28,7 @@
 #include "../nnue_common.h"
 #include "affine_transform.h"
 #include "simd.h"
+#include "../../../simdkernels.h"
 
 /*
   This file contains the definition for a fully connected layer (aka affine transform) with block sparse input.
@@ -242,6 +243,11 @@ namespace Stockfish::Eval::NNUE::Layers {
       // Find indices of nonzero 32bit blocks
       find_nnz<NumChunks>(input32, nnz, count);
 
+      // Kernel for a wider instruction set than the build, see simdkernels.h
+      if (auto sparseDot = simd_kernels()->sparseDot)
+        if (sparseDot(biases, input32, nnz, count, weights, OutputDimensions, output))
+          return output;
+
       const vec_t* biasvec = reinterpret_cast<const vec_t*>(biases);
       vec_t acc[NumRegs];
       for (IndexType k = 0; k < NumRegs; ++k)
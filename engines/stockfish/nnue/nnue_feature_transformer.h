@@ -23,6 +23,7 @@
 
 #include "nnue_common.h"
 #include "nnue_architecture.h"
+#include "../../simdkernels.h"
 
 #include <cstring> // std::memset()
 #include <utility> // std::pair
@@ -285,10 +286,19 @@ namespace Stockfish::Eval::NNUE {
         ) / 2;
 
 
+      const auto clippedProduct = simd_kernels()->clippedProduct;
       for (IndexType p = 0; p < 2; ++p)
       {
           const IndexType offset = (HalfDimensions / 2) * p;
 
+          // Kernel for a wider instruction set than the build, see simdkernels.h
+          if (clippedProduct)
+          {
+              clippedProduct(&(accumulation[perspectives[p]][0]), &(accumulation[perspectives[p]][HalfDimensions / 2]),
+                             output + offset, HalfDimensions / 2);
+              continue;
+          }
+
 #if defined(VECTOR)
 
           constexpr IndexType OutputChunkSize = MaxChunkSize;
@@ -411,6 +421,32 @@ namespace Stockfish::Eval::NNUE {
 
       StateInfo* st = computed_st;
 
+      if (auto updateAccumulator = simd_kernels()->updateAccumulator)
+      {
+          SimdAccumulatorUpdate updates[N - 1];
+          unsigned count = 0;
+          for (; states_to_update[count]; ++count)
+              updates[count] = { states_to_update[count]->accumulator.accumulation[Perspective],
+                                 removed[count].begin(), unsigned(removed[count].size()),
+                                 added[count].begin(), unsigned(added[count].size()) };
+          updateAccumulator(st->accumulator.accumulation[Perspective], weights, HalfDimensions, updates, count);
+
+          // The psqt part is only PSQTBuckets wide
+          for (IndexType i = 0; states_to_update[i]; st = states_to_update[i++])
+          {
+              auto& psqtAccumulation = states_to_update[i]->accumulator.psqtAccumulation[Perspective];
+              for (std::size_t k = 0; k < PSQTBuckets; ++k)
+                psqtAccumulation[k] = st->accumulator.psqtAccumulation[Perspective][k];
+              for (const auto index : removed[i])
+                for (std::size_t k = 0; k < PSQTBuckets; ++k)
+                  psqtAccumulation[k] -= psqtWeights[index * PSQTBuckets + k];
+              for (const auto index : added[i])
+                for (std::size_t k = 0; k < PSQTBuckets; ++k)
+                  psqtAccumulation[k] += psqtWeights[index * PSQTBuckets + k];
+          }
+          return;
+      }
+
       // Now update the accumulators listed in states_to_update[], where the last element is a sentinel.
 #ifdef VECTOR
       for (IndexType j = 0; j < HalfDimensions / TileHeight; ++j)
@@ -545,6 +581,20 @@ namespace Stockfish::Eval::NNUE {
       FeatureSet::IndexList active;
       FeatureSet::append_active_indices<Perspective>(pos, active);
 
+      if (auto updateAccumulator = simd_kernels()->updateAccumulator)
+      {
+          const SimdAccumulatorUpdate update = { accumulator.accumulation[Perspective], nullptr, 0,
+                                                 active.begin(), unsigned(active.size()) };
+          updateAccumulator(biases, weights, HalfDimensions, &update, 1);
+
+          for (std::size_t k = 0; k < PSQTBuckets; ++k)
+            accumulator.psqtAccumulation[Perspective][k] = 0;
+          for (const auto index : active)
+            for (std::size_t k = 0; k < PSQTBuckets; ++k)
+              accumulator.psqtAccumulation[Perspective][k] += psqtWeights[index * PSQTBuckets + k];
+          return;
+      }
+
 #ifdef VECTOR
       for (IndexType j = 0; j < HalfDimensions / TileHeight; ++j)
       {
@@ -635,6 +635,9 @@ namespace {
     excludedMove = ss->excludedMove;
     posKey = pos.key();
     tte = TT.probe(posKey, ss->ttHit);
+    thisThread->ttProbes.fetch_add(1, std::memory_order_relaxed);
+    if (ss->ttHit)
+        thisThread->ttHits.fetch_add(1, std::memory_order_relaxed);
     ttValue = ss->ttHit ? value_from_tt(tte->value(), ss->ply, pos.rule50_count()) : VALUE_NONE;
     ttMove =  rootNode ? thisThread->rootMoves[thisThread->pvIdx].pv[0]
             : ss->ttHit    ? tte->move() : MOVE_NONE;
@@ -1488,6 +1491,9 @@ moves_loop: // When in check, search starts here
     // Step 3. Transposition table lookup
     posKey = pos.key();
     tte = TT.probe(posKey, ss->ttHit);
+    thisThread->ttProbes.fetch_add(1, std::memory_order_relaxed);
+    if (ss->ttHit)
+        thisThread->ttHits.fetch_add(1, std::memory_order_relaxed);
     ttValue = ss->ttHit ? value_from_tt(tte->value(), ss->ply, pos.rule50_count()) : VALUE_NONE;
     ttMove = ss->ttHit ? tte->move() : MOVE_NONE;
     pvHit = ss->ttHit && tte->is_pv();
@@ -37,12 +37,11 @@
 #include "../uci.h"
 
 #include "tbprobe.h"
+#include "../../syzygycache.h"
+#include "../../syzygymap.h"
 
 #ifndef _WIN32
-#include <fcntl.h>
 #include <unistd.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
 #else
 #define WIN32_LEAN_AND_MEAN
 #ifndef NOMINMAX
@@ -206,28 +205,22 @@ public:
             close(); // Need to re-open to get native file descriptor
 
 #ifndef _WIN32
-        struct stat statbuf;
-        int fd = ::open(fname.c_str(), O_RDONLY);
+        // The mapping is shared with the other engines, see syzygymap.h
+        uint64_t size;
+        *baseAddress = const_cast<void*>(syzygy_mapFile(fname.c_str(), &size));
 
-        if (fd == -1)
-            return *baseAddress = nullptr, nullptr;
-
-        fstat(fd, &statbuf);
+        if (!*baseAddress && !size)
+            return nullptr;
 
-        if (statbuf.st_size % 64 != 16)
+        if (size % 64 != 16)
         {
             std::cerr << "Corrupt tablebase file " << fname << std::endl;
             exit(EXIT_FAILURE);
         }
 
-        *mapping = statbuf.st_size;
-        *baseAddress = mmap(nullptr, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
-#if defined(MADV_RANDOM)
-        madvise(*baseAddress, statbuf.st_size, MADV_RANDOM);
-#endif
-        ::close(fd);
+        *mapping = size;
 
-        if (*baseAddress == MAP_FAILED)
+        if (!*baseAddress)
         {
             std::cerr << "Could not mmap() " << fname << std::endl;
             exit(EXIT_FAILURE);
@@ -286,7 +279,8 @@ public:
     static void unmap(void* baseAddress, uint64_t mapping) {
 
 #ifndef _WIN32
-        munmap(baseAddress, mapping);
+        (void)mapping;
+        syzygy_unmapFile(baseAddress);
 #else
         UnmapViewOfFile(baseAddress);
         CloseHandle((HANDLE)mapping);
@@ -468,6 +462,9 @@ public:
 
 TBTables TBTables;
 
+// Recent probe_wdl() results, the payload is (WDLScore + 2) * 8 + ProbeState + 1
+SyzygyCache WDLCache;
+
 // If the corresponding file exists two new objects TBTable<WDL> and TBTable<DTZ>
 // are created and added to the lists and hash table. Called at init time.
 void TBTables::add(const std::vector<PieceType>& pieces) {
@@ -1067,6 +1064,7 @@ template<typename T>
 void set(T& e, uint8_t* data) {
 
     PairsData* d;
+    const uint8_t* start = data;
 
     enum { Split = 1, HasPawns = 2 };
 
@@ -1119,6 +1117,9 @@ void set(T& e, uint8_t* data) {
             data += d->blockLengthSize * sizeof(uint16_t);
         }
 
+    // Every probe reads the headers and indices, only the data is demand paged
+    syzygy_willNeed(start, data - start);
+
     for (File f = FILE_A; f <= maxFile; ++f)
         for (int i = 0; i < sides; i++) {
             data = (uint8_t*)(((uintptr_t)data + 0x3F) & ~0x3F); // 64 byte alignment
@@ -1263,6 +1264,7 @@ WDLScore search(Position& pos, ProbeState* result) {
 void Tablebases::init(const std::string& paths) {
 
     TBTables.clear();
+    WDLCache.clear();
     MaxCardinality = 0;
     TBFile::Paths = paths;
 
@@ -1414,8 +1416,20 @@ void Tablebases::init(const std::string& paths) {
 //  2 : win
 WDLScore Tablebases::probe_wdl(Position& pos, ProbeState* result) {
 
+    uint16_t payload;
+    if (WDLCache.probe(pos.key(), payload))
+    {
+        *result = ProbeState(int(payload & 7) - 1);
+        return WDLScore(int(payload >> 3) - 2);
+    }
+
     *result = OK;
-    return search<false>(pos, result);
+    WDLScore wdl = search<false>(pos, result);
+
+    if (*result != FAIL)
+        WDLCache.store(pos.key(), uint16_t((wdl + 2) * 8 + *result + 1));
+
+    return wdl;
 }
 
 // Probe the DTZ table for a particular position.
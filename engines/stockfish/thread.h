@@ -60,7 +60,7 @@ public:
   Pawns::Table pawnsTable;
   Material::Table materialTable;
   size_t pvIdx, pvLast;
-  std::atomic<uint64_t> nodes, tbHits, bestMoveChanges;
+  std::atomic<uint64_t> nodes, tbHits, ttProbes, ttHits, bestMoveChanges;
   int selDepth, nmpMinPly;
   Value bestValue, optimism[COLOR_NB];
 
@@ -108,6 +108,8 @@ struct ThreadPool {
   MainThread* main()        const { return static_cast<MainThread*>(threads.front()); }
   uint64_t nodes_searched() const { return accumulate(&Thread::nodes); }
   uint64_t tb_hits()        const { return accumulate(&Thread::tbHits); }
+  uint64_t tt_probes()      const { return accumulate(&Thread::ttProbes); }
+  uint64_t tt_hits()        const { return accumulate(&Thread::ttHits); }
   Thread* get_best_thread() const;
   void start_searching();
   void wait_for_search_finished() const;
@@ -25,6 +25,8 @@
 #include "stockfish/position.h"
 #include "stockfish/thread.h"
 
+#include "engines-bridging-header.h"
+
 void stockfish_cmd(const char *cmd)
 {
     Stockfish::UCI::cmd(cmd);
@@ -39,3 +41,12 @@ void stockfish_cmd(const char *cmd)
 void stockfish_cleanup() {
 }
 
+void stockfish_searchStats(EngineSearchStats* stats)
+{
+    using namespace Stockfish;
+    stats->nodes = Threads.nodes_searched();
+    stats->hashProbes = Threads.tt_probes();
+    stats->hashHits = Threads.tt_hits();
+    stats->tbHits = Threads.tb_hits();
+}
+
@@ -0,0 +1,56 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef syzygycache_h
+#define syzygycache_h
+
+#include <atomic>
+#include <cstdint>
+
+/// Results of recent tablebase probes, shared by the search threads of an
+/// engine without locking. An entry is a single 64 bit word holding the upper
+/// 48 bits of the position key and a 16 bit payload, so a racing store can't
+/// be read half written. Engines pack their own result and state in the payload
+class SyzygyCache {
+public:
+    bool probe(uint64_t key, uint16_t& payload) const {
+        const uint64_t data = table[key & (Size - 1)].load(std::memory_order_relaxed);
+        if (!data || (data ^ key) >> 16) {
+            return false;
+        }
+        payload = uint16_t(data);
+        return true;
+    }
+
+    void store(uint64_t key, uint16_t payload) {
+        table[key & (Size - 1)].store((key & ~0xFFFFULL) | payload, std::memory_order_relaxed);
+    }
+
+    /// Needed whenever the tables change
+    void clear() {
+        for (auto& e : table) {
+            e.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    static constexpr size_t Size = 1 << 15;
+    std::atomic<uint64_t> table[Size] {};
+};
+
+#endif /* syzygycache_h */
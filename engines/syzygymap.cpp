@@ -0,0 +1,128 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <climits>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "syzygymap.h"
+
+namespace {
+
+struct MappedFile {
+    const void* data;
+    uint64_t size;
+    int users;
+};
+
+std::mutex mapMutex;
+std::map<std::string, MappedFile> filesByPath;
+std::map<const void*, std::string> pathsByData;
+
+} // namespace
+
+const void* syzygy_mapFile(const char* path, uint64_t* size)
+{
+    *size = 0;
+#ifndef _WIN32
+    // The same file may be reached through different SyzygyPath strings
+    char buf[PATH_MAX];
+    std::string key = realpath(path, buf) ? buf : path;
+
+    std::lock_guard<std::mutex> lock(mapMutex);
+    auto it = filesByPath.find(key);
+    if (it != filesByPath.end()) {
+        it->second.users++;
+        *size = it->second.size;
+        return it->second.data;
+    }
+
+    int fd = ::open(key.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return nullptr;
+    }
+
+    struct stat statbuf;
+    fstat(fd, &statbuf);
+    *size = statbuf.st_size;
+    void* data = *size ? mmap(nullptr, *size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+#if defined(MADV_RANDOM)
+    madvise(data, *size, MADV_RANDOM);
+#endif
+
+    filesByPath[key] = { data, *size, 1 };
+    pathsByData[data] = key;
+    return data;
+#else
+    return nullptr;
+#endif
+}
+
+void syzygy_unmapFile(const void* data)
+{
+#ifndef _WIN32
+    if (!data) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mapMutex);
+    auto it = pathsByData.find(data);
+    if (it == pathsByData.end()) {
+        return;
+    }
+    auto& file = filesByPath[it->second];
+    if (--file.users == 0) {
+        munmap(const_cast<void*>(file.data), file.size);
+        filesByPath.erase(it->second);
+        pathsByData.erase(it);
+    }
+#endif
+}
+
+void syzygy_willNeed(const void* data, uint64_t size)
+{
+#if !defined(_WIN32) && defined(MADV_WILLNEED)
+    // madvise() needs a page aligned start
+    static const uintptr_t pageMask = uintptr_t(sysconf(_SC_PAGESIZE)) - 1;
+    const uintptr_t start = uintptr_t(data) & ~pageMask;
+    madvise((void*)start, size + (uintptr_t(data) - start), MADV_WILLNEED);
+#endif
+}
+
+void syzygy_mapStats(int* files, uint64_t* bytes)
+{
+    std::lock_guard<std::mutex> lock(mapMutex);
+    *files = int(filesByPath.size());
+    *bytes = 0;
+    for (auto&& f : filesByPath) {
+        *bytes += f.second.size;
+    }
+}
@@ -0,0 +1,42 @@
+/*
+  Banksia GUI, a chess GUI for iOS
+  Copyright (C) 2020 Nguyen Hong Pham
+
+  Banksia GUI is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Banksia GUI is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef syzygymap_h
+#define syzygymap_h
+
+#include <stdint.h>
+
+/// Tablebase files are mapped once for the whole app: Stockfish, Lc0 and
+/// RubiChess share the mapping of a file (same real path) instead of each
+/// mapping it again. A file is unmapped when its last user releases it.
+
+/// Returns the read-only mapping of the file or NULL. *size is the file length,
+/// it stays 0 if the file can't be opened and is set when only mmap() failed
+const void* syzygy_mapFile(const char* path, uint64_t* size);
+
+/// Releases a mapping returned by syzygy_mapFile
+void syzygy_unmapFile(const void* data);
+
+/// Asks the kernel to read ahead a part of a mapping which every probe of
+/// the table touches, such as its index
+void syzygy_willNeed(const void* data, uint64_t size);
+
+/// Number of files and bytes currently mapped
+void syzygy_mapStats(int* files, uint64_t* bytes);
+
+#endif /* syzygymap_h */